@@ -1,48 +1,74 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <iterator>
 #include <ostream>
-
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+/**
+ * Escape sequences, formatted into characters the caller provides: `format` writes any of them
+ * to an output iterator, `buffer` appends them to a span, and `constant` builds them at compile
+ * time, concatenated. Nothing allocates; the `std::ostream` operators write through a buffer.
+ */
 namespace ansi {
 
+namespace impl {
+
+template <std::output_iterator<char> Out> constexpr Out copy(const std::string_view text, Out out) {
+  return std::ranges::copy(text, out).out;
+}
+
+template <std::output_iterator<char> Out> constexpr Out format_number(const int n, Out out) {
+  char digits[11];
+  return copy({digits, std::to_chars(std::begin(digits), std::end(digits), n).ptr}, out);
+}
+
+} // namespace impl
+
 // Rows and columns are 1-based.
 class cursor_position {
   int row, col;
 
 public:
+  static constexpr size_t max_size = 2 + 11 + 1 + 11 + 1;
+
   constexpr cursor_position(const int row, const int col) noexcept : row(row), col(col) {}
 
-  friend std::ostream &operator<<(std::ostream &os, const cursor_position &position) {
-    return os << "\033[" << position.row << ';' << position.col << 'H';
+  template <std::output_iterator<char> Out> constexpr Out format(Out out) const {
+    out = impl::format_number(row, impl::copy("\033[", out));
+    return impl::copy("H", impl::format_number(col, impl::copy(";", out)));
   }
 };
 
-namespace impl {
+/** Moves the cursor by `offset` rows or columns, or to a column, as `command` says. */
+class cursor_move {
+  char command;
+  uint8_t offset;
 
-template <char command> constexpr std::string move_cursor(const uint8_t offset) {
-  char array[] = "\033[nnnX";
-  auto first = std::begin(array) + 2;
-  const auto last = std::end(array);
-  first = std::to_chars(first, last, offset).ptr;
-  *first++ = command;
-  *first = '\0';
-  return array;
-}
+public:
+  static constexpr size_t max_size = 2 + 3 + 1;
 
-} // namespace impl
+  constexpr cursor_move(const char command, const uint8_t offset) noexcept
+      : command(command), offset(offset) {}
 
-constexpr auto cursor_up(const uint8_t offset) { return impl::move_cursor<'A'>(offset); }
-constexpr auto cursor_down(const uint8_t offset) { return impl::move_cursor<'B'>(offset); }
-constexpr auto cursor_forward(const uint8_t offset) { return impl::move_cursor<'C'>(offset); }
-constexpr auto cursor_back(const uint8_t offset) { return impl::move_cursor<'D'>(offset); }
-constexpr auto cursor_column(const uint8_t offset) { return impl::move_cursor<'G'>(offset); }
-constexpr auto cursor_hide{"\033[?25l"};
-constexpr auto cursor_show{"\033[?25h"};
-constexpr auto cursor_steady_block{"\033[0 q"};
-constexpr auto cursor_blinking_block{"\033[1 q"};
-constexpr auto cursor_reset{"\033[H"};
-
-constexpr auto clear_screen{"\033[2J"};
-constexpr auto hard_clear_screen{"\033[3J\033c"};
-constexpr auto clear_line{"\033[2K"};
+  template <std::output_iterator<char> Out> constexpr Out format(Out out) const {
+    out = impl::format_number(offset, impl::copy("\033[", out));
+    *out++ = command;
+    return out;
+  }
+};
+
+constexpr cursor_move cursor_up(const uint8_t offset) { return {'A', offset}; }
+constexpr cursor_move cursor_down(const uint8_t offset) { return {'B', offset}; }
+constexpr cursor_move cursor_forward(const uint8_t offset) { return {'C', offset}; }
+constexpr cursor_move cursor_back(const uint8_t offset) { return {'D', offset}; }
+constexpr cursor_move cursor_column(const uint8_t offset) { return {'G', offset}; }
 
 enum class style {
   reset = 0,
@@ -154,30 +180,143 @@ public:
   }
 };
 
+/** Select Graphic Rendition: the styles and colors of the characters written next, in order. */
 template <sgr_value_t... Ts> class sgr {
   std::tuple<Ts...> vs;
 
+  template <std::output_iterator<char> Out> static constexpr Out parameter(const style s, Out out) {
+    return impl::format_number(std::to_underlying(s), out);
+  }
+  template <typename V, std::output_iterator<char> Out>
+    requires std::same_as<V, fg> || std::same_as<V, bg>
+  static constexpr Out parameter(const V &v, Out out) {
+    return impl::copy(v.sequence, out);
+  }
+
 public:
+  static constexpr size_t max_size = 2 + sizeof...(Ts) * 17 + 1;
+
   constexpr sgr(const Ts &...args) noexcept : vs(args...) {}
 
-  friend std::ostream &operator<<(std::ostream &os, const sgr &sgr) {
-    os << "\033";
-    return [&os, &sgr]<auto... Is>(std::index_sequence<Is...>) constexpr -> std::ostream & {
-      constexpr auto print = []<typename V>(const V &v) {
-        if constexpr (std::same_as<V, style>) {
-          return std::to_underlying(v);
-        } else if constexpr (std::same_as<V, fg> || std::same_as<V, bg>) {
-          return v.sequence;
-        }
-        std::unreachable();
-      };
-      return ((os << (Is ? ';' : '[') << print(std::get<Is>(sgr.vs))), ...);
-    }(std::index_sequence_for<Ts...>{}) << 'm';
+  template <std::output_iterator<char> Out> constexpr Out format(Out out) const {
+    *out++ = '\033';
+    [&out, this]<size_t... Is>(std::index_sequence<Is...>) {
+      ((*out++ = Is ? ';' : '[', out = parameter(std::get<Is>(vs), out)), ...);
+    }(std::index_sequence_for<Ts...>{});
+    *out++ = 'm';
+    return out;
   }
 };
 
-template <sgr_value_t V> std::ostream &operator<<(std::ostream &os, const V &v) {
-  return os << sgr(v);
+/** Anything with a `format` member and a bound on its size, in `max_size`. */
+template <typename T>
+concept formattable = requires(const T &v, char *out) {
+  { v.format(out) } -> std::same_as<char *>;
+  { T::max_size } -> std::convertible_to<size_t>;
+};
+
+/** The most characters a `T` writes, a lone style or color being a sequence of its own. */
+template <typename T> inline constexpr size_t size_bound = T::max_size;
+template <sgr_value_t T> inline constexpr size_t size_bound<T> = sgr<T>::max_size;
+
+template <typename T>
+  requires formattable<T> || sgr_value_t<T>
+constexpr size_t max_size(const T &) noexcept {
+  return size_bound<T>;
+}
+constexpr size_t max_size(const std::string_view text) noexcept { return text.size(); }
+
+/** Writes `value` to `out`. */
+template <formattable T, std::output_iterator<char> Out>
+constexpr Out format(const T &value, Out out) {
+  return value.format(out);
+}
+template <sgr_value_t V, std::output_iterator<char> Out> constexpr Out format(const V &v, Out out) {
+  return sgr(v).format(out);
+}
+template <std::output_iterator<char> Out>
+constexpr Out format(const std::string_view text, Out out) {
+  return impl::copy(text, out);
+}
+
+/**
+ * A sequence of at most `N` characters, fixed at compile time: a literal, `a + b` for constants
+ * `a` and `b`, or `constant<N>::of(values...)` for what `format` writes of each in turn.
+ */
+template <size_t N> class constant {
+  std::array<char, N> chars{};
+  size_t length = 0;
+
+public:
+  static constexpr size_t max_size = N;
+
+  constexpr constant() noexcept = default;
+  /** A literal, without its terminating null character. */
+  constexpr constant(const char (&literal)[N + 1]) noexcept : length(N) {
+    std::ranges::copy_n(literal, N, chars.begin());
+  }
+
+  template <typename... Ts> static constexpr constant of(const Ts &...values) noexcept {
+    assert((ansi::max_size(values) + ... + 0) <= N);
+    constant sequence;
+    char *out = sequence.chars.data();
+    ((out = ansi::format(values, out)), ...);
+    sequence.length = out - sequence.chars.data();
+    return sequence;
+  }
+
+  [[nodiscard]] constexpr std::string_view view() const noexcept { return {chars.data(), length}; }
+  constexpr operator std::string_view() const noexcept { return view(); }
+
+  template <std::output_iterator<char> Out> constexpr Out format(Out out) const {
+    return impl::copy(view(), out);
+  }
+
+  template <size_t M> constexpr constant<N + M> operator+(const constant<M> &other) const noexcept {
+    return constant<N + M>::of(*this, other);
+  }
+  constexpr bool operator==(const std::string_view other) const noexcept {
+    return view() == other;
+  }
+};
+template <size_t N> constant(const char (&)[N]) -> constant<N - 1>;
+
+/** Escape sequences appended to a span of characters, which MUST have room for them. */
+class buffer {
+  std::span<char> chars;
+  size_t length = 0;
+
+public:
+  constexpr explicit buffer(const std::span<char> chars) noexcept : chars(chars) {}
+
+  template <typename... Ts> constexpr buffer &append(const Ts &...values) noexcept {
+    assert((max_size(values) + ... + 0) <= chars.size() - length);
+    char *out = chars.data() + length;
+    ((out = format(values, out)), ...);
+    length = out - chars.data();
+    return *this;
+  }
+
+  [[nodiscard]] constexpr std::string_view view() const noexcept { return {chars.data(), length}; }
+  [[nodiscard]] constexpr size_t size() const noexcept { return length; }
+  constexpr void clear() noexcept { length = 0; }
+};
+
+constexpr constant cursor_hide{"\033[?25l"};
+constexpr constant cursor_show{"\033[?25h"};
+constexpr constant cursor_steady_block{"\033[0 q"};
+constexpr constant cursor_blinking_block{"\033[1 q"};
+constexpr constant cursor_reset{"\033[H"};
+
+constexpr constant clear_screen{"\033[2J"};
+constexpr constant hard_clear_screen{"\033[3J\033c"};
+constexpr constant clear_line{"\033[2K"};
+
+template <typename T>
+  requires formattable<T> || sgr_value_t<T>
+std::ostream &operator<<(std::ostream &os, const T &value) {
+  char chars[size_bound<T>];
+  return os.write(chars, format(value, chars) - chars);
 }
 
 } // namespace ansi
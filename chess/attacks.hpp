@@ -0,0 +1,217 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/** Square `rank * 8 + (7 - file)`: h1 is bit 0, a1 is bit 7 and a8 is bit 63. */
+using square = unsigned _BitInt(6);
+
+/** Files and ranks are 0-based: file 0 is the a-file and rank 0 is the first rank. */
+constexpr square make_square(const int file, const int rank) noexcept {
+  return rank * 8 + (7 - file);
+}
+constexpr int file_of(const square s) noexcept { return 7 - (s & 7); }
+constexpr int rank_of(const square s) noexcept { return s >> 3; }
+
+namespace chess_impl {
+
+struct direction {
+  int file, rank;
+};
+
+constexpr bool on_board(const int file, const int rank) noexcept {
+  return 0 <= file && file < 8 && 0 <= rank && rank < 8;
+}
+
+/** The squares one step away from each square in any of `directions`. */
+template <size_t N>
+constexpr std::array<uint64_t, 64> leaper_table(const std::array<direction, N> &directions) {
+  std::array<uint64_t, 64> table{};
+  for (int s = 0; s < 64; ++s) {
+    for (const auto [file, rank] : directions) {
+      if (on_board(file_of(s) + file, rank_of(s) + rank)) {
+        table[s] |= uint64_t{1} << make_square(file_of(s) + file, rank_of(s) + rank);
+      }
+    }
+  }
+  return table;
+}
+
+inline constexpr auto knight_table = leaper_table<8>({{
+    {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2},
+}});
+inline constexpr auto king_table = leaper_table<8>({{
+    {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1},
+}});
+inline constexpr std::array pawn_tables{
+    leaper_table<2>({{{-1, -1}, {1, -1}}}), // Black pawns capture towards the first rank.
+    leaper_table<2>({{{-1, 1}, {1, 1}}}),
+};
+
+inline constexpr std::array<direction, 4> rook_directions{{{0, 1}, {1, 0}, {0, -1}, {-1, 0}}};
+inline constexpr std::array<direction, 4> bishop_directions{{{1, 1}, {1, -1}, {-1, -1}, {-1, 1}}};
+
+/**
+ * Walks each ray from `s` up to and including the first occupied square. With `relevant`, stops
+ * before the edge instead: only those squares can block, so only they matter for table lookups.
+ */
+constexpr uint64_t slide(const square s, const uint64_t occupancy,
+                         const std::array<direction, 4> &directions,
+                         const bool relevant = false) noexcept {
+  uint64_t attacks = 0;
+  for (const auto [file, rank] : directions) {
+    for (int f = file_of(s) + file, r = rank_of(s) + rank; on_board(f, r); f += file, r += rank) {
+      if (relevant && !on_board(f + file, r + rank)) {
+        break;
+      }
+      const uint64_t bit = uint64_t{1} << make_square(f, r);
+      attacks |= bit;
+      if (occupancy & bit) {
+        break;
+      }
+    }
+  }
+  return attacks;
+}
+
+/** Found by random search for this square numbering; every index has a single attack set. */
+inline constexpr std::array<uint64_t, 64> rook_magics{
+    0x008000D224400480, 0x0040200010004004, 0x0200084600801020, 0x0100041001000820,
+    0xC60002001C200830, 0x050008190014000A, 0x0100019442000700, 0x0900002080420100,
+    0x0400802040008001, 0x0202002100420081, 0x0206001080244200, 0x0801002008100100,
+    0x2081000412080100, 0x0812000810040200, 0x0004001021881A04, 0x2002000100440082,
+    0xA90020800080401A, 0x0000818040002002, 0x0508820016004022, 0x0200808008001000,
+    0x0888010004100900, 0x0022010100080400, 0x0000040011321008, 0x000002000140A419,
+    0x8004400480008020, 0x00C0500840002000, 0x8400200280100080, 0x0001002100081000,
+    0x0002000A00041020, 0x0000020080040080, 0x0005000101040200, 0x0000A14200029405,
+    0x2084804008800860, 0x0050022001404004, 0x0061001041002000, 0x2000401202002008,
+    0x8001000801000410, 0x0104800400800200, 0x0101106204005801, 0x020400690200008C,
+    0x0040082042818000, 0x8100201000404000, 0x0000120080220040, 0x449040100A020020,
+    0x0000050008010011, 0x4902040002008080, 0x24801032080C0003, 0x1401C04081020004,
+    0x0088C30C80220600, 0x0004320042810200, 0x4120022080100380, 0x0010080010048080,
+    0x4804008008000480, 0x2081000400080300, 0x8322488210010400, 0x1A10040084410E00,
+    0x180B650040108001, 0x1409044001201181, 0x00641300A0010841, 0x0000100020040901,
+    0x0103000402100801, 0xC022000104100802, 0x8008080082500104, 0xC80100020020804D,
+};
+inline constexpr std::array<uint64_t, 64> bishop_magics{
+    0x8020081248102120, 0x1802021404009422, 0x0008081100210003, 0x0404440088200901,
+    0x20F2021100401020, 0x0414440240CD8208, 0x8804A08838400400, 0x8008148414200400,
+    0x0C80103110211040, 0x2610087105020601, 0x8402100424803000, 0x8000045404800228,
+    0x0200040421000060, 0x00B042015048C004, 0x011001109A104004, 0x1000014404A82880,
+    0x1009203030190840, 0x0024000214040414, 0x00206010010120A0, 0x00280000820C4082,
+    0x2052006400A22009, 0x0802000109012000, 0x0110800108011081, 0x0104800220845000,
+    0x0022900020243020, 0x10046094F0020080, 0x1020280030008820, 0x1042002008008020,
+    0x000084800400200C, 0x0810002081040100, 0x09C2022000809005, 0x00042900088084A0,
+    0x0010824810101000, 0x000884601A100280, 0x8404104401080800, 0x0C10040400480120,
+    0x0040010200410084, 0x8020108120610400, 0x107D034401010404, 0x5042008304003400,
+    0x0A14022010208500, 0x0000A42108202000, 0x0000084410080200, 0x110A004200800800,
+    0x000040010A000100, 0x00C040C800408080, 0x4042020404001120, 0x1210041680244085,
+    0x0080820842420440, 0x0C02008084110004, 0x0002010088040017, 0x0204100220884000,
+    0x80810010020E0001, 0x2500082048408048, 0x0250301021006008, 0x008404009C010180,
+    0x801012420A202014, 0x04060100C8461840, 0x0200084202110424, 0x6000088000840402,
+    0x481060002803040E, 0x0209028820280082, 0x0042069808480180, 0x4020420400440240,
+};
+
+/**
+ * Attacks of a slider for every square and every set of blockers, `N` entries in all. Each square
+ * owns 2^k consecutive entries, k being the number of its relevant squares, indexed by the
+ * blockers among them: gathered with PEXT where BMI2 is available, else hashed by the magic.
+ */
+template <size_t N> class slider_table {
+  struct entry {
+    uint64_t mask, magic;
+    uint32_t offset;
+    uint32_t shift;
+  };
+  std::array<entry, 64> entries;
+  std::array<uint64_t, N> attacks;
+
+  [[nodiscard]] static uint64_t index(const entry &e, const uint64_t occupancy) noexcept {
+#if defined(__BMI2__)
+    return _pext_u64(occupancy, e.mask);
+#else
+    return ((occupancy & e.mask) * e.magic) >> e.shift;
+#endif
+  }
+
+public:
+  slider_table(const std::array<direction, 4> &directions,
+               const std::array<uint64_t, 64> &magics) noexcept {
+    uint32_t offset = 0;
+    for (int s = 0; s < 64; ++s) {
+      const uint64_t mask = slide(s, 0, directions, true);
+      entries[s] = {mask, magics[s], offset, static_cast<uint32_t>(64 - std::popcount(mask))};
+      uint64_t blockers = 0;
+      do { // Every subset of the mask, by the carry-rippler trick.
+        attacks[offset + index(entries[s], blockers)] = slide(s, blockers, directions);
+        blockers = (blockers - mask) & mask;
+      } while (blockers != 0);
+      offset += uint32_t{1} << std::popcount(mask);
+    }
+  }
+
+  [[nodiscard]] uint64_t operator()(const square s, const uint64_t occupancy) const noexcept {
+    const entry &e = entries[s];
+    return attacks[e.offset + index(e, occupancy)];
+  }
+};
+
+inline const slider_table<102'400> rook_table(rook_directions, rook_magics);
+inline const slider_table<5'248> bishop_table(bishop_directions, bishop_magics);
+
+} // namespace chess_impl
+
+constexpr uint64_t knight_attacks(const square s) noexcept { return chess_impl::knight_table[s]; }
+constexpr uint64_t king_attacks(const square s) noexcept { return chess_impl::king_table[s]; }
+constexpr uint64_t pawn_attacks(const bool is_white, const square s) noexcept {
+  return chess_impl::pawn_tables[is_white][s];
+}
+
+/** Constant evaluation walks the rays instead, as the tables are only filled at startup. */
+constexpr uint64_t rook_attacks(const square s, const uint64_t occupancy) noexcept {
+  if consteval {
+    return chess_impl::slide(s, occupancy, chess_impl::rook_directions);
+  }
+  return chess_impl::rook_table(s, occupancy);
+}
+constexpr uint64_t bishop_attacks(const square s, const uint64_t occupancy) noexcept {
+  if consteval {
+    return chess_impl::slide(s, occupancy, chess_impl::bishop_directions);
+  }
+  return chess_impl::bishop_table(s, occupancy);
+}
+constexpr uint64_t queen_attacks(const square s, const uint64_t occupancy) noexcept {
+  return rook_attacks(s, occupancy) | bishop_attacks(s, occupancy);
+}
+
+namespace chess_impl {
+
+/** The squares strictly between `a` and `b` if they share a rank, file or diagonal, else none. */
+constexpr uint64_t between(const square a, const square b) noexcept {
+  const uint64_t bit_a = uint64_t{1} << a, bit_b = uint64_t{1} << b;
+  if (rook_attacks(a, 0) & bit_b) {
+    return rook_attacks(a, bit_b) & rook_attacks(b, bit_a);
+  }
+  if (bishop_attacks(a, 0) & bit_b) {
+    return bishop_attacks(a, bit_b) & bishop_attacks(b, bit_a);
+  }
+  return 0;
+}
+
+/** The whole rank, file or diagonal through `a` and `b`, or none if they share none. */
+constexpr uint64_t line(const square a, const square b) noexcept {
+  const uint64_t ends = uint64_t{1} << a | uint64_t{1} << b;
+  if (rook_attacks(a, 0) & ends) {
+    return (rook_attacks(a, 0) & rook_attacks(b, 0)) | ends;
+  }
+  if (bishop_attacks(a, 0) & ends) {
+    return (bishop_attacks(a, 0) & bishop_attacks(b, 0)) | ends;
+  }
+  return 0;
+}
+
+} // namespace chess_impl
@@ -0,0 +1,200 @@
+#include "perft.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/** Every position up to `depth` plies into the game from `p`, with the side to move. */
+void collect(const ply &p, const int depth, std::vector<ply> &positions) {
+  positions.push_back(p);
+  if (depth == 0) {
+    return;
+  }
+  move_list moves;
+  generate_moves(p.config, p.white_turn, moves);
+  for (const move m : moves) {
+    collect({p.config.make_move(m), !p.white_turn}, depth - 1, positions);
+  }
+}
+
+/** Median seconds of `repetitions` runs of `f`, after a warmup; `f` returns a checksum. */
+template <typename F> std::pair<double, uint64_t> measure(const int repetitions, F &&f) {
+  const uint64_t checksum = f();
+  std::vector<double> seconds;
+  for (int i = 0; i < repetitions; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t result = f();
+    seconds.push_back(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    assert(result == checksum);
+  }
+  std::ranges::sort(seconds);
+  return {seconds[seconds.size() / 2], checksum};
+}
+
+/**
+ * Usage: bench_board [repetitions=7] [perft depth=4]
+ *
+ * Times the packed `side` of a `configuration` against the per-piece bitboards and mailbox of a
+ * `board`, over every position 3 plies into the reference positions: finding the piece on each
+ * square, the king, every piece in turn, and each piece type; playing every legal move, copied or
+ * made and unmade; and a whole `perft`. Prints `key=value` lines, the checksums of both layouts
+ * having to match for a line to be meaningful.
+ */
+int main(const int argc, const char *argv[]) {
+  const int repetitions = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 7;
+  const int depth = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 4;
+  std::vector<ply> positions;
+  for (const char *fen : {
+           "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+           "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+           "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+       }) {
+    collect(*parse_fen(fen), 3, positions);
+  }
+  std::vector<board> boards;
+  for (const auto &[config, white_turn] : positions) {
+    boards.emplace_back(config);
+  }
+  std::printf("bench_board version=1 positions=%zu repetitions=%d perft_depth=%d\n",
+              positions.size(), repetitions, depth);
+
+  const auto report = [&](const char *operation, const char *layout, const auto &result,
+                          const size_t operations) {
+    const auto [seconds, checksum] = result;
+    std::printf("operation=%s layout=%s median_ms=%.3f ns_per_op=%.2f checksum=%016llx\n",
+                operation, layout, seconds * 1e3, seconds * 1e9 / operations,
+                static_cast<unsigned long long>(checksum));
+    std::fflush(stdout);
+  };
+  const size_t n = positions.size();
+
+  report("lookup", "side", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const auto &[config, white_turn] : positions) {
+             for (int s = 0; s < 64; ++s) {
+               const piece white = config.get_white().at(s);
+               sum = sum * 7 + std::to_underlying(white == piece::empty ? config.get_black().at(s)
+                                                                        : white);
+             }
+           }
+           return sum;
+         }),
+         n * 64);
+  report("lookup", "board", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const board &b : boards) {
+             for (int s = 0; s < 64; ++s) {
+               sum = sum * 7 + std::to_underlying(b.at(s));
+             }
+           }
+           return sum;
+         }),
+         n * 64);
+
+  report("king", "side", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const auto &[config, white_turn] : positions) {
+             sum = sum * 67 + config.get_white().get_king_square();
+             sum = sum * 67 + config.get_black().get_king_square();
+           }
+           return sum;
+         }),
+         n * 2);
+  report("king", "board", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const board &b : boards) {
+             sum = sum * 67 + b.king_square(true);
+             sum = sum * 67 + b.king_square(false);
+           }
+           return sum;
+         }),
+         n * 2);
+
+  // Visiting every piece with its square, in the same order: from h1 up, white then black.
+  report("iterate", "side", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const auto &[config, white_turn] : positions) {
+             for (const bool is_white : {true, false}) {
+               for (const auto [p, s] : config.get_side(is_white)) {
+                 sum = sum * 31 + std::to_underlying(p) * 64 + s;
+               }
+             }
+           }
+           return sum;
+         }),
+         n);
+  report("iterate", "board", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const board &b : boards) {
+             for (const bool is_white : {true, false}) {
+               chess_impl::for_each_square(b.get_side(is_white).get_occupancy(),
+                                           [&](const square s) {
+                                             sum = sum * 31 + std::to_underlying(b.at(s)) * 64 + s;
+                                           });
+             }
+           }
+           return sum;
+         }),
+         n);
+
+  report("bitboard", "side", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (const auto &[config, white_turn] : positions) {
+             for (int p = 1; p < 7; ++p) {
+               sum = sum * 3 + config.get_side(white_turn).bitboard(static_cast<piece>(p));
+             }
+           }
+           return sum;
+         }),
+         n * 6);
+  report("bitboard", "board", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (size_t i = 0; i < n; ++i) {
+             for (int p = 1; p < 7; ++p) {
+               sum = sum * 3 +
+                     boards[i].get_side(positions[i].white_turn).bitboard(static_cast<piece>(p));
+             }
+           }
+           return sum;
+         }),
+         n * 6);
+
+  std::vector<move_list> moves(n);
+  size_t total_moves = 0;
+  for (size_t i = 0; i < n; ++i) {
+    generate_moves(positions[i].config, positions[i].white_turn, moves[i]);
+    total_moves += moves[i].size();
+  }
+  report("make", "side", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (size_t i = 0; i < n; ++i) {
+             for (const move m : moves[i]) {
+               sum = sum * 3 + positions[i].config.make_move(m).occupancy();
+             }
+           }
+           return sum;
+         }),
+         total_moves);
+  report("make", "board", measure(repetitions, [&] {
+           uint64_t sum = 0;
+           for (size_t i = 0; i < n; ++i) {
+             for (const move m : moves[i]) {
+               const board::undo u = boards[i].make_move(m);
+               sum = sum * 3 + boards[i].occupancy();
+               boards[i].unmake_move(u);
+             }
+           }
+           return sum;
+         }),
+         total_moves);
+
+  const configuration kiwipete =
+      parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1")->config;
+  board b(kiwipete);
+  const uint64_t nodes = perft(b, true, depth);
+  report("perft", "side", measure(repetitions, [&] { return perft(kiwipete, true, depth); }),
+         nodes);
+  report("perft", "board", measure(repetitions, [&] { return perft(b, true, depth); }), nodes);
+}
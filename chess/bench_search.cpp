@@ -0,0 +1,72 @@
+#include "mapped_file.hpp"
+#include "search.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+/** Openings, middlegames and endgames, fixed so that runs on any machine can be compared. */
+constexpr std::pair<const char *, const char *> suite[] = {
+    {"initial", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"},
+    {"italian", "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4"},
+    {"benoni", "rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 0 4"},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"},
+    {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"},
+    {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"},
+    {"rooks", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"},
+    {"pawns", "8/5pk1/6p1/8/8/6P1/5PK1/8 w - - 0 1"},
+};
+
+/**
+ * Usage: bench_search [depth=6] [threads=all cores] [hash megabytes=64] [network]
+ *
+ * Searches each position of the suite to `depth` with 1 thread, then 2, 4 and so on up to
+ * `threads`, each time with a cleared table. Prints a line per position and one per thread count
+ * as `key=value` pairs: nodes per second, and the time to reach the depth, whose ratio to that
+ * of 1 thread is the speedup Lazy SMP gives. Evaluates with the network mapped from the file
+ * `network` if given, else with the piece-square tables.
+ */
+int main(const int argc, const char *argv[]) {
+  const int depth = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 6;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned max_threads = argc > 2 ? std::max(std::atoi(argv[2]), 1) : cores;
+  const size_t megabytes = argc > 3 ? std::max(std::strtoull(argv[3], nullptr, 10), 1ull) : 64;
+  const mapped_file file(argc > 4 ? argv[4] : "");
+  const network *const net = network::load(file.view());
+  if (argc > 4 && !net) {
+    std::fprintf(stderr, "%s: not a network\n", argv[4]);
+    return 1;
+  }
+  std::printf("bench_search version=1 depth=%d threads=%u hash_mb=%zu positions=%zu eval=%s\n",
+              depth, max_threads, megabytes, std::size(suite), net ? "network" : "tables");
+
+  transposition_table table(megabytes);
+  double baseline = 0;
+  std::vector<unsigned> thread_counts;
+  for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(max_threads);
+  for (const unsigned threads : thread_counts) {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    for (const auto &[name, fen] : suite) {
+      table.clear();
+      const auto report =
+          search(*parse_fen(fen), {.depth = depth, .threads = threads, .net = net}, table);
+      const double s = std::chrono::duration<double>(report.elapsed).count();
+      std::printf("position=%s threads=%u depth=%d score=%d best=%s nodes=%llu seconds=%.3f "
+                  "nps=%.0f\n",
+                  name, threads, report.depth, report.score, to_string(*report.best()).c_str(),
+                  static_cast<unsigned long long>(report.nodes), s, report.nps());
+      std::fflush(stdout);
+      nodes += report.nodes;
+      seconds += s;
+    }
+    if (threads == 1) {
+      baseline = seconds;
+    }
+    std::printf("threads=%u depth=%d nodes=%llu seconds=%.3f nps=%.0f speedup=%.2f\n", threads,
+                depth, static_cast<unsigned long long>(nodes), seconds, nodes / seconds,
+                baseline / seconds);
+    std::fflush(stdout);
+  }
+}
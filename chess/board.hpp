@@ -0,0 +1,127 @@
+#pragma once
+#include "chess.hpp"
+
+/**
+ * The same position as a `configuration`, laid out for playing moves in place: a bitboard per
+ * color and piece type, plus the piece on each square. Every query is a single load, and a move
+ * touches a few words, so it is played and taken back rather than copied.
+ */
+class board {
+  std::array<std::array<uint64_t, 7>, 2> pieces{}; // By color, then by type; `piece::empty` unused.
+  std::array<uint64_t, 2> colors{};                // Black, then white.
+  std::array<piece, 64> mailbox{};
+  uint8_t castling_rights = castling::all;
+  uint64_t en_passant = 0;
+
+  constexpr void put(const bool is_white, const square s, const piece p) noexcept {
+    pieces[is_white][std::to_underlying(p)] |= uint64_t{1} << s;
+    colors[is_white] |= uint64_t{1} << s;
+    mailbox[s] = p;
+  }
+
+  /** Returns what was on `s`, which MUST hold a piece of the given color. */
+  constexpr piece remove(const bool is_white, const square s) noexcept {
+    const piece p = mailbox[s];
+    pieces[is_white][std::to_underlying(p)] ^= uint64_t{1} << s;
+    colors[is_white] ^= uint64_t{1} << s;
+    mailbox[s] = piece::empty;
+    return p;
+  }
+
+public:
+  /** What `unmake_move` needs to restore and cannot tell from the position after the move. */
+  struct undo {
+    move m;
+    piece moved, captured;
+    uint8_t castling_rights;
+    uint64_t en_passant;
+  };
+
+  /** One color's pieces, as `generate_moves` asks for them. */
+  class side_view {
+    const board &b;
+    bool is_white;
+
+  public:
+    constexpr side_view(const board &b, const bool is_white) noexcept : b(b), is_white(is_white) {}
+
+    [[nodiscard]] constexpr uint64_t get_occupancy() const noexcept { return b.colors[is_white]; }
+    [[nodiscard]] constexpr uint64_t bitboard(const piece p) const noexcept {
+      return b.pieces[is_white][std::to_underlying(p)];
+    }
+  };
+
+  constexpr explicit board(const configuration &config) noexcept
+      : castling_rights(config.get_castling()), en_passant(config.get_en_passant()) {
+    for (const bool is_white : {false, true}) {
+      for (const auto [p, s] : config.get_side(is_white)) {
+        put(is_white, s, p);
+      }
+    }
+  }
+  constexpr board() noexcept : board(configuration()) {}
+
+  [[nodiscard]] constexpr piece at(const square s) const noexcept { return mailbox[s]; }
+  /** `s` MUST be occupied. */
+  [[nodiscard]] constexpr bool is_white_at(const square s) const noexcept {
+    return colors[1] >> s & 1;
+  }
+  [[nodiscard]] constexpr side_view get_side(const bool is_white) const noexcept {
+    return {*this, is_white};
+  }
+  [[nodiscard]] constexpr square king_square(const bool is_white) const noexcept {
+    return std::countr_zero(pieces[is_white][std::to_underlying(piece::king)]);
+  }
+  [[nodiscard]] constexpr uint8_t get_castling() const noexcept { return castling_rights; }
+  [[nodiscard]] constexpr uint64_t get_en_passant() const noexcept { return en_passant; }
+  [[nodiscard]] constexpr uint64_t occupancy() const noexcept { return colors[0] | colors[1]; }
+
+  /** Plays `m` in place, with the same rules and preconditions as `configuration::make_move`. */
+  constexpr undo make_move(const move m) noexcept {
+    const int from = m.from(), to = m.to(); // Not 6 bits wide: squares would wrap around.
+    const bool is_white = is_white_at(from);
+    const undo u{m, mailbox[from], mailbox[to], castling_rights, en_passant};
+    if (u.captured != piece::empty) {
+      remove(!is_white, to);
+    }
+    remove(is_white, from);
+    put(is_white, to, m.get_promotion() == piece::empty ? u.moved : m.get_promotion());
+
+    en_passant = 0;
+    if (u.moved == piece::pawn) {
+      if (m.dst(u.en_passant)) {
+        remove(!is_white, is_white ? to - 8 : to + 8);
+      } else if (std::abs(to - from) == 16) {
+        en_passant = uint64_t{1} << (from + to) / 2;
+      }
+    } else if (u.moved == piece::king && std::abs(to - from) == 2) {
+      remove(is_white, to < from ? from - 3 : from + 4);
+      put(is_white, (from + to) / 2, piece::rook);
+    }
+
+    castling_rights &= ~chess_impl::lost_castling(m.src() | m.dst());
+    return u;
+  }
+
+  /** Takes back the move `u` was returned for, which MUST be the last one played. */
+  constexpr void unmake_move(const undo &u) noexcept {
+    const int from = u.m.from(), to = u.m.to();
+    const bool is_white = is_white_at(to);
+    remove(is_white, to);
+    put(is_white, from, u.moved);
+    if (u.captured != piece::empty) {
+      put(!is_white, to, u.captured);
+    }
+
+    if (u.moved == piece::pawn && u.m.dst(u.en_passant)) {
+      put(!is_white, is_white ? to - 8 : to + 8, piece::pawn);
+    } else if (u.moved == piece::king && std::abs(to - from) == 2) {
+      remove(is_white, (from + to) / 2);
+      put(is_white, to < from ? from - 3 : from + 4, piece::rook);
+    }
+    castling_rights = u.castling_rights;
+    en_passant = u.en_passant;
+  }
+
+  constexpr bool operator==(const board &) const = default;
+};
@@ -0,0 +1,188 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "pgn.hpp"
+#include "polyglot.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+/** A move of an opening book, as saved: what it is worth to the side to move, and spare bits. */
+struct book_entry {
+  uint64_t key;
+  uint16_t move;
+  uint16_t weight;
+  uint32_t learn;
+};
+
+namespace chess_impl {
+
+/** The big-endian number in the `size` bytes at `bytes`. */
+constexpr uint64_t load_big_endian(const char8_t *bytes, const int size) noexcept {
+  uint64_t n = 0;
+  for (int i = 0; i < size; ++i) {
+    n = n << 8 | bytes[i];
+  }
+  return n;
+}
+
+} // namespace chess_impl
+
+/**
+ * Encodes `m` as Polyglot books do: destination file and rank, then source file and rank, 3 bits
+ * each from a1, then the promotion from 1 for a knight to 4 for a queen. Castling is the king
+ * taking its own rook.
+ */
+constexpr uint16_t book_move(const configuration &config, const move m) noexcept {
+  const int from = m.from();
+  int to = m.to();
+  if (const bool is_white = m.src(config.get_side(true)) != 0;
+      config.get_side(is_white).at(from) == piece::king && std::abs(to - from) == 2) {
+    to = to < from ? from - 3 : from + 4;
+  }
+  const auto polyglot = [](const int s) { return (s >> 3) * 8 + 7 - (s & 7); };
+  constexpr std::array<uint16_t, 7> promotions{0, 0, 3, 1, 2, 4, 0}; // By `piece`.
+  return promotions[std::to_underlying(m.get_promotion())] << 12 | polyglot(from) << 6 |
+         polyglot(to);
+}
+
+/**
+ * An opening book in the layout of Polyglot's: 16-byte big-endian entries sorted by key, a
+ * position's moves next to each other, keyed by `polyglot_key`. It is mapped and searched in
+ * place, never parsed.
+ */
+class opening_book {
+  mapped_file file;
+  size_t entries = 0;
+
+  static constexpr size_t entry_size = 16;
+
+  [[nodiscard]] const char8_t *at(const size_t i) const noexcept {
+    return file.view().data() + i * entry_size;
+  }
+
+public:
+  /** Maps the book at `path`; a missing file or one not a whole number of entries is empty. */
+  explicit opening_book(const char *path) noexcept : file(path) {
+    if (file.view().size() % entry_size == 0) {
+      entries = file.view().size() / entry_size;
+    }
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return entries; }
+
+  /** The legal moves the book has for `position` and their weights, in the book's order. */
+  [[nodiscard]] std::vector<std::pair<move, uint16_t>> moves(const ply &position) const {
+    const uint64_t key = polyglot_key(position.config, position.white_turn);
+    size_t low = 0, high = entries;
+    while (low < high) {
+      const size_t middle = low + (high - low) / 2;
+      if (chess_impl::load_big_endian(at(middle), 8) < key) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    std::vector<std::pair<move, uint16_t>> found;
+    move_list legal;
+    generate_moves(position.config, position.white_turn, legal);
+    for (size_t i = low; i < entries && chess_impl::load_big_endian(at(i), 8) == key; ++i) {
+      const auto code = static_cast<uint16_t>(chess_impl::load_big_endian(at(i) + 8, 2));
+      const auto m = std::ranges::find(legal, code, [&](const move candidate) {
+        return book_move(position.config, candidate);
+      });
+      if (m != legal.end()) {
+        found.emplace_back(*m, static_cast<uint16_t>(chess_impl::load_big_endian(at(i) + 10, 2)));
+      }
+    }
+    return found;
+  }
+
+  /**
+   * A move for `position` drawn in proportion to the weights, `random` being uniform in
+   * [0, 2^64); none if the book has no move of any weight.
+   */
+  [[nodiscard]] std::optional<move> pick(const ply &position, const uint64_t random) const {
+    const auto found = moves(position);
+    uint64_t total = 0;
+    for (const auto &[m, weight] : found) {
+      total += weight;
+    }
+    if (total == 0) {
+      return std::nullopt;
+    }
+    uint64_t drawn = static_cast<uint64_t>((static_cast<unsigned __int128>(random) * total) >> 64);
+    for (const auto &[m, weight] : found) {
+      if (drawn < weight) {
+        return m;
+      }
+      drawn -= weight;
+    }
+    std::unreachable();
+  }
+};
+
+/** Writes `entries` in the layout `opening_book` maps, sorting them; false on any I/O error. */
+[[nodiscard]] inline bool save_book(const int fd, std::vector<book_entry> entries) noexcept {
+  std::ranges::sort(entries, [](const book_entry &a, const book_entry &b) {
+    return std::tie(a.key, b.weight, a.move) < std::tie(b.key, a.weight, b.move);
+  });
+  std::vector<char8_t> bytes;
+  bytes.reserve(entries.size() * 16);
+  const auto put = [&bytes](const uint64_t n, const int size) {
+    for (int i = size - 1; i >= 0; --i) {
+      bytes.push_back(static_cast<char8_t>(n >> 8 * i));
+    }
+  };
+  for (const book_entry &entry : entries) {
+    put(entry.key, 8);
+    put(entry.move, 2);
+    put(entry.weight, 2);
+    put(entry.learn, 4);
+  }
+  for (const char8_t *p = bytes.data(), *end = p + bytes.size(); p != end;) {
+    const ssize_t n = write(fd, p, end - p);
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+  }
+  return true;
+}
+
+/**
+ * The book of the positions of `table` from the initial one, to `max_ply`, through moves played
+ * in at least `min_games` games: a move weighs twice the games the side that played it won, plus
+ * those drawn, scaled so that the heaviest of a position weighs 65535.
+ */
+inline std::vector<book_entry> make_book(const position_table &table, const int max_ply,
+                                         const uint64_t min_games) {
+  std::vector<book_entry> book;
+  std::unordered_set<uint64_t> seen;
+  std::vector<std::pair<ply, int>> pending{{{configuration(), true}, 0}};
+  while (!pending.empty()) {
+    const auto [position, at] = pending.back();
+    pending.pop_back();
+    const uint64_t key = polyglot_key(position.config, position.white_turn);
+    if (at >= max_ply || !seen.insert(key).second) {
+      continue;
+    }
+    const size_t first = book.size();
+    uint64_t heaviest = 0;
+    std::vector<uint64_t> scores;
+    for (const auto &[m, stats] : continuations(table, position)) {
+      if (stats.games < min_games) {
+        break;
+      }
+      const game_result won =
+          position.white_turn ? game_result::white_wins : game_result::black_wins;
+      scores.push_back(2 * stats.results[std::to_underlying(won)] +
+                       stats.results[std::to_underlying(game_result::draw)]);
+      heaviest = std::max(heaviest, scores.back());
+      book.push_back({key, book_move(position.config, m), 0, 0});
+      pending.push_back({{position.config.make_move(m), !position.white_turn}, at + 1});
+    }
+    for (size_t i = first; i < book.size(); ++i) {
+      book[i].weight = heaviest ? static_cast<uint16_t>(scores[i - first] * 65535 / heaviest) : 0;
+    }
+  }
+  return book;
+}
@@ -1,14 +1,18 @@
 #pragma once
+#include "attacks.hpp"
+#include "zobrist.hpp"
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdlib>
+#include <iterator>
+#include <optional>
 #include <ranges>
+#include <string>
+#include <string_view>
 #include <utility>
 
-using square = unsigned _BitInt(6);
-
-enum class piece { empty, pawn, rook, knight, bishop, queen, king };
+enum class piece : uint8_t { empty, pawn, rook, knight, bishop, queen, king };
 
 class side {
   static constexpr std::array initial_rank1{
@@ -48,10 +52,14 @@ public:
 
 private:
   uint64_t occupancy{}, pieces{};
-  constexpr side() noexcept = default;
 
 public:
+  /** No pieces at all; see `insert`. */
+  constexpr side() noexcept = default;
+
   [[nodiscard]] constexpr auto get_occupancy() const noexcept { return occupancy; }
+  /** A nibble per piece, in the order of the occupied squares from h1. */
+  [[nodiscard]] constexpr auto get_pieces() const noexcept { return pieces; }
 
   [[nodiscard]] constexpr auto get_king_square() const noexcept {
     for (const auto [piece, shift] : *this) {
@@ -62,6 +70,54 @@ public:
     assert(false); // FIXME: std::unreachable();
   }
 
+private:
+  /** The index of the nibble of the piece on `s`, or where it would go. */
+  [[nodiscard]] constexpr int nibble(const square s) const noexcept {
+    return std::popcount(occupancy & ((uint64_t{1} << s) - 1));
+  }
+
+public:
+  [[nodiscard]] constexpr piece at(const square s) const noexcept {
+    if (!(occupancy >> s & 1)) {
+      return piece::empty;
+    }
+    return static_cast<piece>(pieces >> 4 * nibble(s) & 0xF);
+  }
+
+  /** The squares of all pieces of type `p`. */
+  [[nodiscard]] constexpr uint64_t bitboard(const piece p) const noexcept {
+    // Nibbles equal to `p` become 0, then the lowest bit of each 0 nibble is set.
+    constexpr uint64_t low_bits = 0x1111'1111'1111'1111;
+    const uint64_t x = pieces ^ low_bits * std::to_underlying(p);
+    const uint64_t matches = ~(x | x >> 1 | x >> 2 | x >> 3) & low_bits;
+#if defined(__BMI2__)
+    if !consteval {
+      return _pdep_u64(_pext_u64(matches, low_bits), occupancy);
+    }
+#endif
+    uint64_t squares = 0;
+    for (uint64_t o = occupancy, m = matches; o != 0; o &= o - 1, m >>= 4) {
+      squares |= o & -o & -(m & 1);
+    }
+    return squares;
+  }
+
+  /** `s` MUST be empty, and there MUST be fewer than 16 pieces. */
+  constexpr void insert(const square s, const piece p) noexcept {
+    const int shift = 4 * nibble(s);
+    const uint64_t below = (uint64_t{1} << shift) - 1;
+    pieces = (pieces & below) | uint64_t{std::to_underlying(p)} << shift | (pieces & ~below) << 4;
+    occupancy |= uint64_t{1} << s;
+  }
+
+  /** `s` MUST be occupied. */
+  constexpr void erase(const square s) noexcept {
+    const int shift = 4 * nibble(s);
+    const uint64_t below = (uint64_t{1} << shift) - 1;
+    pieces = (pieces & below) | (pieces >> shift >> 4) << shift;
+    occupancy ^= uint64_t{1} << s;
+  }
+
   class iterator {
     uint64_t occupancy, pieces;
 
@@ -101,21 +157,20 @@ public:
 static_assert(std::ranges::sized_range<side>);
 
 class move {
-  int src_square, dst_square;
-
-  template <uint64_t L, uint64_t R = L>
-  [[nodiscard]] constexpr uint64_t straight_path() const noexcept {
-    if (src_square < dst_square) {
-      return (L << src_square) ^ (L << dst_square);
-    } else {
-      return (R >> (63 ^ src_square)) ^ (R >> (63 ^ dst_square));
-      // static_assert((63 - x) == (63 ^ x)); // forall 0 <= x < 64
-    }
-  }
+  square src_square, dst_square;
+  piece promotion;
 
 public:
-  constexpr move(const square src_square, const square dst_square) noexcept
-      : src_square(src_square), dst_square(dst_square) {}
+  /** Leaves the move indeterminate, so that move lists cost nothing to create. */
+  constexpr move() noexcept = default;
+  constexpr move(const square src_square, const square dst_square,
+                 const piece promotion = piece::empty) noexcept
+      : src_square(src_square), dst_square(dst_square), promotion(promotion) {}
+
+  [[nodiscard]] constexpr square from() const noexcept { return src_square; }
+  [[nodiscard]] constexpr square to() const noexcept { return dst_square; }
+  /** What a pawn reaching the last rank becomes, otherwise `piece::empty`. */
+  [[nodiscard]] constexpr piece get_promotion() const noexcept { return promotion; }
 
   [[nodiscard]] constexpr uint64_t src() const noexcept { return uint64_t{1} << src_square; }
   [[nodiscard]] constexpr uint64_t src(const uint64_t mask) const noexcept { return mask & src(); }
@@ -135,42 +190,148 @@ public:
 
   /** Returns rank-difference followed by file-difference. */
   [[nodiscard]] constexpr auto diff() const noexcept {
-    return std::div(dst_square - src_square, 8);
+    return std::div(static_cast<int>(dst_square) - static_cast<int>(src_square), 8);
   }
 
-  /** The four cardinal directions: north, south, east, and west. */
-  [[nodiscard]] constexpr std::optional<uint64_t> cardinal_path() const noexcept {
-    const auto [rank_diff, file_diff] = diff();
-    if (rank_diff == 0) { // same rank
-      constexpr uint64_t full = 0xFFFF'FFFF'FFFF'FFFF;
-      return straight_path<full>();
-    }
-    if (file_diff == 0) { // same file
-      constexpr uint64_t rightmost_file = 0x0101'0101'0101'0101;
-      constexpr uint64_t leftmost_file = 0x8080'8080'8080'8080;
-      return straight_path<rightmost_file, leftmost_file>();
-    }
+  constexpr bool operator==(const move &) const = default;
+};
+
+/** A square by name, e.g. "e4". */
+constexpr std::optional<square> parse_square(const std::string_view name) {
+  if (name.size() != 2 || name[0] < 'a' || 'h' < name[0] || name[1] < '1' || '8' < name[1]) {
     return std::nullopt;
-  };
+  }
+  return make_square(name[0] - 'a', name[1] - '1');
+}
+
+/** Coordinate notation, as UCI has it: "e2e4", or "e7e8q" for a promotion. */
+constexpr std::string to_string(const move m) {
+  std::string text{static_cast<char>('a' + file_of(m.from())),
+                   static_cast<char>('1' + rank_of(m.from())),
+                   static_cast<char>('a' + file_of(m.to())),
+                   static_cast<char>('1' + rank_of(m.to()))};
+  if (m.get_promotion() != piece::empty) {
+    text += " prnbqk"[std::to_underlying(m.get_promotion())];
+  }
+  return text;
+}
+
+constexpr std::optional<move> parse_move(const std::string_view text) {
+  constexpr std::string_view promotions = "rnbq"; // In the order of `piece`, from the rook.
+  if (text.size() < 4 || text.size() > 5 || (text.size() == 5 && !promotions.contains(text[4]))) {
+    return std::nullopt;
+  }
+  const auto from = parse_square(text.substr(0, 2));
+  const auto to = parse_square(text.substr(2, 2));
+  if (!from || !to) {
+    return std::nullopt;
+  }
+  return move(*from, *to,
+              text.size() == 5 ? static_cast<piece>(promotions.find(text[4]) + 2) : piece::empty);
+}
+
+/** Castling rights, as bits. */
+struct castling {
+  static constexpr uint8_t white_king = 1 << 0;
+  static constexpr uint8_t white_queen = 1 << 1;
+  static constexpr uint8_t black_king = 1 << 2;
+  static constexpr uint8_t black_queen = 1 << 3;
+  static constexpr uint8_t all = (1 << 4) - 1;
+};
 
-  /** The four ordinal directions: northeast, southeast, southwest, and northwest. */
-  [[nodiscard]] constexpr std::optional<uint64_t> ordinal_path() const noexcept {
-    const auto [rank_diff, file_diff] = diff();
-    if (rank_diff == file_diff) { // northwest-southeast
-      constexpr uint64_t major_diagonal = 0x8040'2010'0804'0201;
-      return straight_path<major_diagonal>();
+namespace chess_impl {
+
+/** Moving the king or a rook, or capturing a rook, gives up the corresponding rights. */
+constexpr uint8_t lost_castling(const uint64_t squares) noexcept {
+  constexpr uint64_t e1 = 0x08, h1 = 0x01, a1 = 0x80;
+  return (squares & (e1 | h1) ? castling::white_king : 0) |
+         (squares & (e1 | a1) ? castling::white_queen : 0) |
+         (squares & (e1 | h1) << 56 ? castling::black_king : 0) |
+         (squares & (e1 | a1) << 56 ? castling::black_queen : 0);
+}
+
+/** The pieces of the side `by_white` attacking `s`, sliders being blocked by `occupancy`. */
+template <typename Position>
+constexpr uint64_t attackers(const Position &position, const square s, const uint64_t occupancy,
+                             const bool by_white) noexcept {
+  const auto &by = position.get_side(by_white);
+  const uint64_t queens = by.bitboard(piece::queen);
+  return (pawn_attacks(!by_white, s) & by.bitboard(piece::pawn)) |
+         (knight_attacks(s) & by.bitboard(piece::knight)) |
+         (king_attacks(s) & by.bitboard(piece::king)) |
+         (bishop_attacks(s, occupancy) & (by.bitboard(piece::bishop) | queens)) |
+         (rook_attacks(s, occupancy) & (by.bitboard(piece::rook) | queens));
+}
+
+} // namespace chess_impl
+
+/**
+ * The pieces of either color attacking `s`, sliders being blocked by `occupancy`. Attacks are
+ * symmetric: a knight on `s` would attack exactly the knights attacking `s`, and so on for every
+ * type but pawns, which are looked up as if of the other color.
+ */
+template <typename Position>
+constexpr uint64_t attackers_to(const Position &position, const square s,
+                                const uint64_t occupancy) noexcept {
+  const auto &white = position.get_side(true), &black = position.get_side(false);
+  const auto both = [&](const piece p) { return white.bitboard(p) | black.bitboard(p); };
+  const uint64_t queens = both(piece::queen);
+  return (pawn_attacks(false, s) & white.bitboard(piece::pawn)) |
+         (pawn_attacks(true, s) & black.bitboard(piece::pawn)) |
+         (knight_attacks(s) & both(piece::knight)) | (king_attacks(s) & both(piece::king)) |
+         (bishop_attacks(s, occupancy) & (both(piece::bishop) | queens)) |
+         (rook_attacks(s, occupancy) & (both(piece::rook) | queens));
+}
+
+/**
+ * What keeps the king of one side safe, worked out once per position, so that telling whether a
+ * move leaves it attacked takes a few ANDs. King moves and en passant still need a closer look:
+ * the king must not step into an attack, and en passant removes a pawn from another square.
+ */
+struct king_safety {
+  square king;
+  uint64_t checkers;                // Their pieces attacking the king.
+  uint64_t pinned = 0;              // Ours alone between the king and one of their sliders.
+  uint64_t evasions = ~uint64_t{0}; // Where other pieces must go: the checker, or in its way.
+
+  template <typename Position>
+  constexpr king_safety(const Position &position, const bool is_white) noexcept {
+    const auto &us = position.get_side(is_white), &them = position.get_side(!is_white);
+    const uint64_t ours = us.get_occupancy(), theirs = them.get_occupancy();
+    king = std::countr_zero(us.bitboard(piece::king));
+    checkers = chess_impl::attackers(position, king, ours | theirs, !is_white);
+    if (std::has_single_bit(checkers)) {
+      evasions = checkers | chess_impl::between(king, std::countr_zero(checkers));
+    } else if (checkers) {
+      evasions = 0; // Only the king can escape a double check.
     }
-    if (rank_diff == -file_diff) { // northeast-southwest
-      constexpr uint64_t minor_diagonal_h1 = 0x0204'0810'2040'8001;
-      constexpr uint64_t minor_diagonal_a8 = 0x8001'0204'0810'2040;
-      return straight_path<minor_diagonal_h1, minor_diagonal_a8>();
+
+    // Their sliders that would attack the king if not for our pieces.
+    const uint64_t queens = them.bitboard(piece::queen);
+    uint64_t snipers = (rook_attacks(king, theirs) & (them.bitboard(piece::rook) | queens)) |
+                       (bishop_attacks(king, theirs) & (them.bitboard(piece::bishop) | queens));
+    for (; snipers != 0; snipers &= snipers - 1) {
+      const uint64_t blockers =
+          chess_impl::between(king, std::countr_zero(snipers)) & (ours | theirs);
+      if (std::has_single_bit(blockers) && (blockers & ours)) {
+        pinned |= blockers;
+      }
     }
-    return std::nullopt;
-  };
+  }
+
+  /** Where the piece on `from`, other than the king, may go: along its pin, if pinned. */
+  [[nodiscard]] constexpr uint64_t allowed(const square from) const noexcept {
+    return pinned >> from & 1 ? evasions & chess_impl::line(king, from) : evasions;
+  }
 };
 
+struct ply;
+
 class configuration {
   side white, black;
+  uint8_t castling_rights = castling::all;
+  uint64_t en_passant = 0; // The square skipped by a pawn that just advanced 2 squares.
+  uint64_t key = 0;
 
   constexpr configuration(const side white, const side black) : white(white), black(black) {
     // Pieces of different colors DO NOT share any square.
@@ -182,36 +343,132 @@ class configuration {
     // There is exactly 1 king for each side.
     assert(std::ranges::count_if(white, is_king) == 1);
     assert(std::ranges::count_if(black, is_king) == 1);
+    key = compute_key(true);
+  }
+
+  static constexpr uint64_t piece_key(const bool is_white, const piece p, const int s) noexcept {
+    return chess_impl::zobrist.pieces[is_white][std::to_underlying(p)][s];
+  }
+  static constexpr uint64_t en_passant_key(const uint64_t en_passant) noexcept {
+    return en_passant ? chess_impl::zobrist.en_passant[file_of(std::countr_zero(en_passant))] : 0;
   }
 
   [[nodiscard]] constexpr bool empty(const uint64_t mask) const noexcept {
-    return !(mask & (black.get_occupancy() ^ white.get_occupancy()));
+    return !(mask & occupancy());
   }
 
   [[nodiscard]] constexpr bool check(const bool is_white) const noexcept {
-    const auto dst_square = (is_white ? white : black).get_king_square();
-    const auto opponent = is_white ? black : white;
-    for (const auto [piece, shift] : opponent) {
-      if (test_move(piece, move(shift, dst_square))) {
-        return true;
-      }
-    }
-    return false;
+    const square king = std::countr_zero(get_side(is_white).bitboard(piece::king));
+    return chess_impl::attackers(*this, king, occupancy(), !is_white) != 0;
   }
 
+  friend constexpr std::optional<ply> parse_fen(std::string_view fen);
+
 public:
   constexpr configuration() : configuration(side::initial_white(), side::initial_black()) {}
 
+  /**
+   * The position of the pieces of `white` and `black`, with no castling rights nor en passant
+   * square, the side `is_white` to move. There MUST be exactly 1 king each, on squares apart.
+   */
+  static constexpr configuration setup(const side white, const side black, const bool is_white) {
+    configuration config(white, black);
+    config.castling_rights = 0;
+    config.key = config.compute_key(is_white);
+    return config;
+  }
+
   [[nodiscard]] constexpr const auto &get_white() const noexcept { return white; }
   [[nodiscard]] constexpr const auto &get_black() const noexcept { return black; }
+  [[nodiscard]] constexpr const side &get_side(const bool is_white) const noexcept {
+    return is_white ? white : black;
+  }
+  [[nodiscard]] constexpr uint8_t get_castling() const noexcept { return castling_rights; }
+  [[nodiscard]] constexpr uint64_t get_en_passant() const noexcept { return en_passant; }
+
+  [[nodiscard]] constexpr uint64_t occupancy() const noexcept {
+    return black.get_occupancy() ^ white.get_occupancy();
+  }
+
+  /**
+   * The Zobrist key: equal for the same pieces, castling rights, en passant square and side to
+   * move, and otherwise almost surely different. Every move flips the side to move, white first
+   * unless set up otherwise, as by `parse_fen`.
+   */
+  [[nodiscard]] constexpr uint64_t get_key() const noexcept { return key; }
+
+  /** `get_key()`, computed from scratch rather than kept up to date a move at a time. */
+  [[nodiscard]] constexpr uint64_t compute_key(const bool is_white) const noexcept {
+    uint64_t k = chess_impl::zobrist.castling[castling_rights] ^ en_passant_key(en_passant) ^
+                 (is_white ? 0 : chess_impl::zobrist.black_to_move);
+    for (const bool color : {false, true}) {
+      for (const auto [p, s] : get_side(color)) {
+        k ^= piece_key(color, p, s);
+      }
+    }
+    return k;
+  }
+
+  /**
+   * Plays `m`, which MUST be legal, whoever's piece is on its source square. Castling is a king
+   * move of 2 squares, and en passant is a pawn capturing onto the en passant square.
+   */
+  [[nodiscard]] constexpr configuration make_move(const move m) const noexcept {
+    configuration next = *this;
+    const bool is_white = m.src(white) != 0;
+    side &us = is_white ? next.white : next.black;
+    side &them = is_white ? next.black : next.white;
+    const int from = m.from(), to = m.to(); // Not 6 bits wide: squares would wrap around.
+    const piece p = us.at(from);
+    const piece placed = m.get_promotion() == piece::empty ? p : m.get_promotion();
+    if (m.dst(them)) {
+      next.key ^= piece_key(!is_white, them.at(to), to);
+      them.erase(to);
+    }
+    us.erase(from);
+    us.insert(to, placed);
+    next.key ^= piece_key(is_white, p, from) ^ piece_key(is_white, placed, to);
+
+    next.en_passant = 0;
+    if (p == piece::pawn) {
+      if (m.dst(en_passant)) {
+        const int captured = is_white ? to - 8 : to + 8;
+        them.erase(captured);
+        next.key ^= piece_key(!is_white, piece::pawn, captured);
+      } else if (std::abs(to - from) == 16) {
+        next.en_passant = uint64_t{1} << (from + to) / 2;
+      }
+    } else if (p == piece::king && std::abs(to - from) == 2) {
+      // The rook jumps from its corner to the square the king passed over.
+      const int rook_from = to < from ? from - 3 : from + 4, rook_to = (from + to) / 2;
+      us.erase(rook_from);
+      us.insert(rook_to, piece::rook);
+      next.key ^= piece_key(is_white, piece::rook, rook_from) ^
+                  piece_key(is_white, piece::rook, rook_to);
+    }
+
+    next.castling_rights &= ~chess_impl::lost_castling(m.src() | m.dst());
+    next.key ^= chess_impl::zobrist.castling[castling_rights] ^
+                chess_impl::zobrist.castling[next.castling_rights] ^
+                en_passant_key(en_passant) ^ en_passant_key(next.en_passant) ^
+                chess_impl::zobrist.black_to_move;
+    return next;
+  }
 
   /**
    * 1. Must not leave your king attacked after the move.
    * 2. Stalemate?
    */
   [[nodiscard]] constexpr std::optional<configuration> try_move(const piece p, const move m) const {
-    // TODO: escape if in check; otherwise, checkmate.
+    return try_move(p, m, king_safety(*this, m.src(white) != 0));
+  }
 
+  /**
+   * `try_move` given the `king_safety` of the side moving, so that trying many moves of one
+   * position works it out once rather than once a move.
+   */
+  [[nodiscard]] constexpr std::optional<configuration> try_move(const piece p, const move m,
+                                                                const king_safety &safety) const {
     // src must not be empty.
     if (!m.src(black) && !m.src(white)) {
       return std::nullopt;
@@ -230,15 +487,25 @@ public:
     if (!test_move(p, m)) {
       return std::nullopt;
     }
-    if (check(m.src(white))) {
+    const bool is_white = m.src(white) != 0;
+    assert(safety.king == std::countr_zero(get_side(is_white).bitboard(piece::king)));
+    if (m.from() == safety.king) {
+      // Off its square, the king no longer hides the squares behind it from a checking slider.
+      if (chess_impl::attackers(*this, m.to(), occupancy() ^ m.src(), !is_white)) {
+        return std::nullopt;
+      }
+    } else if (p == piece::pawn && m.dst(en_passant)) {
+      const configuration next = make_move(m);
+      return next.check(is_white) ? std::nullopt : std::optional(next);
+    } else if (!(safety.allowed(m.from()) & m.dst())) {
       return std::nullopt;
     }
 
-    const auto both_ends = m.src(m.dst());
-    return configuration{white, black}; // FIXME: update white and black
+    return make_move(m);
   }
 
   [[nodiscard]] constexpr bool test_move(const piece p, const move m) const {
+    const square src = std::countr_zero(m.src());
     switch (p) {
     case piece::pawn:
       // TODO: advancing 1 square
@@ -285,32 +552,16 @@ public:
         }
       }
       return true;
-    case piece::king: {
-      const auto [rank_diff, file_diff] = m.diff();
-      return std::max(::abs(rank_diff), std::abs(file_diff)) == 1; // max-norm
-    }
-    case piece::knight: {
-      const auto [rank_diff, file_diff] = m.diff();
-      return std::abs(rank_diff * file_diff) == 2;
-    }
+    case piece::king:
+      return king_attacks(src) & m.dst();
+    case piece::knight:
+      return knight_attacks(src) & m.dst();
     case piece::rook:
-      if (const auto path = m.cardinal_path()) {
-        return empty(m.src(*path)); // All squares between src and dst are empty.
-      }
-      return false;
+      return rook_attacks(src, occupancy()) & m.dst();
     case piece::bishop:
-      if (const auto path = m.ordinal_path()) {
-        return empty(m.src(*path)); // All squares between src and dst are empty.
-      }
-      return false;
+      return bishop_attacks(src, occupancy()) & m.dst();
     case piece::queen:
-      if (const auto path = m.cardinal_path()) {
-        return empty(m.src(*path)); // All squares between src and dst are empty.
-      }
-      if (const auto path = m.ordinal_path()) {
-        return empty(m.src(*path)); // All squares between src and dst are empty.
-      }
-      return false;
+      return queen_attacks(src, occupancy()) & m.dst();
     case piece::empty:
       return false;
     }
@@ -322,3 +573,134 @@ struct ply {
   configuration config;
   bool white_turn;
 };
+
+/**
+ * Parses Forsyth-Edwards Notation. The move clocks are optional and ignored; castling rights are
+ * dropped unless the king and rook are still on their initial squares.
+ */
+constexpr std::optional<ply> parse_fen(const std::string_view fen) {
+  std::array<std::string_view, 4> fields;
+  size_t n = 0;
+  for (const auto field : std::views::split(fen, ' ')) {
+    if (!std::ranges::empty(field) && n < fields.size()) {
+      fields[n++] = std::string_view(field);
+    }
+  }
+  if (n < fields.size()) {
+    return std::nullopt;
+  }
+  const auto [placement, active, castling_field, en_passant_field] = fields;
+
+  side white, black;
+  int rank = 7, file = 0;
+  for (const char c : placement) {
+    constexpr std::string_view pieces = " PRNBQK prnbqk";
+    if (c == '/' && file == 8 && rank > 0) {
+      --rank;
+      file = 0;
+    } else if ('1' <= c && c <= '8' && file + (c - '0') <= 8) {
+      file += c - '0';
+    } else if (const size_t p = pieces.find(c); c != ' ' && p != pieces.npos && file < 8) {
+      side &side = p < 7 ? white : black;
+      if (side.size() == 16) {
+        return std::nullopt;
+      }
+      side.insert(make_square(file++, rank), static_cast<piece>(p % 7));
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (rank != 0 || file != 8 || (active != "w" && active != "b") ||
+      !std::has_single_bit(white.bitboard(piece::king)) ||
+      !std::has_single_bit(black.bitboard(piece::king))) {
+    return std::nullopt;
+  }
+
+  configuration config(white, black);
+  config.castling_rights = 0;
+  constexpr std::string_view rights = "KQkq";
+  for (const char c : castling_field) {
+    if (const size_t i = rights.find(c); i != rights.npos) {
+      config.castling_rights |= 1 << i;
+    } else if (c != '-') {
+      return std::nullopt;
+    }
+  }
+  const auto home = [](const side &side, const uint64_t king, const uint64_t rook) {
+    return (side.bitboard(piece::king) & king) && (side.bitboard(piece::rook) & rook);
+  };
+  constexpr uint64_t e1 = 0x08, h1 = 0x01, a1 = 0x80;
+  config.castling_rights &= (home(white, e1, h1) ? castling::white_king : 0) |
+                            (home(white, e1, a1) ? castling::white_queen : 0) |
+                            (home(black, e1 << 56, h1 << 56) ? castling::black_king : 0) |
+                            (home(black, e1 << 56, a1 << 56) ? castling::black_queen : 0);
+
+  if (en_passant_field != "-") {
+    const auto target = parse_square(en_passant_field);
+    if (!target || rank_of(*target) != (active == "w" ? 5 : 2)) {
+      return std::nullopt;
+    }
+    config.en_passant = uint64_t{1} << *target;
+  }
+  config.key = config.compute_key(active == "w");
+  return ply{config, active == "w"};
+}
+
+/**
+ * Writes `p` in Forsyth-Edwards Notation to `out`, at most 85 characters, and returns the end.
+ * `configuration` keeps no move clocks: they are written as for a new game, "0 1".
+ */
+template <std::output_iterator<char> Out> constexpr Out format_fen(const ply &p, Out out) {
+  const configuration &config = p.config;
+  for (int rank = 7; rank >= 0; --rank) {
+    int empty = 0;
+    for (int file = 0; file < 8; ++file) {
+      const square s = make_square(file, rank);
+      const piece white = config.get_white().at(s), black = config.get_black().at(s);
+      if (white == piece::empty && black == piece::empty) {
+        ++empty;
+        continue;
+      }
+      if (empty) {
+        *out++ = static_cast<char>('0' + std::exchange(empty, 0));
+      }
+      *out++ = white != piece::empty ? " PRNBQK"[std::to_underlying(white)]
+                                     : " prnbqk"[std::to_underlying(black)];
+    }
+    if (empty) {
+      *out++ = static_cast<char>('0' + empty);
+    }
+    if (rank) {
+      *out++ = '/';
+    }
+  }
+  *out++ = ' ';
+  *out++ = p.white_turn ? 'w' : 'b';
+  *out++ = ' ';
+  if (!config.get_castling()) {
+    *out++ = '-';
+  }
+  for (int i = 0; i < 4; ++i) {
+    if (config.get_castling() >> i & 1) {
+      *out++ = "KQkq"[i];
+    }
+  }
+  *out++ = ' ';
+  if (const uint64_t en_passant = config.get_en_passant()) {
+    const square s = std::countr_zero(en_passant);
+    *out++ = static_cast<char>('a' + file_of(s));
+    *out++ = static_cast<char>('1' + rank_of(s));
+  } else {
+    *out++ = '-';
+  }
+  for (const char c : std::string_view(" 0 1")) {
+    *out++ = c;
+  }
+  return out;
+}
+
+constexpr std::string to_fen(const ply &p) {
+  std::string fen;
+  format_fen(p, std::back_inserter(fen));
+  return fen;
+}
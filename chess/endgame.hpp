@@ -0,0 +1,538 @@
+#pragma once
+#include "mapped_file.hpp"
+#include "notation.hpp"
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/** Endgame tables are made for up to this many pieces, kings included. */
+inline constexpr int endgame_max_pieces = 5;
+
+/** What an endgame table knows of a position, with the best play of both sides. */
+struct endgame_result {
+  int outcome; // 1 if the side to move mates, -1 if it is mated, 0 if neither can force it.
+  int plies;   // Until mate; 0 for a draw.
+
+  constexpr bool operator==(const endgame_result &) const = default;
+};
+
+/**
+ * The material of an endgame: the pieces besides the kings of the stronger side, which plays
+ * white in its table, and of the weaker. Each is a code of 4 bits per type counting its pieces,
+ * queens highest, so that the greater code is the stronger side, and equal codes equal sides.
+ */
+struct endgame_material {
+  uint32_t strong = 0, weak = 0;
+
+  /** The types of the code, from its highest 4 bits. */
+  static constexpr std::array types{piece::queen, piece::rook, piece::bishop, piece::knight,
+                                    piece::pawn};
+
+  static constexpr uint32_t code(const side &s) noexcept {
+    uint32_t c = 0;
+    for (const piece p : types) {
+      c = c << 4 | std::popcount(s.bitboard(p));
+    }
+    return c;
+  }
+  /** How many pieces of `types[i]` `code` counts. */
+  static constexpr int count(const uint32_t code, const size_t i) noexcept {
+    return code >> 4 * (types.size() - 1 - i) & 0xF;
+  }
+
+  [[nodiscard]] constexpr uint64_t key() const noexcept { return uint64_t{strong} << 32 | weak; }
+  [[nodiscard]] constexpr int pieces() const noexcept {
+    int n = 2;
+    for (size_t i = 0; i < types.size(); ++i) {
+      n += count(strong, i) + count(weak, i);
+    }
+    return n;
+  }
+  [[nodiscard]] constexpr bool has_pawns() const noexcept { return (strong | weak) & 0xF; }
+  /**
+   * The squares the strong king takes in the index: by symmetry, a triangle a1-d1-d4 of 10
+   * without pawns, and the files a to d with pawns, which forbid all but mirroring the files.
+   */
+  [[nodiscard]] constexpr int king_squares() const noexcept { return has_pawns() ? 32 : 10; }
+  /** Entries of the table: by side to move, strong king, then each other piece's square. */
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    return size_t{2} * king_squares() << 6 * (pieces() - 1);
+  }
+  /** As tables are named: "KRPvKR". */
+  [[nodiscard]] constexpr std::string name() const {
+    std::string text = "K";
+    for (const uint32_t c : {strong, weak}) {
+      for (size_t i = 0; i < types.size(); ++i) {
+        text.append(count(c, i), chess_impl::piece_letters[std::to_underlying(types[i])]);
+      }
+      if (c == strong) {
+        text += "vK";
+      }
+    }
+    return text;
+  }
+
+  constexpr bool operator==(const endgame_material &) const = default;
+};
+
+/**
+ * Every material of exactly `pieces` pieces, kings included, in the order to make their tables:
+ * without pawns first, then by more pawns, as promoting one leads to a table with one fewer.
+ */
+constexpr std::vector<endgame_material> endgame_materials(const int pieces) {
+  std::vector<uint32_t> codes{0}; // Of a side, with up to `pieces - 2` pieces.
+  for (size_t i = 0; i < endgame_material::types.size(); ++i) {
+    for (size_t j = 0, n = codes.size(); j < n; ++j) {
+      uint32_t c = codes[j];
+      for (int k = endgame_material{c}.pieces() + 1; k <= pieces; ++k) {
+        c += uint32_t{1} << 4 * (endgame_material::types.size() - 1 - i);
+        codes.push_back(c);
+      }
+    }
+  }
+  std::vector<endgame_material> materials;
+  for (int pawns = 0; pawns + 2 <= pieces; ++pawns) {
+    for (const uint32_t strong : codes) {
+      for (const uint32_t weak : codes) {
+        if (const endgame_material m{strong, weak}; weak <= strong && m.pieces() == pieces &&
+                                                    (strong & 0xF) + (weak & 0xF) == pawns) {
+          materials.push_back(m);
+        }
+      }
+    }
+  }
+  return materials;
+}
+
+namespace chess_impl {
+
+/** Squares the strong king takes in the index, and back. */
+struct endgame_king_slots {
+  std::array<int8_t, 64> slot;
+  std::array<int8_t, 32> square;
+};
+
+constexpr endgame_king_slots make_endgame_king_slots(const bool has_pawns) noexcept {
+  endgame_king_slots slots{};
+  slots.slot.fill(-1);
+  int n = 0;
+  for (int s = 0; s < 64; ++s) {
+    if (const int file = file_of(s), rank = rank_of(s);
+        file < 4 && (has_pawns || (rank < 4 && rank <= file))) {
+      slots.slot[s] = static_cast<int8_t>(n);
+      slots.square[n++] = static_cast<int8_t>(s);
+    }
+  }
+  return slots;
+}
+
+inline constexpr std::array endgame_kings{make_endgame_king_slots(false),
+                                          make_endgame_king_slots(true)};
+
+/** `s` with the ranks, the files or both mirrored by `flips`, then transposed if `transpose`. */
+constexpr int endgame_transform(const int s, const int flips, const bool transpose) noexcept {
+  const int t = s ^ flips;
+  return transpose ? (7 - (t & 7)) * 8 + 7 - (t >> 3) : t;
+}
+
+/**
+ * The table of the position and where in it: the side to move, the strong king, the weak king,
+ * then the other pieces of the strong side and of the weak, by type, then by square. Colors are
+ * swapped if black is stronger, and the board mirrored so that the strong king is in its slots:
+ * each position and its mirror images are one entry.
+ */
+constexpr std::pair<endgame_material, size_t> endgame_locate(const configuration &config,
+                                                             const bool is_white) noexcept {
+  const uint32_t white = endgame_material::code(config.get_white()),
+                 black = endgame_material::code(config.get_black());
+  const bool swapped = black > white;
+  const endgame_material material{swapped ? black : white, swapped ? white : black};
+  const side &strong = config.get_side(!swapped), &weak = config.get_side(swapped);
+
+  // Swapping colors mirrors the ranks too, so that the strong side's pawns still go up.
+  const int king = strong.get_king_square();
+  int flips = swapped ? 56 : 0;
+  flips ^= file_of(king ^ flips) >= 4 ? 7 : 0;
+  if (!material.has_pawns()) {
+    flips ^= rank_of(king ^ flips) >= 4 ? 56 : 0;
+  }
+  const auto index_of = [&](const bool transpose) {
+    const auto &slots = endgame_kings[material.has_pawns()];
+    size_t index = (swapped == is_white) * material.king_squares() +
+                   slots.slot[endgame_transform(king, flips, transpose)];
+    index = index << 6 | endgame_transform(weak.get_king_square(), flips, transpose);
+    for (const side *s : {&strong, &weak}) {
+      const uint32_t code = s == &strong ? material.strong : material.weak;
+      for (size_t t = 0; t < endgame_material::types.size(); ++t) {
+        if (endgame_material::count(code, t) == 0) {
+          continue;
+        }
+        std::array<int, endgame_max_pieces> group;
+        int n = 0;
+        chess_impl::for_each_square(s->bitboard(endgame_material::types[t]), [&](const square sq) {
+          group[n++] = endgame_transform(sq, flips, transpose);
+        });
+        if (n > 1) {
+          std::ranges::sort(group.begin(), group.begin() + n);
+        }
+        for (int i = 0; i < n; ++i) {
+          index = index << 6 | group[i];
+        }
+      }
+    }
+    return index;
+  };
+  // With the king on the diagonal, either side of it will do: the lesser entry is taken.
+  const int mirrored = king ^ flips;
+  size_t index;
+  if (material.has_pawns() || rank_of(mirrored) < file_of(mirrored)) {
+    index = index_of(false);
+  } else if (rank_of(mirrored) > file_of(mirrored)) {
+    index = index_of(true);
+  } else {
+    index = std::min(index_of(false), index_of(true));
+  }
+  return {material, index};
+}
+
+/**
+ * The position at `index` in the table of `material`, the strong side white; none if the squares
+ * are taken twice, out of order among pieces of a kind, hold pawns on the last ranks, or leave
+ * the side not to move in check, or if the position is another entry's mirror image.
+ */
+constexpr std::optional<ply> endgame_position(const endgame_material &material, size_t index) {
+  const size_t entry = index;
+  const int n = material.pieces();
+  std::array<int, endgame_max_pieces> squares;
+  for (int i = n - 1; i > 0; --i, index >>= 6) {
+    squares[i] = index & 63;
+  }
+  squares[0] = endgame_kings[material.has_pawns()].square[index % material.king_squares()];
+  const bool white_turn = index / material.king_squares() == 0;
+
+  side white, black;
+  white.insert(squares[0], piece::king);
+  if (squares[1] == squares[0]) {
+    return std::nullopt;
+  }
+  black.insert(squares[1], piece::king);
+  for (int i = 2; const bool is_white : {true, false}) {
+    for (size_t t = 0; t < endgame_material::types.size(); ++t) {
+      const piece p = endgame_material::types[t];
+      for (int k = 0; k < endgame_material::count(is_white ? material.strong : material.weak, t);
+           ++k, ++i) {
+        const int s = squares[i];
+        if (((white.get_occupancy() | black.get_occupancy()) >> s & 1) ||
+            (k > 0 && s < squares[i - 1]) ||
+            (p == piece::pawn && (rank_of(s) == 0 || rank_of(s) == 7))) {
+          return std::nullopt;
+        }
+        (is_white ? white : black).insert(s, p);
+      }
+    }
+  }
+  const configuration config = configuration::setup(white, black, white_turn);
+  if (king_safety(config, !white_turn).checkers ||
+      (rank_of(squares[0]) == file_of(squares[0]) &&
+       endgame_locate(config, white_turn).second != entry)) {
+    return std::nullopt;
+  }
+  return ply{config, white_turn};
+}
+
+/** Entries: 0 for a draw, else 1 more than the plies to mate, odd for mating; or no position. */
+inline constexpr uint8_t endgame_invalid = 255;
+
+constexpr uint8_t endgame_entry(const endgame_result result) noexcept {
+  assert(result.plies + 1 < endgame_invalid);
+  return result.outcome ? static_cast<uint8_t>(result.plies + 1) : 0;
+}
+constexpr endgame_result endgame_decode(const uint8_t entry) noexcept {
+  if (entry == 0) {
+    return {0, 0};
+  }
+  return {entry % 2 ? -1 : 1, entry - 1};
+}
+
+/** Where the piece `p` of the side `is_white` on `s` may have come from, without capturing. */
+constexpr uint64_t endgame_unmoves(const piece p, const bool is_white, const square s,
+                                   const uint64_t occupancy) noexcept {
+  switch (p) {
+  case piece::pawn: {
+    const int back = is_white ? -8 : 8, from = s + back;
+    if (from < 8 || from >= 56 || (occupancy >> from & 1)) {
+      return 0;
+    }
+    const bool double_step =
+        rank_of(s) == (is_white ? 3 : 4) && !(occupancy >> (from + back) & 1);
+    return uint64_t{1} << from | uint64_t{double_step} << (from + back);
+  }
+  case piece::rook:
+    return rook_attacks(s, occupancy) & ~occupancy;
+  case piece::knight:
+    return knight_attacks(s) & ~occupancy;
+  case piece::bishop:
+    return bishop_attacks(s, occupancy) & ~occupancy;
+  case piece::queen:
+    return queen_attacks(s, occupancy) & ~occupancy;
+  case piece::king:
+    return king_attacks(s) & ~occupancy;
+  case piece::empty:
+    return 0;
+  }
+  std::unreachable();
+}
+
+/**
+ * The entries, each once, of the positions of the same table from which a move that neither
+ * captures nor promotes leads to `position`.
+ */
+constexpr void endgame_parents(const ply &position, std::vector<size_t> &parents) {
+  parents.clear();
+  const bool is_white = !position.white_turn; // Who moved.
+  const side &us = position.config.get_side(is_white), &them = position.config.get_side(!is_white);
+  const uint64_t occupancy = position.config.occupancy();
+  for (const auto [p, to] : us) {
+    for_each_square(endgame_unmoves(p, is_white, to, occupancy), [&](const square from) {
+      side moved = us;
+      moved.erase(to);
+      moved.insert(from, p);
+      const configuration parent =
+          configuration::setup(is_white ? moved : them, is_white ? them : moved, is_white);
+      if (!king_safety(parent, !is_white).checkers) {
+        if (const size_t index = endgame_locate(parent, is_white).second;
+            std::ranges::find(parents, index) == parents.end()) {
+          parents.push_back(index);
+        }
+      }
+    });
+  }
+}
+
+} // namespace chess_impl
+
+/**
+ * Endgame tables, each mapped from a file and probed in place, with no parsing: the material
+ * of the position picks the table, and the squares of its pieces the entry. They hold the
+ * distance to mate of every position without castling rights nor en passant square.
+ */
+class endgame_tables {
+  std::vector<mapped_file> files;
+  std::unordered_map<uint64_t, std::span<const uint8_t>> tables; // By `endgame_material::key`.
+  int max_pieces = 2;
+
+  /** Saved layout: header, then the entries. */
+  struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t strong, weak;
+    char padding[40];
+  };
+  static constexpr char magic[8]{'c', 'c', 'c', 'e', 'g', 't', 'b', '\n'};
+  static constexpr uint32_t version = 1;
+  static constexpr uint32_t byte_order = 0x0102'0304;
+
+public:
+  /** The name of the file of the table of `material`. */
+  static std::string file_name(const endgame_material &material) {
+    return material.name() + ".egt";
+  }
+
+  /** Writes a table in the layout `load` expects; returns false on any I/O error. */
+  [[nodiscard]] static bool save(const int fd, const endgame_material &material,
+                                 const std::span<const uint8_t> entries) noexcept {
+    header h{.version = version,
+             .byte_order = byte_order,
+             .strong = material.strong,
+             .weak = material.weak,
+             .padding = {}};
+    std::ranges::copy(magic, h.magic);
+    const auto write_all = [fd](const void *data, size_t size) {
+      for (const auto *p = static_cast<const char *>(data); size != 0;) {
+        const ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+          return false;
+        }
+        p += n;
+        size -= n;
+      }
+      return true;
+    };
+    return write_all(&h, sizeof(h)) && write_all(entries.data(), entries.size());
+  }
+
+  /** Adds the table of `material`, which MUST outlive this: e.g. one just made. */
+  void add(const endgame_material &material, const std::span<const uint8_t> entries) {
+    assert(entries.size() == material.size());
+    tables[material.key()] = entries;
+    max_pieces = std::max(max_pieces, material.pieces());
+  }
+
+  /** Maps the tables `save` wrote to files in `directory`, skipping others; returns how many. */
+  size_t load(const char *directory) {
+    size_t loaded = 0;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end;
+         it.increment(error)) {
+      mapped_file file(it->path().c_str());
+      const std::u8string_view bytes = file.view();
+      header h;
+      if (bytes.size() < sizeof(h)) {
+        continue;
+      }
+      std::memcpy(&h, bytes.data(), sizeof(h));
+      const endgame_material material{h.strong, h.weak};
+      if (!std::ranges::equal(h.magic, magic) || h.version != version ||
+          h.byte_order != byte_order || material.pieces() > endgame_max_pieces ||
+          bytes.size() != sizeof(h) + material.size()) {
+        continue;
+      }
+      add(material, {reinterpret_cast<const uint8_t *>(bytes.data()) + sizeof(h), material.size()});
+      files.push_back(std::move(file));
+      ++loaded;
+    }
+    return loaded;
+  }
+
+  [[nodiscard]] bool contains(const endgame_material &material) const {
+    return tables.contains(material.key());
+  }
+
+  /**
+   * What the table of the position says, if there is one for it; bare kings are a draw without.
+   * Positions with castling rights, or with an en passant capture to make, are not in any.
+   */
+  [[nodiscard]] std::optional<endgame_result> probe(const configuration &config,
+                                                    const bool is_white) const {
+    const int pieces = std::popcount(config.occupancy());
+    const uint64_t en_passant = config.get_en_passant();
+    if (pieces > max_pieces || config.get_castling() ||
+        (en_passant && (pawn_attacks(!is_white, std::countr_zero(en_passant)) &
+                        config.get_side(is_white).bitboard(piece::pawn)))) {
+      return std::nullopt;
+    }
+    if (pieces == 2) {
+      return endgame_result{0, 0};
+    }
+    const auto [material, index] = chess_impl::endgame_locate(config, is_white);
+    const auto it = tables.find(material.key());
+    if (it == tables.end() || it->second[index] == chess_impl::endgame_invalid) {
+      return std::nullopt;
+    }
+    return chess_impl::endgame_decode(it->second[index]);
+  }
+};
+
+/**
+ * Works out the table of `material` by retrograde analysis. Mates are found first, and wins by
+ * captures and promotions into the tables they lead to, which MUST be in `tables`. Then, in order
+ * of plies to mate, the parents of each position decided are: won in one more ply if it is lost,
+ * else lost if all their moves now lead to positions won. A double step is taken to lead to the
+ * position without its en passant square, which with pawns on both sides overlooks the capture.
+ */
+inline std::vector<uint8_t> generate_endgame(const endgame_material &material,
+                                             const endgame_tables &tables) {
+  using namespace chess_impl;
+  constexpr uint8_t unknown = 0; // Until the end, when what is still unknown is a draw.
+  std::vector<uint8_t> entries(material.size(), endgame_invalid);
+  std::vector<bool> done(material.size()); // Whether the parents have been looked at.
+  std::array<std::vector<uint32_t>, endgame_invalid> decided; // By plies to mate.
+
+  // What is known of `position` from the start: mate, stalemate, or what captures and promotions
+  // lead to in other tables, the quickest win, else the slowest loss if all moves are those. The
+  // other moves stay in this table, where nothing is known yet, and are not even played.
+  const auto first_look = [&](const ply &position) -> std::optional<endgame_result> {
+    move_list moves;
+    generate_moves(position.config, position.white_turn, moves);
+    if (moves.empty()) {
+      return endgame_result{-(king_safety(position.config, position.white_turn).checkers != 0), 0};
+    }
+    const side &them = position.config.get_side(!position.white_turn);
+    int win = INT_MAX, loss = 0;
+    bool all_lost = true;
+    for (const move m : moves) {
+      if (them.at(m.to()) == piece::empty && m.get_promotion() == piece::empty) {
+        all_lost = false;
+        continue;
+      }
+      const auto result = tables.probe(position.config.make_move(m), !position.white_turn);
+      assert(result);
+      if (result->outcome < 0) {
+        win = std::min(win, result->plies + 1);
+      }
+      loss = std::max(loss, result->plies + 1);
+      all_lost &= result->outcome > 0;
+    }
+    if (win != INT_MAX) {
+      return endgame_result{1, win};
+    }
+    return all_lost ? std::optional(endgame_result{-1, loss}) : std::nullopt;
+  };
+  // The plies to mate if every move of `position` is known to lead to a position won.
+  const auto lost = [&](const ply &position) -> std::optional<int> {
+    move_list moves;
+    generate_moves(position.config, position.white_turn, moves);
+    int loss = 0;
+    for (const move m : moves) {
+      const configuration next = position.config.make_move(m);
+      std::optional<endgame_result> result;
+      if (const auto [child, index] = endgame_locate(next, !position.white_turn);
+          child != material) {
+        result = tables.probe(next, !position.white_turn);
+      } else if (entries[index] != unknown) {
+        result = endgame_decode(entries[index]);
+      }
+      if (!result || result->outcome <= 0) {
+        return std::nullopt;
+      }
+      loss = std::max(loss, result->plies + 1);
+    }
+    return loss;
+  };
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (endgame_position(material, i)) {
+      entries[i] = unknown;
+    }
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i] == unknown) {
+      if (const auto result = first_look(*endgame_position(material, i));
+          result && result->outcome) {
+        decided[result->plies].push_back(static_cast<uint32_t>(i));
+      }
+    }
+  }
+
+  std::vector<size_t> parents;
+  for (int plies = 0; plies + 1 < endgame_invalid; ++plies) {
+    const endgame_result result{plies % 2 ? 1 : -1, plies};
+    for (size_t k = 0; k < decided[plies].size(); ++k) {
+      const uint32_t i = decided[plies][k];
+      if (entries[i] == unknown) {
+        entries[i] = endgame_entry(result);
+      }
+      if (entries[i] != endgame_entry(result) || done[i]) {
+        continue; // Decided sooner, or already looked at.
+      }
+      done[i] = true;
+      endgame_parents(*endgame_position(material, i), parents);
+      for (const size_t parent : parents) {
+        if (entries[parent] != unknown) {
+          continue;
+        }
+        if (result.outcome < 0) {
+          entries[parent] = endgame_entry({1, plies + 1});
+          decided[plies + 1].push_back(static_cast<uint32_t>(parent));
+        } else if (const auto plies = lost(*endgame_position(material, parent))) {
+          decided[*plies].push_back(static_cast<uint32_t>(parent));
+        }
+      }
+    }
+  }
+  return entries;
+}
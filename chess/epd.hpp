@@ -0,0 +1,132 @@
+#pragma once
+#include "notation.hpp"
+#include "search.hpp"
+#include <mutex>
+
+/**
+ * A line of Extended Position Description: the first 4 fields of FEN, then operations such as
+ * `bm Nf3 e4; id "suite.001";`. Both views borrow from the line.
+ */
+struct epd {
+  ply position;
+  std::string_view operations;
+
+  /** The operands of the first operation `opcode`, quotes removed, or none if it has none. */
+  [[nodiscard]] constexpr std::optional<std::string_view>
+  operation(const std::string_view opcode) const noexcept {
+    for (size_t i = 0; i < operations.size();) {
+      i = operations.find_first_not_of(' ', i);
+      if (i == operations.npos) {
+        break;
+      }
+      const size_t name_end = std::min(operations.find_first_of(" ;", i), operations.size());
+      size_t end = name_end;
+      for (bool quoted = false; end < operations.size() && (quoted || operations[end] != ';');
+           ++end) {
+        quoted ^= operations[end] == '"';
+      }
+      if (operations.substr(i, name_end - i) == opcode) {
+        std::string_view operands = operations.substr(name_end, end - name_end);
+        operands.remove_prefix(std::min(operands.find_first_not_of(' '), operands.size()));
+        operands.remove_suffix(operands.size() - (operands.find_last_not_of(' ') + 1));
+        if (operands.size() >= 2 && operands.front() == '"' && operands.back() == '"') {
+          operands = operands.substr(1, operands.size() - 2);
+        }
+        return operands;
+      }
+      i = end + 1;
+    }
+    return std::nullopt;
+  }
+};
+
+/** Parses a line of EPD, or of FEN: the move clocks are then taken for operations and ignored. */
+constexpr std::optional<epd> parse_epd(const std::string_view line) {
+  size_t end = 0;
+  for (int field = 0; field < 4; ++field) {
+    const size_t start = line.find_first_not_of(' ', end);
+    if (start == line.npos) {
+      return std::nullopt;
+    }
+    end = std::min(line.find(' ', start), line.size());
+  }
+  const auto position = parse_fen(line.substr(0, end));
+  if (!position) {
+    return std::nullopt;
+  }
+  return epd{*position, line.substr(end)};
+}
+
+/** Whether `m` is among the moves `list` names, in SAN or coordinates, separated by spaces. */
+constexpr bool names_move(const ply &position, const std::string_view list, const move m) {
+  for (const auto word : std::views::split(list, ' ')) {
+    const std::string_view name(word);
+    if (!name.empty() && (parse_san(position.config, position.white_turn, name) == m ||
+                          parse_move(name) == m)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/** What a suite run found for one position. */
+struct suite_result {
+  search_report report; // Of the static evaluation, at depth 0 with no move, if not searched.
+  std::optional<bool> solved; // Whether the best move is one of `bm` and none of `am`, if given.
+};
+
+/**
+ * Evaluates each position of `suite` if `limits.depth` is 0, else searches it within `limits`,
+ * spread over `threads` threads: each searches its positions alone, with a table of `megabytes`
+ * cleared for each. `done` is called, one call at a time, as each position is done; the results
+ * come back in the order of `suite`.
+ */
+inline std::vector<suite_result>
+run_suite(const std::span<const epd> suite, const search_limits &limits, const unsigned threads,
+          const size_t megabytes,
+          const std::function<void(size_t, const suite_result &)> &done = {}) {
+  std::vector<suite_result> results(suite.size());
+  std::atomic<size_t> next = 0;
+  std::mutex mutex;
+  const auto work = [&] {
+    search_limits own = limits;
+    own.threads = 1;
+    std::optional<transposition_table> table;
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < suite.size();) {
+      const ply &position = suite[i].position;
+      const bool is_white = position.white_turn;
+      suite_result &result = results[i];
+      if (limits.depth == 0) {
+        const auto start = std::chrono::steady_clock::now();
+        const network *const net = limits.net;
+        result.report.score = net ? evaluate(*net, refresh(*net, position.config), is_white)
+                                  : evaluate(position.config, is_white);
+        result.report.nodes = 1;
+        result.report.elapsed = std::chrono::steady_clock::now() - start;
+      } else {
+        if (!table) {
+          table.emplace(megabytes);
+        }
+        table->clear();
+        result.report = search(position, own, *table);
+        const auto best = result.report.best();
+        const auto bm = suite[i].operation("bm"), am = suite[i].operation("am");
+        if (best && (bm || am)) {
+          result.solved = (!bm || names_move(position, *bm, *best)) &&
+                          (!am || !names_move(position, *am, *best));
+        }
+      }
+      if (done) {
+        const std::scoped_lock lock(mutex);
+        done(i, result);
+      }
+    }
+  };
+  std::vector<std::jthread> workers;
+  for (unsigned i = 1; i < std::max(threads, 1u); ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+  workers.clear();
+  return results;
+}
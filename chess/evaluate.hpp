@@ -0,0 +1,95 @@
+#pragma once
+#include "chess.hpp"
+
+/** Centipawns, by `piece`. The king's only matters for ordering captures by their attacker. */
+inline constexpr std::array<int, 7> piece_values{0, 100, 500, 320, 330, 900, 20'000};
+
+namespace chess_impl {
+
+// clang-format off
+/** Bonuses in centipawns by `piece` and square, for white, as the board is drawn from a8 to h1. */
+inline constexpr std::array<std::array<int8_t, 64>, 7> piece_square_bonuses{{
+    {},
+    { // Pawn: forward, and to the centre.
+       0,   0,   0,   0,   0,   0,   0,   0,
+      50,  50,  50,  50,  50,  50,  50,  50,
+      10,  10,  20,  30,  30,  20,  10,  10,
+       5,   5,  10,  25,  25,  10,   5,   5,
+       0,   0,   0,  20,  20,   0,   0,   0,
+       5,  -5, -10,   0,   0, -10,  -5,   5,
+       5,  10,  10, -20, -20,  10,  10,   5,
+       0,   0,   0,   0,   0,   0,   0,   0},
+    { // Rook: the seventh rank, and the centre files from the first.
+       0,   0,   0,   0,   0,   0,   0,   0,
+       5,  10,  10,  10,  10,  10,  10,   5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+       0,   0,   0,   5,   5,   0,   0,   0},
+    { // Knight: away from the rim.
+     -50, -40, -30, -30, -30, -30, -40, -50,
+     -40, -20,   0,   0,   0,   0, -20, -40,
+     -30,   0,  10,  15,  15,  10,   0, -30,
+     -30,   5,  15,  20,  20,  15,   5, -30,
+     -30,   0,  15,  20,  20,  15,   0, -30,
+     -30,   5,  10,  15,  15,  10,   5, -30,
+     -40, -20,   0,   5,   5,   0, -20, -40,
+     -50, -40, -30, -30, -30, -30, -40, -50},
+    { // Bishop: long diagonals, out of the corners.
+     -20, -10, -10, -10, -10, -10, -10, -20,
+     -10,   0,   0,   0,   0,   0,   0, -10,
+     -10,   0,   5,  10,  10,   5,   0, -10,
+     -10,   5,   5,  10,  10,   5,   5, -10,
+     -10,   0,  10,  10,  10,  10,   0, -10,
+     -10,  10,  10,  10,  10,  10,  10, -10,
+     -10,   5,   0,   0,   0,   0,   5, -10,
+     -20, -10, -10, -10, -10, -10, -10, -20},
+    { // Queen: a little towards the centre.
+     -20, -10, -10,  -5,  -5, -10, -10, -20,
+     -10,   0,   0,   0,   0,   0,   0, -10,
+     -10,   0,   5,   5,   5,   5,   0, -10,
+      -5,   0,   5,   5,   5,   5,   0,  -5,
+       0,   0,   5,   5,   5,   5,   0,  -5,
+     -10,   5,   5,   5,   5,   5,   0, -10,
+     -10,   0,   5,   0,   0,   0,   0, -10,
+     -20, -10, -10,  -5,  -5, -10, -10, -20},
+    { // King: castled, behind its pawns; there is no endgame table.
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -20, -30, -30, -40, -40, -30, -30, -20,
+     -10, -20, -20, -20, -20, -20, -20, -10,
+      20,  20,   0,   0,   0,   0,  20,  20,
+      20,  30,  10,   0,   0,  10,  30,  20},
+}};
+// clang-format on
+
+} // namespace chess_impl
+
+/**
+ * What `p` of the side `is_white` on `s` is worth in centipawns: its material, kings excepted,
+ * plus the bonus for where it stands. The tables are drawn for white; black's are mirrored.
+ */
+constexpr int piece_square_value(const piece p, const bool is_white, const square s) noexcept {
+  const int drawn = 63 - static_cast<int>(is_white ? s : s ^ 56);
+  return (p == piece::king ? 0 : piece_values[std::to_underlying(p)]) +
+         chess_impl::piece_square_bonuses[std::to_underlying(p)][drawn];
+}
+
+/**
+ * Material and piece-square tables in centipawns, from the point of view of the side `is_white`:
+ * the scalar evaluation, used when the search has no network.
+ */
+constexpr int evaluate(const configuration &config, const bool is_white) noexcept {
+  int score = 0;
+  for (const auto [p, s] : config.get_white()) {
+    score += piece_square_value(p, true, s);
+  }
+  for (const auto [p, s] : config.get_black()) {
+    score -= piece_square_value(p, false, s);
+  }
+  return is_white ? score : -score;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Waits for input, terminal resizes and wakeups from other threads all at once, with epoll. Input
+ * is read in batches: all that has arrived, up to the size of the buffer, in a single `read` that
+ * epoll said would not block. `SIGWINCH` arrives through a signalfd, and `notify`, from any
+ * thread, through an eventfd. The signal is blocked from construction on, in the constructing
+ * thread and the threads it starts later: construct the loop before any of them.
+ */
+class event_loop {
+  int input, epoll = -1, signals = -1, wakeup = -1;
+  sigset_t resize{}, previous{};
+  std::vector<char> buffer;
+
+  [[nodiscard]] bool watch(const int fd) const noexcept {
+    epoll_event event{.events = EPOLLIN, .data = {.fd = fd}};
+    return epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+  }
+
+  void close_all() noexcept {
+    for (int *const fd : {&epoll, &signals, &wakeup}) {
+      if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+      }
+    }
+  }
+
+public:
+  /** What happened since the last call to `wait`. */
+  struct events {
+    std::string_view input;  // Valid until the next call to `wait`.
+    bool closed = false;     // The end of input, or an error reading it: it is watched no more.
+    bool resized = false;
+    uint64_t notified = 0;   // Calls to `notify`.
+    bool timed_out = false;  // Nothing else happened in time.
+  };
+
+  /** Watches `input`, reading it `buffer_size` bytes at most at a time; falsy on failure. */
+  explicit event_loop(const int input, const size_t buffer_size = 4096)
+      : input(input), buffer(buffer_size) {
+    sigemptyset(&resize);
+    sigaddset(&resize, SIGWINCH);
+    if (pthread_sigmask(SIG_BLOCK, &resize, &previous) != 0) {
+      return;
+    }
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    signals = signalfd(-1, &resize, SFD_NONBLOCK | SFD_CLOEXEC);
+    wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll < 0 || signals < 0 || wakeup < 0 || !watch(input) || !watch(signals) ||
+        !watch(wakeup)) {
+      close_all();
+    }
+  }
+
+  event_loop(const event_loop &) = delete;
+  event_loop &operator=(const event_loop &) = delete;
+  ~event_loop() {
+    close_all();
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  }
+
+  [[nodiscard]] explicit operator bool() const noexcept { return epoll >= 0; }
+
+  /** Wakes up `wait`, from any thread. */
+  void notify() const noexcept {
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeup, &one, sizeof one);
+  }
+
+  /** Waits for anything to happen, for `timeout` at most if any. */
+  events wait(const std::optional<std::chrono::milliseconds> timeout = std::nullopt) {
+    events result;
+    epoll_event ready[3];
+    int count;
+    do {
+      count = epoll_wait(epoll, ready, std::size(ready), timeout ? timeout->count() : -1);
+    } while (count < 0 && errno == EINTR);
+    result.timed_out = count == 0;
+    for (const epoll_event &event : ready | std::views::take(std::max(count, 0))) {
+      if (event.data.fd == input) {
+        ssize_t n;
+        do {
+          n = read(input, buffer.data(), buffer.size());
+        } while (n < 0 && errno == EINTR);
+        if (n > 0) {
+          result.input = {buffer.data(), static_cast<size_t>(n)};
+        } else {
+          result.closed = true;
+          epoll_ctl(epoll, EPOLL_CTL_DEL, input, nullptr);
+        }
+      } else if (event.data.fd == signals) {
+        for (signalfd_siginfo info; read(signals, &info, sizeof info) == sizeof info;) {
+          result.resized = true;
+        }
+      } else if (uint64_t n; read(wakeup, &n, sizeof n) == sizeof n) {
+        result.notified = n;
+      }
+    }
+    return result;
+  }
+};
@@ -1,83 +1,51 @@
-#include "ansi.hpp"
-#include "chess.hpp"
+#include "event_loop.hpp"
+#include "screen.hpp"
+#include "uci.hpp"
 #include <csignal>
 #include <iostream>
+#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 
-class colored_piece {
-  const char *glyph;
-  ansi::fg fg;
+// [Full-width characters](https://stackoverflow.com/a/8327034), by color then `piece`.
+constexpr std::array<std::array<std::string_view, 7>, 2> full_width_latin{{
+    {"　", "ｐ", "ｒ", "ｎ", "ｂ", "ｑ", "ｋ"},
+    {"　", "Ｐ", "Ｒ", "Ｎ", "Ｂ", "Ｑ", "Ｋ"},
+}};
 
-  static constexpr std::array fgcolors{
-      ansi::fg::bright(ansi::color::green),
-      ansi::fg::bright(ansi::color::white),
-  };
-
-  // [Full-width characters](https://stackoverflow.com/a/8327034)
-  static constexpr const char *full_width_latin(const piece piece, const bool is_white) noexcept {
-    switch (piece) {
-    case piece::empty:
-      return "　";
-    case piece::pawn:
-      return is_white ? "Ｐ" : "ｐ";
-    case piece::rook:
-      return is_white ? "Ｒ" : "ｒ";
-    case piece::knight:
-      return is_white ? "Ｎ" : "ｎ";
-    case piece::bishop:
-      return is_white ? "Ｂ" : "ｂ";
-    case piece::queen:
-      return is_white ? "Ｑ" : "ｑ";
-    case piece::king:
-      return is_white ? "Ｋ" : "ｋ";
-    }
-  }
-
-public:
-  constexpr colored_piece(const piece piece, const bool is_white) noexcept
-      : glyph(full_width_latin(piece, is_white)), fg(fgcolors[is_white]) {}
-
-  friend std::ostream &operator<<(std::ostream &os, const colored_piece &cp) {
-    return os << cp.fg << cp.glyph;
-  }
+/** Where the keys typed so far point: a file, then a rank, both from 1; 0 for none yet. */
+struct coordinates {
+  int file, rank;
 };
 
-// https://askubuntu.com/a/558422
-std::ostream &operator<<(std::ostream &os, const configuration &config) {
-  static_assert(std::to_underlying(piece::empty) == 0);
-  std::array<piece, 64> board{};
-  static_assert(~square{0} == 63);
-  static_assert(~square{1} == 0b111'110);
-  static_assert(~square{0b100'110} == 0b011'001);
-  static_assert(~square{63} == 0);
-  for (const auto [piece, shift] : config.get_white()) {
-    board[~shift] = piece;
-  }
-  for (const auto [piece, shift] : config.get_black()) {
-    board[~shift] = piece;
+/** Draws the board framed by its coordinates, the square `selected` highlighted if any. */
+void draw(ansi::screen &frame, const configuration &config, const coordinates selected) {
+  constexpr uint8_t hint_fg = ansi::fg_code(ansi::color::black, true);
+  constexpr std::array piece_fg{ansi::fg_code(ansi::color::green, true),
+                                ansi::fg_code(ansi::color::white, true)};
+  constexpr std::array<std::string_view, 10> file_hint{"　", "ａ", "ｂ", "ｃ", "ｄ",
+                                                       "ｅ", "ｆ", "ｇ", "ｈ", "　"};
+  constexpr std::array<std::string_view, 8> rank_hint{"１", "２", "３", "４",
+                                                      "５", "６", "７", "８"};
+  for (int i = 0; i < 10; ++i) {
+    frame.put(0, i * 2, file_hint[i], 2, hint_fg, ansi::default_bg);
+    frame.put(9, i * 2, file_hint[i], 2, hint_fg, ansi::default_bg);
   }
-  constexpr auto file_hint{"　ａｂｃｄｅｆｇｈ　"};
-  constexpr auto bgcolors = std::views::repeat(std::array{
-                                ansi::bg::bright(ansi::color::blue),
-                                ansi::bg(ansi::color::blue),
-                            }) |
-                            std::views::join;
-  auto bgcolor = std::ranges::begin(bgcolors);
-  constexpr auto hint_color = ansi::sgr(ansi::style::reset, ansi::fg::bright(ansi::color::black));
-  os << hint_color << file_hint << "\r\n";
-  auto pos = uint64_t{1} << ~square{0};
-  auto square = board.cbegin();
-  for (const auto rank : {"８", "７", "６", "５", "４", "３", "２", "１"}) {
-    os << rank;
-    for (const auto _ : std::views::iota(0, 8)) {
-      os << *bgcolor++ << colored_piece(*square++, pos & config.get_white().get_occupancy());
-      pos >>= 1;
+  for (int rank = 0; rank < 8; ++rank) {
+    const int row = 8 - rank;
+    frame.put(row, 0, rank_hint[rank], 2, hint_fg, ansi::default_bg);
+    frame.put(row, 18, rank_hint[rank], 2, hint_fg, ansi::default_bg);
+    for (int file = 0; file < 8; ++file) {
+      const square s = make_square(file, rank);
+      const bool is_white = config.get_white().at(s) != piece::empty;
+      const piece p = config.get_side(is_white).at(s);
+      const uint8_t bg = selected.file == file + 1 && selected.rank == rank + 1
+                             ? ansi::bg_code(ansi::color::yellow)
+                             : ansi::bg_code(ansi::color::blue, (file + rank) % 2 == 1);
+      frame.put(row, file * 2 + 2, full_width_latin[is_white][std::to_underlying(p)], 2,
+                piece_fg[is_white], bg);
     }
-    os << hint_color << rank << "\r\n";
-    ++bgcolor;
   }
-  return os << file_hint << ansi::style::reset;
 }
 
 // Note that tcsetattr() returns success if any of the requested changes could be successfully
@@ -98,7 +66,9 @@ void noecho() {
   assert(tcgetattr(STDIN_FILENO, &t) == 0);
   static const auto initial_termios = t;
   std::atexit([] {
-    std::cout << ansi::cursor_position(11, 1) << std::flush;
+    // The renderer leaves its last colors set and maybe the cursor hidden.
+    std::cout << ansi::style::reset << ansi::cursor_show << ansi::cursor_position(12, 1)
+              << std::flush;
     assert_tcsetattr(STDIN_FILENO, TCSAFLUSH, initial_termios);
   });
   cfmakeraw(&t);
@@ -118,45 +88,112 @@ void noecho() {
   }
 }
 
-struct coordinates {
-  int file, rank;
-};
-
-std::ostream &operator<<(std::ostream &os, const coordinates &coord) {
-  return os << ansi::cursor_position(10 - coord.rank, coord.file * 2 + 1);
+/** The columns of the terminal at `fd`, if it is one. */
+std::optional<int> terminal_cols(const int fd) {
+  winsize size{};
+  return ioctl(fd, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 ? std::optional<int>(size.ws_col)
+                                                             : std::nullopt;
 }
 
+/**
+ * Redraws the board as keys select a square, a frame at a time, each in a single `write`. Space
+ * starts and stops analysing the position on a thread of its own, its last report shown under the
+ * board as it comes and the time spent ticking meanwhile.
+ */
 void loop() {
+  constexpr configuration config;
+  event_loop events(STDIN_FILENO);
+  assert(events);
+  const auto make_frame = [] {
+    return ansi::screen(11, std::max(terminal_cols(STDOUT_FILENO).value_or(80), 20));
+  };
+  ansi::screen frame = make_frame();
+  ansi::renderer renderer(frame.rows(), frame.cols());
   coordinates coord(0, 0);
-  for (char ch = '\0'; read(STDIN_FILENO, &ch, 1) == 1;) {
-    if ('a' <= ch && ch <= 'h') {
-      if (coord.rank == 0) {
-        coord.file = ch - 'a' + 1;
-        std::cout << ansi::cursor_show << coord << std::flush;
-      }
-    } else if ('1' <= ch && ch <= '8') {
-      if (coord.file != 0) {
-        coord.rank = ch - '1' + 1;
-        std::cout << coord << std::flush;
-      }
-    } else {
-      switch (ch) {
-      case '\n':
-        break;
-      case '\033':
+
+  transposition_table table(16);
+  std::mutex mutex;
+  std::string analysis; // The last report, from the searching thread.
+  std::optional<std::chrono::steady_clock::time_point> analysing_since;
+  std::jthread analysing; // Last, so that it stops first.
+
+  const auto show = [&] {
+    frame.clear();
+    draw(frame, config, coord);
+    if (analysing_since) {
+      char elapsed[24];
+      const auto tenths = (std::chrono::steady_clock::now() - *analysing_since) /
+                          std::chrono::milliseconds(100);
+      const int n = std::snprintf(elapsed, sizeof elapsed, "%lld.%llds ",
+                                  static_cast<long long>(tenths / 10),
+                                  static_cast<long long>(tenths % 10));
+      frame.print(10, 0, {elapsed, static_cast<size_t>(n)}, ansi::default_fg, ansi::default_bg);
+      const std::lock_guard lock(mutex);
+      frame.print(10, n, analysis, ansi::default_fg, ansi::default_bg);
+    }
+    renderer.present(STDOUT_FILENO, frame,
+                     coord.file ? std::optional(std::pair(9 - coord.rank, coord.file * 2))
+                                : std::nullopt);
+  };
+  const auto toggle_analysis = [&] {
+    if (analysing_since) {
+      analysing = {};
+      analysing_since.reset();
+      return;
+    }
+    analysis.clear();
+    analysing_since = std::chrono::steady_clock::now();
+    analysing = std::jthread([&](const std::stop_token stop) {
+      table.clear();
+      search(
+          {config, true}, {}, table, {},
+          [&](const search_report &report) {
+            const std::string info = uci_info(report);
+            {
+              const std::lock_guard lock(mutex);
+              analysis = info.substr(std::string_view("info ").size());
+            }
+            events.notify();
+          },
+          stop);
+    });
+  };
+
+  show();
+  for (;;) {
+    // While analysing, the clock ticks every tenth of a second.
+    const event_loop::events happened =
+        events.wait(analysing_since ? std::optional(std::chrono::milliseconds(100))
+                                    : std::nullopt);
+    if (happened.closed) {
+      break;
+    }
+    if (happened.resized) {
+      frame = make_frame();
+      renderer = ansi::renderer(frame.rows(), frame.cols());
+      std::cout << ansi::clear_screen << std::flush;
+    }
+    for (const char ch : happened.input) {
+      if ('a' <= ch && ch <= 'h') {
+        if (coord.rank == 0) {
+          coord.file = ch - 'a' + 1;
+        }
+      } else if ('1' <= ch && ch <= '8') {
+        if (coord.file != 0) {
+          coord.rank = ch - '1' + 1;
+        }
+      } else if (ch == '\033') {
         coord.file = coord.rank = 0;
-        std::cout << ansi::cursor_hide << std::flush;
-        break;
+      } else if (ch == ' ') {
+        toggle_analysis();
       }
     }
+    show();
   }
 }
 
 int main() {
-  std::cin.tie(nullptr)->sync_with_stdio(false);
   noecho();
-
-  constexpr configuration config;
-  std::cout << ansi::hard_clear_screen << ansi::cursor_hide << config << std::flush;
+  std::cout << ansi::hard_clear_screen << std::flush;
   loop();
 }
@@ -0,0 +1,38 @@
+#include "book.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Usage: make_book games.pgn book.bin [plies=16] [min games=2] [threads=all cores]
+ *
+ * Writes to `book.bin` the opening book of the PGN database `games.pgn`: the moves of the first
+ * `plies` plies played in at least `min games` games, weighed by how they went. Prints the totals
+ * as `key=value` pairs.
+ */
+int main(const int argc, const char *argv[]) {
+  if (argc < 3) {
+    std::fprintf(stderr, "usage: %s games.pgn book.bin [plies] [min games] [threads]\n", argv[0]);
+    return 2;
+  }
+  const mapped_file file(argv[1]);
+  if (!file) {
+    std::perror(argv[1]);
+    return 2;
+  }
+  file.advise(MADV_SEQUENTIAL);
+  const int plies = argc > 3 ? std::max(std::atoi(argv[3]), 0) : 16;
+  const uint64_t min_games = argc > 4 ? std::max(std::strtoull(argv[4], nullptr, 10), 1ull) : 2;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned threads = argc > 5 ? std::max(std::atoi(argv[5]), 1) : cores;
+
+  const position_counter counter = import_pgn(file.view(), threads, plies);
+  const std::vector<book_entry> book = make_book(counter.positions, plies, min_games);
+  const int fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || !save_book(fd, book) || close(fd) != 0) {
+    std::perror(argv[2]);
+    return 1;
+  }
+  std::printf("make_book version=1 games=%llu positions=%zu entries=%zu plies=%d min_games=%llu\n",
+              static_cast<unsigned long long>(counter.games), counter.positions.size(), book.size(),
+              plies, static_cast<unsigned long long>(min_games));
+}
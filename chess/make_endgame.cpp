@@ -0,0 +1,109 @@
+#include "endgame.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+
+/**
+ * Usage: make_endgame directory [pieces=3] [threads=all cores]
+ *
+ * Makes the endgame tables of up to `pieces` pieces, kings included, into `directory`, created if
+ * need be: a file per material, named after it, e.g. `KRvK.egt`. Tables already there are used
+ * rather than made again. Those that do not depend on one another are made at the same time, on
+ * `threads` threads. Prints a line per table made as `key=value` pairs, with its longest mate.
+ */
+int main(const int argc, const char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s directory [pieces] [threads]\n", argv[0]);
+    return 2;
+  }
+  const char *const directory = argv[1];
+  const int pieces = argc > 2 ? std::clamp(std::atoi(argv[2]), 3, endgame_max_pieces) : 3;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned threads = argc > 3 ? std::max(std::atoi(argv[3]), 1) : cores;
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+    std::perror(directory);
+    return 1;
+  }
+  endgame_tables tables;
+  const size_t found = tables.load(directory);
+  std::printf("make_endgame version=1 directory=%s pieces=%d threads=%u found=%zu\n", directory,
+              pieces, threads, found);
+  std::fflush(stdout);
+
+  std::vector<std::vector<uint8_t>> made; // Kept for the tables that need them.
+  const auto pawns = [](const endgame_material &m) { return (m.strong & 0xF) + (m.weak & 0xF); };
+  for (int n = 3; n <= pieces; ++n) {
+    const std::vector<endgame_material> all = endgame_materials(n);
+    // Materials with as many pawns depend on none of each other, and are made together.
+    for (auto first = all.begin(); first != all.end();) {
+      const auto last = std::find_if(first, all.end(), [&](const endgame_material &m) {
+        return pawns(m) != pawns(*first);
+      });
+      std::vector<endgame_material> level;
+      std::copy_if(first, last, std::back_inserter(level),
+                   [&](const endgame_material &m) { return !tables.contains(m); });
+      first = last;
+
+      std::vector<std::vector<uint8_t>> entries(level.size());
+      std::atomic<size_t> next = 0, failed = 0;
+      const auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < level.size();) {
+          const auto start = std::chrono::steady_clock::now();
+          entries[i] = generate_endgame(level[i], tables);
+          const double seconds =
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+          const std::string path =
+              std::string(directory) + "/" + endgame_tables::file_name(level[i]);
+          const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+          if (fd < 0 || !endgame_tables::save(fd, level[i], entries[i]) || close(fd) != 0) {
+            std::perror(path.c_str());
+            failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+          }
+          size_t positions = 0, wins = 0, losses = 0, longest = 0;
+          int plies = 0;
+          for (size_t j = 0; j < entries[i].size(); ++j) {
+            if (entries[i][j] == chess_impl::endgame_invalid) {
+              continue;
+            }
+            const endgame_result result = chess_impl::endgame_decode(entries[i][j]);
+            ++positions;
+            wins += result.outcome > 0;
+            losses += result.outcome < 0;
+            if (result.outcome > 0 && result.plies > plies) {
+              longest = j;
+              plies = result.plies;
+            }
+          }
+          const auto position = chess_impl::endgame_position(level[i], longest);
+          std::printf("table=%s positions=%zu wins=%zu draws=%zu losses=%zu longest=%d fen=\"%s\" "
+                      "seconds=%.3f\n",
+                      level[i].name().c_str(), positions, wins, positions - wins - losses, losses,
+                      plies, plies && position ? to_fen(*position).c_str() : "-", seconds);
+          std::fflush(stdout);
+        }
+      };
+      {
+        std::vector<std::jthread> workers;
+        for (unsigned i = 1; i < threads; ++i) {
+          workers.emplace_back(work);
+        }
+        work();
+      }
+      if (failed) {
+        return 1;
+      }
+      for (size_t i = 0; i < level.size(); ++i) {
+        made.push_back(std::move(entries[i]));
+        tables.add(level[i], made.back());
+      }
+    }
+  }
+}
@@ -0,0 +1,22 @@
+#include "nnue.hpp"
+#include <cstdio>
+#include <fcntl.h>
+
+/**
+ * Usage: make_network path
+ *
+ * Writes the network of the piece-square tables to `path`, for the search to map and use in
+ * place of them. A trained network in the same format would play better.
+ */
+int main(const int argc, const char *argv[]) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s path\n", argv[0]);
+    return 2;
+  }
+  static constexpr network net = make_piece_square_network();
+  const int fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || !net.save(fd) || close(fd) != 0) {
+    std::perror(argv[1]);
+    return 1;
+  }
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "board.hpp"
+
+/** A fixed-capacity list of moves, meant to live on the stack: no position has more than 218. */
+class move_list {
+  std::array<move, 256> moves;
+  size_t count = 0;
+
+public:
+  constexpr void push_back(const move m) noexcept {
+    assert(count < moves.size());
+    moves[count++] = m;
+  }
+  constexpr void clear() noexcept { count = 0; }
+  /** Keeps the first `n` moves, which MUST be no more than there are. */
+  constexpr void resize(const size_t n) noexcept {
+    assert(n <= count);
+    count = n;
+  }
+  constexpr void swap(const size_t i, const size_t j) noexcept { std::swap(moves[i], moves[j]); }
+
+  [[nodiscard]] constexpr size_t size() const noexcept { return count; }
+  [[nodiscard]] constexpr bool empty() const noexcept { return count == 0; }
+  [[nodiscard]] constexpr const move &operator[](const size_t i) const noexcept {
+    return moves[i];
+  }
+  [[nodiscard]] constexpr const move *begin() const noexcept { return moves.data(); }
+  [[nodiscard]] constexpr const move *end() const noexcept { return moves.data() + count; }
+};
+
+namespace chess_impl {
+
+/** Calls `f(s)` for each square `s` in `squares`. */
+template <typename F> constexpr void for_each_square(uint64_t squares, F &&f) {
+  for (; squares != 0; squares &= squares - 1) {
+    f(static_cast<square>(std::countr_zero(squares)));
+  }
+}
+
+} // namespace chess_impl
+
+/**
+ * Appends every legal move of the side `is_white` to `moves`. Rather than playing each move and
+ * testing whether it leaves the king attacked, moves are confined up front: in check, to capturing
+ * the checker or blocking it; when pinned, to the line through the king and the pinner. Only king
+ * moves and en passant, which can uncover an attack on the rank it vacates, look any further.
+ * `Position` is a `configuration` or a `board`.
+ */
+template <typename Position>
+constexpr void generate_moves(const Position &config, const bool is_white, move_list &moves) {
+  using chess_impl::for_each_square;
+  const auto &us = config.get_side(is_white);
+  const auto &them = config.get_side(!is_white);
+  const uint64_t ours = us.get_occupancy(), theirs = them.get_occupancy();
+  const uint64_t occupancy = ours | theirs;
+  const king_safety safety(config, is_white);
+  const square king_square = safety.king;
+  const uint64_t checkers = safety.checkers;
+
+  // Without the king in the way, a slider checking along a ray also attacks the square behind.
+  for_each_square(king_attacks(king_square) & ~ours, [&](const square to) {
+    if (!chess_impl::attackers(config, to, occupancy ^ uint64_t{1} << king_square, !is_white)) {
+      moves.push_back(move(king_square, to));
+    }
+  });
+  if (std::popcount(checkers) > 1) {
+    return; // Only the king can escape a double check.
+  }
+  const uint64_t targets = ~ours & safety.evasions;
+  const uint64_t pinned = safety.pinned;
+  const auto allowed = [&](const square from) { return ~ours & safety.allowed(from); };
+  const uint64_t their_queens = them.bitboard(piece::queen);
+
+  for_each_square(us.bitboard(piece::knight) & ~pinned, [&](const square from) {
+    for_each_square(knight_attacks(from) & targets,
+                    [&](const square to) { moves.push_back({from, to}); });
+  });
+  const uint64_t queens = us.bitboard(piece::queen);
+  for_each_square(us.bitboard(piece::bishop) | queens, [&](const square from) {
+    for_each_square(bishop_attacks(from, occupancy) & allowed(from),
+                    [&](const square to) { moves.push_back({from, to}); });
+  });
+  for_each_square(us.bitboard(piece::rook) | queens, [&](const square from) {
+    for_each_square(rook_attacks(from, occupancy) & allowed(from),
+                    [&](const square to) { moves.push_back({from, to}); });
+  });
+
+  constexpr uint64_t rank3 = 0x0000'0000'00FF'0000, rank6 = 0x0000'FF00'0000'0000;
+  constexpr uint64_t last_ranks = 0xFF00'0000'0000'00FF;
+  const auto advance = [is_white](const uint64_t squares) {
+    return is_white ? squares << 8 : squares >> 8;
+  };
+  const auto push_pawn_moves = [&moves](const square from, const square to) {
+    if (uint64_t{1} << to & last_ranks) {
+      for (const piece p : {piece::queen, piece::rook, piece::bishop, piece::knight}) {
+        moves.push_back({from, to, p});
+      }
+    } else {
+      moves.push_back({from, to});
+    }
+  };
+  const uint64_t en_passant = config.get_en_passant();
+  for_each_square(us.bitboard(piece::pawn), [&](const square from) {
+    const uint64_t pawn = uint64_t{1} << from;
+    const uint64_t single = advance(pawn) & ~occupancy;
+    const uint64_t twice = advance(single & (is_white ? rank3 : rank6)) & ~occupancy;
+    const uint64_t captures = pawn_attacks(is_white, from);
+    for_each_square((single | twice | (captures & theirs)) & allowed(from),
+                    [&](const square to) { push_pawn_moves(from, to); });
+
+    if (captures & en_passant) {
+      // The captured pawn is not on the square taken, so test the king directly.
+      const uint64_t captured = is_white ? en_passant >> 8 : en_passant << 8;
+      const uint64_t after = occupancy ^ pawn ^ en_passant ^ captured;
+      const uint64_t sliders = (rook_attacks(king_square, after) &
+                                (them.bitboard(piece::rook) | their_queens)) |
+                               (bishop_attacks(king_square, after) &
+                                (them.bitboard(piece::bishop) | their_queens));
+      if ((en_passant & targets || captured & checkers) && !sliders) {
+        moves.push_back({from, static_cast<square>(std::countr_zero(en_passant))});
+      }
+    }
+  });
+
+  // Castling: neither the king nor the squares it passes through or lands on may be attacked.
+  const uint8_t rights = config.get_castling() >> (is_white ? 0 : 2);
+  const auto castle = [&](const uint8_t right, const uint64_t empty, const uint64_t path,
+                          const square to) {
+    if (!(rights & right) || checkers || occupancy & empty) {
+      return;
+    }
+    bool safe = true;
+    for_each_square(path, [&](const square s) {
+      safe = safe && !chess_impl::attackers(config, s, occupancy, !is_white);
+    });
+    if (safe) {
+      moves.push_back({king_square, to});
+    }
+  };
+  const int rank = is_white ? 0 : 56; // The king is on the e-file, the rooks in the corners.
+  castle(castling::white_king, uint64_t{0x06} << rank, uint64_t{0x06} << rank, rank + 1);
+  castle(castling::white_queen, uint64_t{0x70} << rank, uint64_t{0x30} << rank, rank + 5);
+}
@@ -0,0 +1,310 @@
+#pragma once
+#include "evaluate.hpp"
+#include <cstring>
+#include <span>
+#include <unistd.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** Inputs of the network: a piece of either side on a square, as seen by one side. */
+inline constexpr int nnue_features = 2 * 6 * 64;
+/** Neurons of the first layer for each side; a multiple of 16, the lanes of an AVX2 register. */
+inline constexpr int nnue_hidden = 32;
+/** The activation of the first layer: accumulated values clipped to 0 through this. */
+inline constexpr int nnue_activation_max = 255;
+/** The output layer yields centipawns times this. */
+inline constexpr int nnue_output_scale = 16;
+
+/**
+ * The index of the input for a piece `p` of the side `is_white` on `s`, as seen by `perspective`:
+ * its own pieces first, and the board flipped for black so that both see the same network.
+ */
+constexpr int nnue_feature(const bool perspective, const bool is_white, const piece p,
+                           const square s) noexcept {
+  return (is_white != perspective) * 6 * 64 + (std::to_underlying(p) - 1) * 64 +
+         static_cast<int>(perspective ? s : s ^ 56);
+}
+
+/**
+ * A network evaluating positions in 2 layers. The first, by far the largest, sums the weights of
+ * the pieces on the board for each side, separately, into an accumulator; being linear, that is
+ * updated move by move for the few pieces that change. The second clips both sums, the side to
+ * move's first, and takes their dot product with its weights.
+ *
+ * Saved as is after a header, so that a network mapped from a file is used in place.
+ */
+struct network {
+  alignas(64) std::array<std::array<int16_t, nnue_hidden>, nnue_features> weights;
+  std::array<int16_t, nnue_hidden> biases;
+  std::array<std::array<int16_t, nnue_hidden>, 2> output_weights; // Side to move's, then other.
+  int32_t output_bias;
+
+  /** Saved layout: header, then the network. */
+  struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t features;
+    uint32_t hidden;
+    char padding[40];
+  };
+  static constexpr char magic[8]{'c', 'c', 'c', 'n', 'n', 'u', 'e', '\n'};
+  static constexpr uint32_t version = 1;
+  static constexpr uint32_t byte_order = 0x0102'0304;
+
+  /**
+   * Reinterprets saved bytes in place; nothing is copied. `bytes` MUST stay alive and 64-byte
+   * aligned, which a `mapped_file` guarantees. Null if they are not a network of this shape.
+   */
+  [[nodiscard]] static const network *load(const std::u8string_view bytes) noexcept {
+    header h;
+    if (bytes.size() != sizeof(h) + sizeof(network)) {
+      return nullptr;
+    }
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if (!std::ranges::equal(h.magic, magic) || h.version != version ||
+        h.byte_order != byte_order || h.features != nnue_features || h.hidden != nnue_hidden ||
+        reinterpret_cast<uintptr_t>(bytes.data()) % alignof(network) != 0) {
+      return nullptr;
+    }
+    return reinterpret_cast<const network *>(bytes.data() + sizeof(h));
+  }
+
+  /** Writes the network in the layout `load` expects; returns false on any I/O error. */
+  [[nodiscard]] bool save(const int fd) const noexcept {
+    header h{.version = version,
+             .byte_order = byte_order,
+             .features = nnue_features,
+             .hidden = nnue_hidden,
+             .padding = {}};
+    std::ranges::copy(magic, h.magic);
+    const auto write_all = [fd](const void *data, size_t size) {
+      for (const auto *p = static_cast<const char *>(data); size != 0;) {
+        const ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+          return false;
+        }
+        p += n;
+        size -= n;
+      }
+      return true;
+    };
+    return write_all(&h, sizeof(h)) && write_all(this, sizeof(network));
+  }
+};
+static_assert(sizeof(network::header) % alignof(network) == 0);
+
+/**
+ * The network that computes the piece-square tables of `evaluate` exactly, for up to 3 rooks,
+ * knights or bishops and 2 queens a side. For each side, a chain of neurons per piece type sums
+ * the values of its pieces of that type, each offset to take over where the one before it clips.
+ * The king's neuron is offset above 0, and cancels out with the other side's. It stands in for a
+ * trained network in the same format, and tests the machinery.
+ */
+constexpr network make_piece_square_network() noexcept {
+  network net{};
+  constexpr std::array<int, 7> chains{0, 5, 6, 4, 4, 8, 1}; // Neurons by piece type.
+  int neuron = 0;
+  for (int i = 1; i < 7; ++i) {
+    const auto p = static_cast<piece>(i);
+    for (int k = 0; k < chains[i]; ++k, ++neuron) {
+      for (int s = 0; s < 64; ++s) {
+        net.weights[nnue_feature(true, true, p, s)][neuron] =
+            static_cast<int16_t>(piece_square_value(p, true, s));
+      }
+      const int offset = p == piece::king ? nnue_activation_max / 2 : -nnue_activation_max * k;
+      net.biases[neuron] = static_cast<int16_t>(offset);
+      net.output_weights[0][neuron] = nnue_output_scale;
+      net.output_weights[1][neuron] = -nnue_output_scale;
+    }
+  }
+  return net;
+}
+
+/** The first layer of the network for a position: one sum per side, black's first. */
+struct accumulator {
+  alignas(64) std::array<std::array<int16_t, nnue_hidden>, 2> sums;
+
+  constexpr bool operator==(const accumulator &) const = default;
+};
+
+namespace chess_impl {
+
+/** `sum` = `from` + the weights of `added` - those of `removed`, a lane at a time. */
+constexpr void nnue_update_scalar(std::array<int16_t, nnue_hidden> &sum,
+                                  const std::array<int16_t, nnue_hidden> &from,
+                                  const network &net, const std::span<const int> added,
+                                  const std::span<const int> removed) noexcept {
+  for (int i = 0; i < nnue_hidden; ++i) {
+    int16_t value = from[i];
+    for (const int f : added) {
+      value = static_cast<int16_t>(value + net.weights[f][i]);
+    }
+    for (const int f : removed) {
+      value = static_cast<int16_t>(value - net.weights[f][i]);
+    }
+    sum[i] = value;
+  }
+}
+
+/** The same with AVX2 or SSE2, keeping each register of the sum in place over all features. */
+inline void nnue_update_simd(std::array<int16_t, nnue_hidden> &sum,
+                             const std::array<int16_t, nnue_hidden> &from, const network &net,
+                             const std::span<const int> added,
+                             const std::span<const int> removed) noexcept {
+#if defined(__AVX2__)
+  const auto load = [](const int16_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  };
+  for (int i = 0; i < nnue_hidden; i += 16) {
+    __m256i value = load(&from[i]);
+    for (const int f : added) {
+      value = _mm256_add_epi16(value, load(&net.weights[f][i]));
+    }
+    for (const int f : removed) {
+      value = _mm256_sub_epi16(value, load(&net.weights[f][i]));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&sum[i]), value);
+  }
+#elif defined(__SSE2__)
+  const auto load = [](const int16_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  };
+  for (int i = 0; i < nnue_hidden; i += 8) {
+    __m128i value = load(&from[i]);
+    for (const int f : added) {
+      value = _mm_add_epi16(value, load(&net.weights[f][i]));
+    }
+    for (const int f : removed) {
+      value = _mm_sub_epi16(value, load(&net.weights[f][i]));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&sum[i]), value);
+  }
+#else
+  nnue_update_scalar(sum, from, net, added, removed);
+#endif
+}
+
+/** The output layer before scaling, a lane at a time. */
+constexpr int nnue_output_scalar(const network &net, const accumulator &acc,
+                                 const bool is_white) noexcept {
+  int output = net.output_bias;
+  for (int k = 0; k < 2; ++k) {
+    const auto &sum = acc.sums[k == 0 ? is_white : !is_white];
+    for (int i = 0; i < nnue_hidden; ++i) {
+      output += std::clamp<int>(sum[i], 0, nnue_activation_max) * net.output_weights[k][i];
+    }
+  }
+  return output;
+}
+
+/** The same with AVX2 or SSE2: clip 16 bits at a time, multiply and add pairs into 32 bits. */
+inline int nnue_output_simd(const network &net, const accumulator &acc,
+                            const bool is_white) noexcept {
+#if defined(__AVX2__)
+  const auto load = [](const int16_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  };
+  const __m256i zero = _mm256_setzero_si256(), max = _mm256_set1_epi16(nnue_activation_max);
+  __m256i total = zero;
+  for (int k = 0; k < 2; ++k) {
+    const auto &sum = acc.sums[k == 0 ? is_white : !is_white];
+    for (int i = 0; i < nnue_hidden; i += 16) {
+      const __m256i clipped = _mm256_min_epi16(_mm256_max_epi16(load(&sum[i]), zero), max);
+      total = _mm256_add_epi32(total,
+                               _mm256_madd_epi16(clipped, load(&net.output_weights[k][i])));
+    }
+  }
+  __m128i folded =
+      _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+#elif defined(__SSE2__)
+  const auto load = [](const int16_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  };
+  const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16(nnue_activation_max);
+  __m128i folded = zero;
+  for (int k = 0; k < 2; ++k) {
+    const auto &sum = acc.sums[k == 0 ? is_white : !is_white];
+    for (int i = 0; i < nnue_hidden; i += 8) {
+      const __m128i clipped = _mm_min_epi16(_mm_max_epi16(load(&sum[i]), zero), max);
+      folded = _mm_add_epi32(folded, _mm_madd_epi16(clipped, load(&net.output_weights[k][i])));
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  folded = _mm_add_epi32(folded, _mm_shuffle_epi32(folded, 0b01'00'11'10));
+  folded = _mm_add_epi32(folded, _mm_shuffle_epi32(folded, 0b10'11'00'01));
+  return net.output_bias + _mm_cvtsi128_si32(folded);
+#else
+  return nnue_output_scalar(net, acc, is_white);
+#endif
+}
+
+constexpr void nnue_update(std::array<int16_t, nnue_hidden> &sum,
+                           const std::array<int16_t, nnue_hidden> &from, const network &net,
+                           const std::span<const int> added,
+                           const std::span<const int> removed) noexcept {
+  if consteval {
+    nnue_update_scalar(sum, from, net, added, removed);
+  } else {
+    nnue_update_simd(sum, from, net, added, removed);
+  }
+}
+
+} // namespace chess_impl
+
+/** The accumulator of `config` from scratch: the biases plus the weights of every piece. */
+constexpr accumulator refresh(const network &net, const configuration &config) noexcept {
+  accumulator acc;
+  for (const bool perspective : {false, true}) {
+    std::array<int, 32> features;
+    size_t n = 0;
+    for (const bool is_white : {false, true}) {
+      for (const auto [p, s] : config.get_side(is_white)) {
+        features[n++] = nnue_feature(perspective, is_white, p, s);
+      }
+    }
+    chess_impl::nnue_update(acc.sums[perspective], net.biases, net, std::span(features).first(n),
+                            {});
+  }
+  return acc;
+}
+
+/**
+ * The accumulator of `child`, a move away from `parent` whose accumulator is `from`: only the
+ * pieces that left or reached a square count, at most 2 of each whatever the move.
+ * Unmaking the move is keeping `from`, so a search keeps one accumulator per ply.
+ */
+constexpr void update(const network &net, const accumulator &from, const configuration &parent,
+                      const configuration &child, accumulator &to) noexcept {
+  for (const bool perspective : {false, true}) {
+    std::array<int, 4> added, removed;
+    size_t n_added = 0, n_removed = 0;
+    for (const bool is_white : {false, true}) {
+      const side &before = parent.get_side(is_white), &after = child.get_side(is_white);
+      const uint64_t changed = before.get_occupancy() ^ after.get_occupancy();
+      for (uint64_t left = changed & before.get_occupancy(); left; left &= left - 1) {
+        const square s = std::countr_zero(left);
+        removed[n_removed++] = nnue_feature(perspective, is_white, before.at(s), s);
+      }
+      for (uint64_t reached = changed & after.get_occupancy(); reached; reached &= reached - 1) {
+        const square s = std::countr_zero(reached);
+        added[n_added++] = nnue_feature(perspective, is_white, after.at(s), s);
+      }
+    }
+    assert(n_added <= 2 && n_removed <= 2);
+    chess_impl::nnue_update(to.sums[perspective], from.sums[perspective], net,
+                            std::span(added).first(n_added), std::span(removed).first(n_removed));
+  }
+}
+
+/** The evaluation by `net` of the position of `acc` in centipawns, for the side `is_white`. */
+constexpr int evaluate(const network &net, const accumulator &acc, const bool is_white) noexcept {
+  if consteval {
+    return chess_impl::nnue_output_scalar(net, acc, is_white) / nnue_output_scale;
+  }
+  return chess_impl::nnue_output_simd(net, acc, is_white) / nnue_output_scale;
+}
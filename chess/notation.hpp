@@ -0,0 +1,135 @@
+#pragma once
+#include "movegen.hpp"
+
+namespace chess_impl {
+
+inline constexpr std::string_view piece_letters = " PRNBQK"; // By `piece`.
+
+constexpr void append_square(std::string &text, const square s) {
+  text += static_cast<char>('a' + file_of(s));
+  text += static_cast<char>('1' + rank_of(s));
+}
+
+} // namespace chess_impl
+
+/**
+ * Standard Algebraic Notation of the legal move `m` of the side `is_white`, as PGN has it: "Nbd7",
+ * "exd6", "O-O", "e8=Q+". The file, the rank or both tell apart pieces of a type that could reach
+ * the same square, and a suffix says whether the move checks or mates.
+ */
+constexpr std::string to_san(const configuration &config, const bool is_white, const move m) {
+  using chess_impl::append_square;
+  const auto &us = config.get_side(is_white);
+  const piece p = us.at(m.from());
+  const bool is_capture = config.get_side(!is_white).at(m.to()) != piece::empty ||
+                          (p == piece::pawn && file_of(m.from()) != file_of(m.to()));
+  std::string text;
+  if (p == piece::king && std::abs(file_of(m.from()) - file_of(m.to())) == 2) {
+    text = file_of(m.to()) == 6 ? "O-O" : "O-O-O";
+  } else if (p == piece::pawn) {
+    if (is_capture) {
+      text += static_cast<char>('a' + file_of(m.from()));
+      text += 'x';
+    }
+    append_square(text, m.to());
+    if (m.get_promotion() != piece::empty) {
+      text += '=';
+      text += chess_impl::piece_letters[std::to_underlying(m.get_promotion())];
+    }
+  } else {
+    text += chess_impl::piece_letters[std::to_underlying(p)];
+    move_list moves;
+    generate_moves(config, is_white, moves);
+    bool ambiguous = false, same_file = false, same_rank = false;
+    for (const move other : moves) {
+      if (other.to() == m.to() && other.from() != m.from() && us.at(other.from()) == p) {
+        ambiguous = true;
+        same_file |= file_of(other.from()) == file_of(m.from());
+        same_rank |= rank_of(other.from()) == rank_of(m.from());
+      }
+    }
+    if (ambiguous && (!same_file || same_rank)) {
+      text += static_cast<char>('a' + file_of(m.from()));
+    }
+    if (ambiguous && same_file) {
+      text += static_cast<char>('1' + rank_of(m.from()));
+    }
+    if (is_capture) {
+      text += 'x';
+    }
+    append_square(text, m.to());
+  }
+
+  const configuration next = config.make_move(m);
+  if (king_safety(next, !is_white).checkers) {
+    move_list replies;
+    generate_moves(next, !is_white, replies);
+    text += replies.empty() ? '#' : '+';
+  }
+  return text;
+}
+
+/**
+ * The legal move of the side `is_white` that `text` denotes in Standard Algebraic Notation, if
+ * exactly one does. Lenient as PGN readers are: the suffixes "+#!?" are ignored, the capture mark
+ * is optional, castling may be written with zeros and a promotion without "=".
+ */
+constexpr std::optional<move> parse_san(const configuration &config, const bool is_white,
+                                        std::string_view text) {
+  while (!text.empty() && std::string_view("+#!?").contains(text.back())) {
+    text.remove_suffix(1);
+  }
+  const square king = config.get_side(is_white).get_king_square();
+  piece p = piece::pawn, promotion = piece::empty;
+  std::optional<square> to;
+  int from_file = -1, from_rank = -1;
+  if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+    p = piece::king;
+    from_file = file_of(king);
+    from_rank = rank_of(king);
+    to = make_square(text.size() == 3 ? 6 : 2, rank_of(king));
+  } else {
+    if (!text.empty() && std::string_view("RNBQK").contains(text.front())) {
+      p = static_cast<piece>(chess_impl::piece_letters.find(text.front()));
+      text.remove_prefix(1);
+    }
+    if (text.size() >= 3 && p == piece::pawn && std::string_view("RNBQ").contains(text.back())) {
+      promotion = static_cast<piece>(chess_impl::piece_letters.find(text.back()));
+      text.remove_suffix(text[text.size() - 2] == '=' ? 2 : 1);
+    }
+    if (text.size() < 2 || !(to = parse_square(text.substr(text.size() - 2)))) {
+      return std::nullopt;
+    }
+    text.remove_suffix(2);
+    if (!text.empty() && text.back() == 'x') {
+      text.remove_suffix(1);
+    }
+    if (!text.empty() && 'a' <= text.front() && text.front() <= 'h') {
+      from_file = text.front() - 'a';
+      text.remove_prefix(1);
+    }
+    if (!text.empty() && '1' <= text.front() && text.front() <= '8') {
+      from_rank = text.front() - '1';
+      text.remove_prefix(1);
+    }
+    if (!text.empty()) {
+      return std::nullopt;
+    }
+  }
+
+  move_list moves;
+  generate_moves(config, is_white, moves);
+  std::optional<move> found;
+  for (const move m : moves) {
+    if (m.to() == *to && m.get_promotion() == promotion &&
+        config.get_side(is_white).at(m.from()) == p &&
+        (from_file < 0 || file_of(m.from()) == from_file) &&
+        (from_rank < 0 || rank_of(m.from()) == from_rank)) {
+      if (found) {
+        return std::nullopt;
+      }
+      found = m;
+    }
+  }
+  return found;
+}
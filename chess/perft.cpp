@@ -0,0 +1,107 @@
+#include "perft.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+
+/** The positions of https://www.chessprogramming.org/Perft_Results, with their known counts. */
+struct reference {
+  const char *name;
+  const char *fen;
+  int depth; // Deep enough to take a moment, not a minute.
+  std::array<uint64_t, 7> nodes;
+};
+
+constexpr reference references[] = {
+    {"initial",
+     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     5,
+     {20, 400, 8'902, 197'281, 4'865'609, 119'060'324, 3'195'901'860}},
+    {"kiwipete",
+     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     4,
+     {48, 2'039, 97'862, 4'085'603, 193'690'690, 8'031'647'685}},
+    {"position3",
+     "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     6,
+     {14, 191, 2'812, 43'238, 674'624, 11'030'083, 178'633'661}},
+    {"position4",
+     "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     5,
+     {6, 264, 9'467, 422'333, 15'833'292, 706'045'033}},
+    {"position5",
+     "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     4,
+     {44, 1'486, 62'379, 2'103'487, 89'941'194, 3'048'196'529}},
+    {"position6",
+     "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     4,
+     {46, 2'079, 89'890, 3'894'594, 164'075'551, 6'923'051'137}},
+};
+
+/** Counts the leaves below `p` and prints them, timed, as `key=value` pairs after `label`. */
+uint64_t run(const char *label, const ply &p, const int depth, const unsigned threads,
+             perft_table *const table, const bool print_moves) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto counts = divide(p.config, p.white_turn, depth, threads, table);
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  uint64_t nodes = 0;
+  for (const auto &[m, n] : counts) {
+    nodes += n;
+    if (print_moves) {
+      std::printf("%s %llu\n", to_string(m).c_str(), static_cast<unsigned long long>(n));
+    }
+  }
+  std::printf("%s depth=%d nodes=%llu seconds=%.3f nps=%.0f", label, depth,
+              static_cast<unsigned long long>(nodes), seconds, nodes / seconds);
+  return nodes;
+}
+
+/**
+ * Usage: perft [depth=per position] [threads=all cores] [hash megabytes=0] [fen]
+ *
+ * Without a FEN, runs each reference position to `depth`, or its own depth if 0, and exits with 1
+ * if any count differs from the known one. With a FEN, also prints the count below each move, to
+ * find where a generator goes wrong by comparing against another engine's `divide`.
+ */
+int main(const int argc, const char *argv[]) {
+  const int depth = argc > 1 ? std::atoi(argv[1]) : 0;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned threads = argc > 2 ? std::max(std::atoi(argv[2]), 1) : cores;
+  const size_t megabytes = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+  std::optional<perft_table> table;
+  if (megabytes > 0) {
+    table.emplace(megabytes);
+  }
+  std::printf("perft version=1 threads=%u hash_mb=%zu\n", threads, megabytes);
+
+  if (argc > 4) {
+    const auto p = parse_fen(argv[4]);
+    if (!p || depth < 1) {
+      std::fprintf(stderr, "perft: a FEN needs a valid position and a depth of at least 1\n");
+      return 2;
+    }
+    run("position=fen", *p, depth, threads, table ? &*table : nullptr, true);
+    std::printf("\n");
+    return 0;
+  }
+
+  int failures = 0;
+  for (const auto &[name, fen, default_depth, nodes] : references) {
+    const int d = depth > 0 ? depth : default_depth;
+    char label[64];
+    std::snprintf(label, sizeof label, "position=%s", name);
+    const uint64_t counted = run(label, *parse_fen(fen), d, threads,
+                                 table ? &*table : nullptr, false);
+    if (const size_t i = d - 1; i < nodes.size() && nodes[i] != 0) {
+      std::printf(" expected=%llu %s\n", static_cast<unsigned long long>(nodes[i]),
+                  counted == nodes[i] ? "ok" : "MISMATCH");
+      failures += counted != nodes[i];
+    } else {
+      std::printf(" expected=unknown\n");
+    }
+    std::fflush(stdout);
+  }
+  return failures != 0;
+}
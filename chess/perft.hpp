@@ -0,0 +1,126 @@
+#pragma once
+#include "movegen.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Leaf counts of subtrees already walked, shared by any number of threads without locks. Each
+ * entry holds its data and the key XORed with it, written separately: should writes from 2 threads
+ * interleave, the pair no longer decodes to the key and a probe misses rather than lies.
+ */
+class perft_table {
+  struct entry {
+    std::atomic<uint64_t> check, data; // The count above the low byte, the depth in it.
+  };
+  size_t mask;
+  std::unique_ptr<entry[]> entries;
+
+public:
+  /** The largest power-of-2 number of entries fitting in `megabytes`, which MUST be nonzero. */
+  explicit perft_table(const size_t megabytes)
+      : mask(std::bit_floor((megabytes << 20) / sizeof(entry)) - 1),
+        entries(std::make_unique<entry[]>(mask + 1)) {}
+
+  [[nodiscard]] std::optional<uint64_t> probe(const uint64_t key, const int depth) const noexcept {
+    const entry &e = entries[key & mask];
+    const uint64_t data = e.data.load(std::memory_order_relaxed);
+    if ((e.check.load(std::memory_order_relaxed) ^ data) != key ||
+        (data & 0xFF) != static_cast<uint64_t>(depth)) {
+      return std::nullopt;
+    }
+    return data >> 8;
+  }
+
+  void store(const uint64_t key, const int depth, const uint64_t nodes) noexcept {
+    entry &e = entries[key & mask];
+    const uint64_t data = nodes << 8 | static_cast<uint64_t>(depth);
+    e.check.store(key ^ data, std::memory_order_relaxed);
+    e.data.store(data, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Counts the leaves of the tree of legal moves `depth` plies deep, the standard test of a move
+ * generator. The last ply is counted without being played; with a `table`, subtrees reached again
+ * by transposition are looked up instead of walked.
+ */
+constexpr uint64_t perft(const configuration &config, const bool is_white, const int depth,
+                         perft_table *const table = nullptr) {
+  if (depth == 0) {
+    return 1;
+  }
+  const uint64_t key = config.get_key();
+  if (table && depth > 1) {
+    if (const auto nodes = table->probe(key, depth)) {
+      return *nodes;
+    }
+  }
+  move_list moves;
+  generate_moves(config, is_white, moves);
+  if (depth == 1) {
+    return moves.size();
+  }
+  uint64_t nodes = 0;
+  for (const move m : moves) {
+    nodes += perft(config.make_move(m), !is_white, depth - 1, table);
+  }
+  if (table) {
+    table->store(key, depth, nodes);
+  }
+  return nodes;
+}
+
+/** `perft` on a `board`, playing and taking back each move in place instead of copying. */
+constexpr uint64_t perft(board &b, const bool is_white, const int depth) {
+  if (depth == 0) {
+    return 1;
+  }
+  move_list moves;
+  generate_moves(b, is_white, moves);
+  if (depth == 1) {
+    return moves.size();
+  }
+  uint64_t nodes = 0;
+  for (const move m : moves) {
+    const board::undo u = b.make_move(m);
+    nodes += perft(b, !is_white, depth - 1);
+    b.unmake_move(u);
+  }
+  return nodes;
+}
+
+struct perft_count {
+  move m;
+  uint64_t nodes;
+};
+
+/**
+ * `perft` for each legal move, in generation order. The moves are handed out to `threads` threads
+ * one at a time as each finishes its last, so there is no gain beyond the number of moves.
+ */
+inline std::vector<perft_count> divide(const configuration &config, const bool is_white,
+                                       const int depth, const unsigned threads = 1,
+                                       perft_table *const table = nullptr) {
+  assert(depth > 0);
+  move_list moves;
+  generate_moves(config, is_white, moves);
+  std::vector<perft_count> counts;
+  for (const move m : moves) {
+    counts.push_back({m, 0});
+  }
+  std::atomic<size_t> next = 0;
+  const auto work = [&] {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < counts.size();) {
+      counts[i].nodes = perft(config.make_move(counts[i].m), !is_white, depth - 1, table);
+    }
+  };
+  std::vector<std::jthread> workers;
+  for (unsigned i = 1; i < threads; ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+  workers.clear(); // Joins them, before `counts` is returned.
+  return counts;
+}
@@ -0,0 +1,399 @@
+#pragma once
+#include "notation.hpp"
+#include "unicode.hpp"
+#include <atomic>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class game_result : uint8_t { unknown, white_wins, draw, black_wins };
+
+/** Receives what a `pgn_reader` finds, game by game. */
+struct pgn_visitor {
+  constexpr virtual ~pgn_visitor() = default;
+  /** A tag pair of the game about to start, its value unescaped and valid UTF-8. */
+  constexpr virtual void tag(std::u8string_view name, std::u8string_view value) {}
+  /**
+   * The position at `ply` of the main line, from 0 before the first move. Returning false skips
+   * replaying the rest of the game, which is most of the cost of reading it.
+   */
+  constexpr virtual bool position(const configuration &config, bool white_turn, int ply) {
+    return true;
+  }
+  /** The result from the termination marker, else from the tag; whether all was legal and valid. */
+  constexpr virtual void end_game(game_result result, bool valid) {}
+};
+
+/**
+ * Reads games in Portable Game Notation, codepoint by codepoint, and replays the moves of their
+ * main lines: comments, variations and annotations are skipped. A game with an illegal move or
+ * invalid UTF-8, in its tags or its movetext, still ends with its result, marked invalid; its
+ * positions up to the error stand.
+ * The `FEN` tag sets up the starting position, if any.
+ */
+template <std::derived_from<pgn_visitor> V = pgn_visitor> class pgn_reader {
+  using iterator = codepoint_view<std::u8string_view>::iterator;
+  static constexpr int eof = -1;
+
+  iterator it;
+  V *visitor;
+  // Buffers, kept from one game to the next.
+  std::u8string name, value;
+  std::string token, fen;
+  // The game being read: whether it has begun, whether its moves have, and where they are.
+  bool in_game = false, started = false, valid = true, replaying = false;
+  configuration config;
+  bool white_turn = true;
+  int ply = 0;
+  game_result result = game_result::unknown, tagged = game_result::unknown;
+
+  [[nodiscard]] constexpr int peek() const { return it == std::default_sentinel ? eof : *it; }
+
+  static constexpr bool is_symbol(const int c) noexcept {
+    return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') ||
+           std::string_view("+#=-/!?*_:").contains(static_cast<char>(c));
+  }
+
+  static constexpr game_result parse_result(const std::string_view text) noexcept {
+    return text == "1-0"       ? game_result::white_wins
+           : text == "0-1"     ? game_result::black_wins
+           : text == "1/2-1/2" ? game_result::draw
+                               : game_result::unknown;
+  }
+
+  constexpr void skip_past(const int end) {
+    for (int c; (c = peek()) != eof; ++it) {
+      if (c == end) {
+        ++it;
+        return;
+      }
+      valid = valid && c >= 0;
+    }
+  }
+
+  /** Skips a variation, from its `(`, with those and comments nested within it. */
+  constexpr void skip_variation() {
+    ++it;
+    for (int depth = 1, c; depth > 0 && (c = peek()) != eof;) {
+      if (c == '{') {
+        skip_past('}');
+      } else if (c == ';') {
+        skip_past('\n');
+      } else {
+        depth += (c == '(') - (c == ')');
+        valid = valid && c >= 0;
+        ++it;
+      }
+    }
+  }
+
+  /** Sets up the position, from the tags, before the first move or result of a game. */
+  constexpr void start() {
+    in_game = started = true;
+    config = configuration();
+    white_turn = true;
+    ply = 0;
+    if (!fen.empty()) {
+      const auto setup = parse_fen(fen);
+      valid = valid && setup;
+      if (setup) {
+        config = setup->config;
+        white_turn = setup->white_turn;
+      }
+    }
+    replaying = valid && visitor->position(config, white_turn, ply);
+  }
+
+  constexpr void finish() {
+    if (!in_game) {
+      return;
+    }
+    if (!started) {
+      start();
+    }
+    visitor->end_game(result != game_result::unknown ? result : tagged, valid);
+    in_game = started = replaying = false;
+    valid = true;
+    fen.clear();
+    result = tagged = game_result::unknown;
+  }
+
+  /** A tag pair, from its `[`: a symbol, then a string with `\` escaping `"` and itself. */
+  constexpr void read_tag() {
+    if (started) {
+      finish();
+    }
+    in_game = true;
+    ++it;
+    name.clear();
+    value.clear();
+    for (int c; (c = peek()) == ' ' || c == '\t';) {
+      ++it;
+    }
+    for (int c; is_symbol(c = peek()); ++it) {
+      name += static_cast<char8_t>(c);
+    }
+    for (int c; (c = peek()) == ' ' || c == '\t';) {
+      ++it;
+    }
+    if (peek() == '"') {
+      ++it;
+      for (int c; (c = peek()) != eof && c != '"'; ++it) {
+        if (c == '\\') {
+          ++it;
+          c = peek();
+          if (c == eof) {
+            break;
+          }
+        }
+        if (c < 0) {
+          valid = false;
+          continue;
+        }
+        std::array<char8_t, 4> units;
+        value.append(units.data(), encode_utf8(c, units.data()));
+      }
+    }
+    skip_past(']');
+    if (name == u8"FEN") {
+      fen.assign(value.begin(), value.end());
+    } else if (name == u8"Result") {
+      token.assign(value.begin(), value.end());
+      tagged = parse_result(token);
+    }
+    visitor->tag(name, value);
+  }
+
+  /** A move number, a move in SAN or a termination marker. */
+  constexpr void read_token() {
+    token.clear();
+    for (int c; is_symbol(c = peek()); ++it) {
+      token += static_cast<char>(c);
+    }
+    if (std::ranges::all_of(token, [](const char c) { return '0' <= c && c <= '9'; })) {
+      return;
+    }
+    if (!started) {
+      start();
+    }
+    if (const game_result r = parse_result(token); r != game_result::unknown || token == "*") {
+      result = r;
+      finish();
+      return;
+    }
+    if (!replaying) {
+      return;
+    }
+    if (const auto m = parse_san(config, white_turn, token)) {
+      config = config.make_move(*m);
+      white_turn = !white_turn;
+      replaying = visitor->position(config, white_turn, ++ply);
+    } else {
+      valid = replaying = false;
+    }
+  }
+
+public:
+  constexpr pgn_reader(const std::u8string_view text, V *visitor)
+      : it((text | to_codepoint).begin()), visitor(visitor) {}
+
+  /** Reads all the games of the text, the last even if it lacks a termination marker. */
+  constexpr void read() {
+    for (int c; (c = peek()) != eof;) {
+      if (c == '[') {
+        read_tag();
+      } else if (c == '{') {
+        skip_past('}');
+      } else if (c == ';') {
+        skip_past('\n');
+      } else if (c == '(') {
+        skip_variation();
+      } else if (is_symbol(c)) {
+        read_token();
+      } else { // Whitespace, the dots of move numbers, NAGs' `$`, stray characters.
+        valid = valid && c >= 0;
+        ++it;
+      }
+    }
+    finish();
+  }
+};
+
+/**
+ * Offsets at which to split `text` into about `parts` runs of whole games, from 0 to its size:
+ * each but the first starts at a tag pair after a blank line, which is how games are exported.
+ */
+inline std::vector<size_t> split_pgn(const std::u8string_view text, const size_t parts) {
+  std::vector<size_t> bounds{0};
+  for (size_t i = 1; i < parts; ++i) {
+    for (size_t at = std::max(text.size() / parts * i, bounds.back());
+         (at = text.find(u8"\n[", at)) != text.npos; ++at) {
+      const std::u8string_view before = text.substr(0, at);
+      if (before.ends_with(u8"\n") || before.ends_with(u8"\n\r")) {
+        if (at + 1 > bounds.back()) {
+          bounds.push_back(at + 1);
+        }
+        break;
+      }
+    }
+  }
+  bounds.push_back(text.size());
+  return bounds;
+}
+
+/** How often a position occurred, and how the games went on to end. */
+struct position_stats {
+  uint64_t games = 0;
+  std::array<uint64_t, 4> results{}; // By `game_result`.
+};
+
+/** Positions by Zobrist key: transpositions into one another meet in the same entry. */
+using position_table = std::unordered_map<uint64_t, position_stats>;
+
+/** Counts the positions of the games to `max_ply`, and the games themselves. */
+class position_counter final : public pgn_visitor {
+  int max_ply;
+  std::vector<uint64_t> keys; // Of the game being read.
+
+public:
+  position_table positions;
+  uint64_t games = 0, invalid = 0, plies = 0;
+
+  explicit position_counter(const int max_ply) : max_ply(max_ply) {}
+
+  bool position(const configuration &config, bool, const int ply) override {
+    keys.push_back(config.get_key());
+    return ply < max_ply;
+  }
+  void end_game(const game_result result, const bool valid) override {
+    ++games;
+    invalid += !valid;
+    plies += keys.empty() ? 0 : keys.size() - 1;
+    for (const uint64_t key : keys) {
+      position_stats &stats = positions[key];
+      ++stats.games;
+      ++stats.results[std::to_underlying(result)];
+    }
+    keys.clear();
+  }
+
+  /** Adds the counts of `other`, as read from another part of the same database. */
+  void merge(const position_counter &other) {
+    games += other.games;
+    invalid += other.invalid;
+    plies += other.plies;
+    for (const auto &[key, stats] : other.positions) {
+      position_stats &into = positions[key];
+      into.games += stats.games;
+      for (size_t i = 0; i < stats.results.size(); ++i) {
+        into.results[i] += stats.results[i];
+      }
+    }
+  }
+};
+
+/**
+ * Reads a PGN database on `threads` threads and counts its positions to `max_ply`. The text is
+ * split at game boundaries into a few runs per thread, which threads take in turn as they finish,
+ * each counting into its own table; the tables are merged at the end.
+ */
+inline position_counter import_pgn(const std::u8string_view text, const unsigned threads,
+                                   const int max_ply) {
+  const std::vector<size_t> bounds = split_pgn(text, std::max(threads, 1u) * 8);
+  std::vector<position_counter> counters(std::max(threads, 1u), position_counter(max_ply));
+  std::atomic<size_t> next = 0;
+  const auto work = [&](position_counter &counter) {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) + 1 < bounds.size();) {
+      pgn_reader(text.substr(bounds[i], bounds[i + 1] - bounds[i]), &counter).read();
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    for (size_t i = 1; i < counters.size(); ++i) {
+      workers.emplace_back(work, std::ref(counters[i]));
+    }
+    work(counters.front());
+  }
+  for (size_t i = 1; i < counters.size(); ++i) {
+    counters.front().merge(counters[i]);
+  }
+  return std::move(counters.front());
+}
+
+/**
+ * The moves from `from` that lead to positions of `table`, the most frequent first: a node of the
+ * opening tree, which transpositions join.
+ */
+inline std::vector<std::pair<move, position_stats>> continuations(const position_table &table,
+                                                                  const ply &from) {
+  std::vector<std::pair<move, position_stats>> found;
+  move_list moves;
+  generate_moves(from.config, from.white_turn, moves);
+  for (const move m : moves) {
+    if (const auto it = table.find(from.config.make_move(m).get_key()); it != table.end()) {
+      found.emplace_back(m, it->second);
+    }
+  }
+  std::ranges::stable_sort(found, std::greater(),
+                           [](const auto &entry) { return entry.second.games; });
+  return found;
+}
+
+/**
+ * Writes a game in PGN export format to `text`: the tags in order, with `Result` and, unless the
+ * game starts from the initial position, `SetUp` and `FEN` added; then the moves in SAN, lines
+ * kept within 80 columns, and the termination marker.
+ */
+inline void append_pgn(std::string &text,
+                       const std::span<const std::pair<std::string_view, std::string>> tags,
+                       const ply &start, const std::span<const move> moves,
+                       const game_result result) {
+  constexpr std::array<std::string_view, 4> markers{"*", "1-0", "1/2-1/2", "0-1"};
+  const auto tag = [&text](const std::string_view name, const std::string_view value) {
+    text += '[';
+    text += name;
+    text += " \"";
+    for (const char c : value) {
+      if (c == '"' || c == '\\') {
+        text += '\\';
+      }
+      text += c;
+    }
+    text += "\"]\n";
+  };
+  for (const auto &[name, value] : tags) {
+    tag(name, value);
+  }
+  tag("Result", markers[std::to_underlying(result)]);
+  const bool initial = start.white_turn && start.config.get_key() == configuration().get_key();
+  if (!initial) {
+    tag("SetUp", "1");
+    tag("FEN", to_fen(start));
+  }
+  text += '\n';
+
+  size_t line = text.size();
+  ply position = start;
+  const auto word = [&](const std::string_view w) {
+    if (text.size() != line) {
+      if (text.size() - line + 1 + w.size() > 80) {
+        text += '\n';
+        line = text.size();
+      } else {
+        text += ' ';
+      }
+    }
+    text += w;
+  };
+  for (size_t i = 0; i < moves.size(); ++i) {
+    std::string san; // Kept on the line of its move number.
+    if (position.white_turn || i == 0) {
+      san = std::to_string(1 + (i + !start.white_turn) / 2) + (position.white_turn ? ". " : "... ");
+    }
+    word(san + to_san(position.config, position.white_turn, moves[i]));
+    position = {position.config.make_move(moves[i]), !position.white_turn};
+  }
+  word(markers[std::to_underlying(result)]);
+  text += "\n\n";
+}
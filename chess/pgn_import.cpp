@@ -0,0 +1,54 @@
+#include "mapped_file.hpp"
+#include "pgn.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Usage: pgn_import file [threads=all cores] [plies=20] [lines=10]
+ *
+ * Counts the positions of the PGN database `file` to `plies` on `threads` threads, and prints as
+ * `key=value` pairs the totals and throughput, then the `lines` most played first moves with how
+ * the games went on.
+ */
+int main(const int argc, const char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s file [threads] [plies] [lines]\n", argv[0]);
+    return 2;
+  }
+  const mapped_file file(argv[1]);
+  if (!file) {
+    std::perror(argv[1]);
+    return 2;
+  }
+  file.advise(MADV_SEQUENTIAL);
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned threads = argc > 2 ? std::max(std::atoi(argv[2]), 1) : cores;
+  const int plies = argc > 3 ? std::max(std::atoi(argv[3]), 0) : 20;
+  const size_t lines = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 10;
+  std::printf("pgn_import version=1 file=%s bytes=%zu threads=%u plies=%d\n", argv[1],
+              file.view().size(), threads, plies);
+  std::fflush(stdout);
+
+  const auto start = std::chrono::steady_clock::now();
+  const position_counter counter = import_pgn(file.view(), threads, plies);
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("games=%llu invalid=%llu plies=%llu positions=%zu seconds=%.3f mb_per_second=%.1f "
+              "games_per_second=%.0f\n",
+              static_cast<unsigned long long>(counter.games),
+              static_cast<unsigned long long>(counter.invalid),
+              static_cast<unsigned long long>(counter.plies), counter.positions.size(), seconds,
+              file.view().size() / seconds / (1 << 20), counter.games / seconds);
+
+  const ply initial{configuration(), true};
+  const auto moves = continuations(counter.positions, initial);
+  for (size_t i = 0; i < std::min(lines, moves.size()); ++i) {
+    const auto &[m, stats] = moves[i];
+    std::printf("move=%s games=%llu white_wins=%llu draws=%llu black_wins=%llu\n",
+                to_san(initial.config, true, m).c_str(),
+                static_cast<unsigned long long>(stats.games),
+                static_cast<unsigned long long>(stats.results[1]),
+                static_cast<unsigned long long>(stats.results[2]),
+                static_cast<unsigned long long>(stats.results[3]));
+  }
+}
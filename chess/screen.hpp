@@ -0,0 +1,210 @@
+#pragma once
+#include "ansi.hpp"
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace ansi {
+
+/** The SGR parameters of colors, as `fg` and `bg` write them; 39 and 49 are the defaults. */
+constexpr uint8_t fg_code(const enum color color, const bool bright = false) noexcept {
+  return (bright ? 90 : 30) + (std::to_underlying(color) - '0');
+}
+constexpr uint8_t bg_code(const enum color color, const bool bright = false) noexcept {
+  return (bright ? 100 : 40) + (std::to_underlying(color) - '0');
+}
+inline constexpr uint8_t default_fg = 39, default_bg = 49;
+
+/** What a column of the terminal shows: a character in UTF-8 and its colors. */
+struct cell {
+  std::array<char, 4> glyph{' '};
+  uint8_t size = 1;  // Of `glyph`, in bytes.
+  uint8_t width = 1; // In columns: 2 for a full-width character, 0 for the column it covers.
+  uint8_t fg = default_fg, bg = default_bg;
+
+  constexpr bool operator==(const cell &) const = default;
+};
+
+/** A grid of cells, rows and columns from 0, to draw a frame into. */
+class screen {
+  int row_count, col_count;
+  std::vector<cell> cells;
+
+public:
+  constexpr screen(const int rows, const int cols)
+      : row_count(rows), col_count(cols), cells(rows * cols) {}
+
+  [[nodiscard]] constexpr int rows() const noexcept { return row_count; }
+  [[nodiscard]] constexpr int cols() const noexcept { return col_count; }
+  [[nodiscard]] constexpr const cell &at(const int row, const int col) const noexcept {
+    return cells[row * col_count + col];
+  }
+
+  constexpr void clear() noexcept { std::ranges::fill(cells, cell{}); }
+
+  /**
+   * Puts `glyph`, a single character `width` columns wide, at `row` and `col`. A full-width
+   * character half covered by it gives way to a space.
+   */
+  constexpr void put(const int row, const int col, const std::string_view glyph, const int width,
+                     const uint8_t fg, const uint8_t bg) noexcept {
+    assert(1 <= width && width <= 2 && col + width <= col_count && glyph.size() <= 4);
+    cell *const first = &cells[row * col_count + col];
+    if (first->width == 0) {
+      first[-1] = {.fg = first[-1].fg, .bg = first[-1].bg};
+    }
+    if (cell &after = first[width - 1]; after.width == 2 && col + width < col_count) {
+      (&after)[1] = {.fg = after.fg, .bg = after.bg};
+    }
+    *first = {.size = static_cast<uint8_t>(glyph.size()),
+              .width = static_cast<uint8_t>(width),
+              .fg = fg,
+              .bg = bg};
+    std::ranges::copy(glyph, first->glyph.begin());
+    if (width == 2) {
+      first[1] = {.glyph = {}, .size = 0, .width = 0, .fg = fg, .bg = bg};
+    }
+  }
+
+  /** Writes ASCII `text` from `row` and `col`, cut at the end of the row. */
+  constexpr void print(const int row, int col, const std::string_view text, const uint8_t fg,
+                       const uint8_t bg) noexcept {
+    for (const char c : text) {
+      if (col == col_count) {
+        break;
+      }
+      put(row, col++, {&c, 1}, 1, fg, bg);
+    }
+  }
+};
+
+/**
+ * Brings a terminal from one frame to the next with as few bytes as it can: only the cells that
+ * changed, the cursor moved the shortest of the ways it knows, and colors set only when they
+ * change, several in one sequence. A frame is built in a buffer allocated once, for a single
+ * `write`. Rows and columns on screen are those of `screen`, from the top left corner.
+ */
+class renderer {
+  screen shown; // As the terminal shows it.
+  bool stale = true;
+  std::vector<char> buffer;
+  char *out = nullptr;
+  // Where the terminal is, as far as known: -1 for not known.
+  int row = -1, col = -1;
+  int fg = -1, bg = -1;
+  int cursor_visible = -1;
+
+  constexpr void put(const std::string_view bytes) noexcept {
+    out = std::ranges::copy(bytes, out).out;
+  }
+  constexpr void put_number(const int n) noexcept { out = std::to_chars(out, out + 3, n).ptr; }
+
+  constexpr void move_to(const int r, const int c) noexcept {
+    if (r == row && c == col) {
+      return;
+    }
+    if (r == row && c > col && col >= 0) {
+      put("\033[");
+      if (c - col > 1) {
+        put_number(c - col);
+      }
+      put("C");
+    } else if (r == row + 1 && c == 0 && row >= 0) {
+      put("\r\n");
+    } else {
+      out = format(cursor_position(r + 1, c + 1), out);
+    }
+    row = r;
+    col = c;
+  }
+
+  constexpr void set_colors(const int f, const int b) noexcept {
+    if (f == fg && b == bg) {
+      return;
+    }
+    put("\033[");
+    if (f != fg) {
+      put_number(f);
+    }
+    if (b != bg) {
+      if (f != fg) {
+        put(";");
+      }
+      put_number(b);
+    }
+    put("m");
+    fg = f;
+    bg = b;
+  }
+
+public:
+  constexpr renderer(const int rows, const int cols)
+      // Per cell, a cursor move, 2 colors and a character; then the cursor.
+      : shown(rows, cols), buffer(rows * cols * (10 + 10 + 4) + 32) {}
+
+  /** Makes the next frame redraw every cell, e.g. after the screen was cleared. */
+  constexpr void invalidate() noexcept {
+    stale = true;
+    row = col = fg = bg = cursor_visible = -1;
+  }
+
+  /**
+   * The bytes that turn the last frame into `next`, of the same size, valid until the next call:
+   * the whole of it the first time. The cursor is then left at `cursor`, shown, or hidden.
+   */
+  [[nodiscard]] constexpr std::string_view
+  render(const screen &next, const std::optional<std::pair<int, int>> cursor = std::nullopt) {
+    assert(next.rows() == shown.rows() && next.cols() == shown.cols());
+    out = buffer.data();
+    for (int r = 0; r < next.rows(); ++r) {
+      for (int c = 0; c < next.cols(); ++c) {
+        const cell &wanted = next.at(r, c);
+        if (wanted.width == 0 || (!stale && wanted == shown.at(r, c))) {
+          continue; // Covered by the character before, or unchanged.
+        }
+        move_to(r, c);
+        set_colors(wanted.fg, wanted.bg);
+        put({wanted.glyph.data(), wanted.size});
+        col += wanted.width;
+        if (col == next.cols()) {
+          row = col = -1; // The terminal may or may not have wrapped.
+        }
+      }
+    }
+    shown = next;
+    stale = false;
+    if (cursor) {
+      move_to(cursor->first, cursor->second);
+    }
+    if (cursor_visible != cursor.has_value()) {
+      put(cursor ? cursor_show : cursor_hide);
+      cursor_visible = cursor.has_value();
+    }
+    return {buffer.data(), out};
+  }
+
+  /** Renders `next` and writes it to `fd`, in one `write` unless cut short; false on error. */
+  bool present(const int fd, const screen &next,
+               const std::optional<std::pair<int, int>> cursor = std::nullopt) noexcept {
+    for (std::string_view bytes = render(next, cursor); !bytes.empty();) {
+      const ssize_t n = write(fd, bytes.data(), bytes.size());
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        invalidate();
+        return false;
+      }
+      bytes.remove_prefix(n);
+    }
+    return true;
+  }
+};
+
+} // namespace ansi
@@ -0,0 +1,433 @@
+#pragma once
+#include "endgame.hpp"
+#include "movegen.hpp"
+#include "nnue.hpp"
+#include "transposition.hpp"
+#include <chrono>
+#include <functional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/** Being mated in n plies scores `n - mate_score`; no other score comes within `max_ply`. */
+inline constexpr int mate_score = 32'000;
+inline constexpr int max_ply = 128;
+
+/**
+ * When to stop searching, as the UCI `go` command has it; with none, only at `depth`. Also how:
+ * on how many threads, evaluating with which network, if not the piece-square tables, and
+ * probing which endgame tables, if any.
+ */
+struct search_limits {
+  int depth = max_ply - 1;
+  uint64_t nodes = 0; // Of all threads; 0 for no limit.
+  std::optional<std::chrono::milliseconds> movetime;
+  std::optional<std::chrono::milliseconds> time_left; // On the clock of the side to move.
+  std::chrono::milliseconds increment{0};
+  int moves_to_go = 0; // Until the next time control; 0 for the rest of the game.
+  unsigned threads = 1;
+  const network *net = nullptr;
+  const endgame_tables *endgames = nullptr;
+};
+
+/** What the search has found, as of its last completed depth. */
+struct search_report {
+  int depth = 0;
+  int score = 0; // Centipawns for the side to move, or mate as `mate_score` says.
+  uint64_t nodes = 0;
+  std::chrono::nanoseconds elapsed{0};
+  std::vector<move> pv; // The best line found, starting with the best move.
+  int hashfull = 0;
+
+  [[nodiscard]] std::optional<move> best() const noexcept {
+    return pv.empty() ? std::nullopt : std::optional(pv.front());
+  }
+  [[nodiscard]] double nps() const noexcept {
+    return elapsed.count() ? nodes * 1e9 / elapsed.count() : 0;
+  }
+};
+
+namespace chess_impl {
+
+/** No iteration starts after `soft`, and the one under way is abandoned at `hard`. */
+struct time_budget {
+  std::chrono::nanoseconds soft, hard;
+};
+
+constexpr time_budget make_budget(const search_limits &limits) noexcept {
+  using namespace std::chrono;
+  if (limits.movetime) {
+    return {*limits.movetime, *limits.movetime};
+  }
+  if (!limits.time_left) {
+    return {nanoseconds::max(), nanoseconds::max()};
+  }
+  // A share of what is left for each move to go, or for 30 more if unknown, and most of the
+  // increment; up to 4 times that to finish an iteration, but never more than half the clock.
+  const nanoseconds left = std::max<nanoseconds>(*limits.time_left - milliseconds(20), {});
+  const nanoseconds share =
+      left / (limits.moves_to_go > 0 ? limits.moves_to_go : 30) + limits.increment * 3 / 4;
+  const nanoseconds hard = std::min(share * 4, left / 2);
+  return {std::min(share, hard), hard};
+}
+
+/** A score as stored: mates counted from the position stored rather than from the root. */
+constexpr int to_table(const int score, const int ply) noexcept {
+  return score >= mate_score - max_ply ? score + ply : score <= max_ply - mate_score ? score - ply
+                                                                                     : score;
+}
+constexpr int from_table(const int score, const int ply) noexcept {
+  return score >= mate_score - max_ply ? score - ply : score <= max_ply - mate_score ? score + ply
+                                                                                     : score;
+}
+
+class searcher;
+
+/** What the threads of one search share. */
+struct search_shared {
+  transposition_table &table;
+  const search_limits &limits;
+  std::span<const uint64_t> history;
+  std::stop_token stop_token;
+  time_budget budget = make_budget(limits);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::atomic<bool> stop = false;
+  std::vector<std::unique_ptr<searcher>> searchers;
+
+  [[nodiscard]] std::chrono::nanoseconds elapsed() const noexcept {
+    return std::chrono::steady_clock::now() - start;
+  }
+  [[nodiscard]] uint64_t nodes() const noexcept;
+};
+
+/**
+ * One thread of a search: alpha-beta over the whole tree, principal variation search within it,
+ * then captures only until the position is quiet. Killer moves and the history of cutoffs are
+ * its own; the transposition table is shared, which is all that Lazy SMP coordinates through.
+ */
+class searcher {
+  search_shared &shared;
+  const unsigned id; // 0 for the main thread, which alone stops the search and reports.
+  std::atomic<uint64_t> nodes = 0;
+  std::array<std::array<move, 2>, max_ply> killers{};
+  std::array<std::array<std::array<int, 64>, 64>, 2> history{}; // By side, from and to.
+  std::array<uint64_t, max_ply> path;                           // The keys from the root.
+  std::array<std::array<move, max_ply>, max_ply> pv;
+  std::array<int, max_ply> pv_length;
+  std::array<accumulator, max_ply> accumulators; // By ply, when evaluating with a network.
+
+  /** Polled at every node; only the main thread looks at the clock, every 1024 nodes. */
+  [[nodiscard]] bool stopped() noexcept {
+    if (id == 0 && nodes.load(std::memory_order_relaxed) % 1024 == 0) {
+      if (shared.elapsed() >= shared.budget.hard || shared.stop_token.stop_requested() ||
+          (shared.limits.nodes && shared.nodes() >= shared.limits.nodes)) {
+        shared.stop.store(true, std::memory_order_relaxed);
+      }
+    }
+    return shared.stop.load(std::memory_order_relaxed);
+  }
+
+  void count_node() noexcept {
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  /** Whether the position recurs since the start of the game: the key includes the turn. */
+  [[nodiscard]] bool repeated(const uint64_t key, const int ply) const noexcept {
+    for (int i = ply - 2; i >= 0; i -= 2) {
+      if (path[i] == key) {
+        return true;
+      }
+    }
+    return std::ranges::find(shared.history, key) != shared.history.end();
+  }
+
+  /**
+   * How promising `m` looks, to try the best first: the table's move, then captures, most
+   * valuable victim first and least valuable attacker among equals, then killers, then by history.
+   */
+  [[nodiscard]] int order(const configuration &config, const bool is_white, const move m,
+                          const std::optional<move> table_move, const int ply) const noexcept {
+    if (m == table_move) {
+      return 1 << 30;
+    }
+    const piece victim = config.get_side(!is_white).at(m.to());
+    const bool en_passant = m.dst(config.get_en_passant()) &&
+                            config.get_side(is_white).at(m.from()) == piece::pawn;
+    if (victim != piece::empty || en_passant || m.get_promotion() != piece::empty) {
+      const piece attacker = config.get_side(is_white).at(m.from());
+      return (1 << 24) + piece_values[std::to_underlying(victim)] * 16 +
+             piece_values[std::to_underlying(m.get_promotion())] * 16 -
+             piece_values[std::to_underlying(attacker)] / 100;
+    }
+    if (m == killers[ply][0]) {
+      return (1 << 22) + 1;
+    }
+    if (m == killers[ply][1]) {
+      return 1 << 22;
+    }
+    return history[is_white][m.from()][m.to()];
+  }
+
+  /** The evaluation of the position at `ply`, by the network from its accumulator if any. */
+  [[nodiscard]] int eval(const configuration &config, const bool is_white,
+                         const int ply) const noexcept {
+    const network *const net = shared.limits.net;
+    return net ? evaluate(*net, accumulators[ply], is_white) : evaluate(config, is_white);
+  }
+
+  /** Makes `m` at `ply`, and brings the accumulator of the next up to date; unmaking is free. */
+  [[nodiscard]] configuration make(const configuration &config, const move m,
+                                   const int ply) noexcept {
+    const configuration next = config.make_move(m);
+    if (const network *const net = shared.limits.net) {
+      update(*net, accumulators[ply], config, next, accumulators[ply + 1]);
+    }
+    return next;
+  }
+
+  /** Moves the most promising of the moves from `i` on to `i`, in step with their scores. */
+  static void pick(move_list &moves, std::array<int, 256> &scores, const size_t i) noexcept {
+    size_t best = i;
+    for (size_t j = i + 1; j < moves.size(); ++j) {
+      if (scores[j] > scores[best]) {
+        best = j;
+      }
+    }
+    std::swap(scores[i], scores[best]);
+    moves.swap(i, best);
+  }
+
+  int quiesce(const configuration &config, const bool is_white, int alpha, const int beta,
+              const int ply) {
+    pv_length[ply] = ply;
+    if (stopped()) {
+      return 0;
+    }
+    count_node();
+    if (ply >= max_ply - 1) {
+      return eval(config, is_white, ply);
+    }
+    const bool in_check = king_safety(config, is_white).checkers != 0;
+    int best = -mate_score + ply;
+    if (!in_check) { // Standing pat: the side to move need not capture.
+      best = eval(config, is_white, ply);
+      if (best >= beta) {
+        return best;
+      }
+      alpha = std::max(alpha, best);
+    }
+
+    move_list moves;
+    generate_moves(config, is_white, moves);
+    std::array<int, 256> scores;
+    size_t n = 0;
+    for (size_t i = 0; i < moves.size(); ++i) { // Out of check, captures and promotions only.
+      const int score = order(config, is_white, moves[i], std::nullopt, ply);
+      if (in_check || score >= 1 << 24) {
+        scores[n] = score;
+        moves.swap(n++, i);
+      }
+    }
+    moves.resize(n);
+    for (size_t i = 0; i < moves.size(); ++i) {
+      pick(moves, scores, i);
+      const int score = -quiesce(make(config, moves[i], ply), !is_white, -beta, -alpha, ply + 1);
+      if (score > best) {
+        best = score;
+        alpha = std::max(alpha, score);
+        if (score >= beta) {
+          break;
+        }
+      }
+    }
+    return best;
+  }
+
+  int search(const configuration &config, const bool is_white, int depth, int alpha,
+             const int beta, const int ply) {
+    pv_length[ply] = ply;
+    const uint64_t key = config.get_key();
+    if (ply > 0 && (stopped() || repeated(key, ply))) {
+      return 0;
+    }
+    if (const endgame_tables *const endgames = shared.limits.endgames; ply > 0 && endgames) {
+      // Mates the table knows of but the score cannot tell from others are searched instead.
+      if (const auto known = endgames->probe(config, is_white);
+          known && ply + known->plies < max_ply) {
+        count_node();
+        const int mate = mate_score - ply - known->plies;
+        return known->outcome > 0 ? mate : known->outcome < 0 ? -mate : 0;
+      }
+    }
+    const bool in_check = king_safety(config, is_white).checkers != 0;
+    depth += in_check; // Looking one ply further after a check costs little: few replies.
+    if (depth <= 0 || ply >= max_ply - 1) {
+      return quiesce(config, is_white, alpha, beta, ply);
+    }
+    count_node();
+
+    std::optional<move> table_move;
+    if (const auto entry = shared.table.probe(key)) {
+      table_move = entry->best;
+      const int score = from_table(entry->score, ply);
+      if (ply > 0 && beta - alpha == 1 && entry->depth >= depth &&
+          (entry->kind == bound::exact || (entry->kind == bound::lower && score >= beta) ||
+           (entry->kind == bound::upper && score <= alpha))) {
+        return score;
+      }
+    }
+
+    move_list moves;
+    generate_moves(config, is_white, moves);
+    if (moves.empty()) {
+      return in_check ? -mate_score + ply : 0;
+    }
+    std::array<int, 256> scores;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      scores[i] = order(config, is_white, moves[i], table_move, ply);
+    }
+
+    path[ply] = key;
+    const int original_alpha = alpha;
+    int best = -mate_score;
+    std::optional<move> best_move;
+    for (size_t i = 0; i < moves.size(); ++i) {
+      pick(moves, scores, i);
+      const move m = moves[i];
+      const configuration next = make(config, m, ply);
+      shared.table.prefetch(next.get_key());
+      // The first move is searched in full; the rest only to show they are no better, unless so.
+      int score;
+      if (i == 0) {
+        score = -search(next, !is_white, depth - 1, -beta, -alpha, ply + 1);
+      } else {
+        score = -search(next, !is_white, depth - 1, -alpha - 1, -alpha, ply + 1);
+        if (alpha < score && score < beta) {
+          score = -search(next, !is_white, depth - 1, -beta, -alpha, ply + 1);
+        }
+      }
+      if (shared.stop.load(std::memory_order_relaxed)) {
+        return 0;
+      }
+      if (score > best) {
+        best = score;
+        best_move = m;
+      }
+      if (score > alpha) {
+        alpha = score;
+        pv[ply][ply] = m;
+        std::copy(&pv[ply + 1][ply + 1], &pv[ply + 1][pv_length[ply + 1]], &pv[ply][ply + 1]);
+        pv_length[ply] = pv_length[ply + 1];
+      }
+      if (alpha >= beta) {
+        if (scores[i] < 1 << 24) { // A quiet move: remember it for siblings and their kin.
+          if (killers[ply][0] != m) {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = m;
+          }
+          int &h = history[is_white][m.from()][m.to()];
+          h = std::min(h + depth * depth, 1 << 20);
+        }
+        break;
+      }
+    }
+
+    shared.table.store(key, {best_move, to_table(best, ply), depth,
+                             best >= beta             ? bound::lower
+                             : best > original_alpha ? bound::exact
+                                                     : bound::upper});
+    return best;
+  }
+
+public:
+  searcher(search_shared &shared, const unsigned id) : shared(shared), id(id) {}
+
+  [[nodiscard]] uint64_t get_nodes() const noexcept {
+    return nodes.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Deepens one ply at a time until stopped. Helpers start half of them a ply deeper, so that
+   * they get ahead of the main thread and fill the table with what it will need next.
+   */
+  void iterate(const ply &root, const std::function<void(const search_report &)> &report,
+               search_report &result) {
+    if (shared.limits.net) {
+      accumulators[0] = refresh(*shared.limits.net, root.config);
+    }
+    for (int depth = 1 + (id % 2); depth <= shared.limits.depth; ++depth) {
+      const int score = search(root.config, root.white_turn, depth, -mate_score, mate_score, 0);
+      if (shared.stop.load(std::memory_order_relaxed)) {
+        break;
+      }
+      if (id != 0) {
+        continue;
+      }
+      result = {depth,
+                score,
+                shared.nodes(),
+                shared.elapsed(),
+                std::vector(&pv[0][0], &pv[0][pv_length[0]]),
+                shared.table.hashfull()};
+      if (report) {
+        report(result);
+      }
+      if (shared.elapsed() >= shared.budget.soft || std::abs(score) >= mate_score - depth) {
+        break; // Too late for another iteration, or a mate found within the depth searched.
+      }
+    }
+    if (id == 0) {
+      shared.stop.store(true, std::memory_order_relaxed);
+    }
+  }
+};
+
+inline uint64_t search_shared::nodes() const noexcept {
+  uint64_t total = 0;
+  for (const auto &s : searchers) {
+    total += s->get_nodes();
+  }
+  return total;
+}
+
+} // namespace chess_impl
+
+/**
+ * Looks for the best move of `root` within `limits`, on `limits.threads` threads sharing `table`,
+ * and returns what the main thread found at the last depth it completed. `history` holds the keys
+ * of earlier positions of the game, which the search treats as draws if repeated. `report` is
+ * called after each completed depth; a stop requested through `stop` ends the search early.
+ */
+inline search_report search(const ply &root, const search_limits &limits,
+                            transposition_table &table,
+                            const std::span<const uint64_t> history = {},
+                            const std::function<void(const search_report &)> &report = {},
+                            const std::stop_token stop = {}) {
+  chess_impl::search_shared shared{table, limits, history, stop};
+  for (unsigned i = 0; i < std::max(limits.threads, 1u); ++i) {
+    shared.searchers.push_back(std::make_unique<chess_impl::searcher>(shared, i));
+  }
+  table.new_search();
+  search_report result;
+  {
+    std::vector<std::jthread> helpers;
+    for (size_t i = 1; i < shared.searchers.size(); ++i) {
+      helpers.emplace_back([&, i] {
+        search_report ignored;
+        shared.searchers[i]->iterate(root, {}, ignored);
+      });
+    }
+    shared.searchers.front()->iterate(root, report, result);
+  }
+  result.nodes = shared.nodes();
+  result.elapsed = shared.elapsed();
+  if (result.pv.empty()) { // Stopped before the first depth completed.
+    move_list moves;
+    generate_moves(root.config, root.white_turn, moves);
+    if (!moves.empty()) {
+      result.pv.push_back(moves[0]);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,160 @@
+#include "epd.hpp"
+#include "mapped_file.hpp"
+#include "selfplay.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Usage: selfplay openings.epd games.pgn [games=100] [nodes=10000] [concurrency=all cores]
+ *                 [network a] [network b]
+ *
+ * Plays engine A against engine B from the positions of `openings.epd`, each twice with colors
+ * swapped, `concurrency` games at a time, each search on one thread to `nodes` nodes. A evaluates
+ * with `network a` and B with `network b`, each with the piece-square tables if "-" or not given.
+ * Appends the games to `games.pgn` a few at a time, and prints a line per game then the totals as
+ * `key=value` pairs: the score of A against B, as an Elo difference with its 95% margin.
+ */
+int main(const int argc, const char *argv[]) {
+  if (argc < 3) {
+    std::fprintf(stderr,
+                 "usage: %s openings.epd games.pgn [games] [nodes] [concurrency] [network a] "
+                 "[network b]\n",
+                 argv[0]);
+    return 2;
+  }
+  const mapped_file file(argv[1]);
+  if (!file) {
+    std::perror(argv[1]);
+    return 2;
+  }
+  FILE *const out = std::fopen(argv[2], "a");
+  if (!out) {
+    std::perror(argv[2]);
+    return 2;
+  }
+  const size_t games = argc > 3 ? std::max(std::strtoull(argv[3], nullptr, 10), 2ull) / 2 * 2 : 100;
+  const uint64_t nodes = argc > 4 ? std::max(std::strtoull(argv[4], nullptr, 10), 1ull) : 10'000;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned concurrency = argc > 5 ? std::max(std::atoi(argv[5]), 1) : cores;
+  std::array<mapped_file, 2> network_files{mapped_file(""), mapped_file("")};
+  std::array<search_limits, 2> players; // A's, then B's.
+  for (int i = 0; i < 2; ++i) {
+    players[i].nodes = nodes;
+    if (argc > 6 + i && std::string_view(argv[6 + i]) != "-") {
+      network_files[i] = mapped_file(argv[6 + i]);
+      players[i].net = network::load(network_files[i].view());
+      if (!players[i].net) {
+        std::fprintf(stderr, "%s: not a network\n", argv[6 + i]);
+        return 2;
+      }
+    }
+  }
+
+  const std::string_view text(reinterpret_cast<const char *>(file.view().data()),
+                              file.view().size());
+  std::vector<ply> openings;
+  for (const auto range : std::views::split(text, '\n')) {
+    std::string_view line(range);
+    if (line.ends_with('\r')) {
+      line.remove_suffix(1);
+    }
+    if (const auto position = parse_epd(line)) {
+      openings.push_back(position->position);
+    }
+  }
+  if (openings.empty()) {
+    std::fprintf(stderr, "%s: no positions\n", argv[1]);
+    return 2;
+  }
+  std::printf("selfplay version=1 openings=%zu games=%zu nodes=%llu concurrency=%u eval_a=%s "
+              "eval_b=%s\n",
+              openings.size(), games, static_cast<unsigned long long>(nodes), concurrency,
+              players[0].net ? "network" : "tables", players[1].net ? "network" : "tables");
+  std::fflush(stdout);
+
+  // Games are written out a megabyte at a time, outside the lock: `fwrite` keeps chunks whole.
+  std::mutex mutex;
+  std::string pending;
+  std::array<uint64_t, 3> outcomes{}; // Wins, draws and losses of A.
+  std::array<uint64_t, 2> total_nodes{}, total_depths{}, total_searches{};
+  uint64_t total_plies = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  std::atomic<size_t> next = 0;
+  const auto work = [&] {
+    std::array<transposition_table, 2> tables{transposition_table(8), transposition_table(8)};
+    std::string written;
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < games;) {
+      const ply &opening = openings[i / 2 % openings.size()];
+      const int white = i % 2; // A plays white first, then black.
+      for (transposition_table &table : tables) {
+        table.clear();
+      }
+      const played_game game = play_game(opening, {&players[white], &players[!white]},
+                                         {&tables[white], &tables[!white]});
+      const int outcome = game.result == game_result::draw                           ? 1
+                          : (game.result == game_result::white_wins) == (white == 0) ? 0
+                                                                                     : 2;
+
+      const std::pair<std::string_view, std::string> tags[]{
+          {"Event", "selfplay"},
+          {"Round", std::to_string(i + 1)},
+          {"White", white == 0 ? "A" : "B"},
+          {"Black", white == 0 ? "B" : "A"},
+          {"Termination", std::string(game_end_names[std::to_underlying(game.end)])}};
+      append_pgn(written, tags, opening, game.moves, game.result);
+      std::string chunk;
+      {
+        const std::scoped_lock lock(mutex);
+        ++outcomes[outcome];
+        for (int color = 0; color < 2; ++color) {
+          const int player = color == white ? 0 : 1;
+          total_nodes[player] += game.nodes[color];
+          total_depths[player] += game.depths[color];
+          total_searches[player] += game.searches[color];
+        }
+        total_plies += game.moves.size();
+        pending += written;
+        if (pending.size() >= 1 << 20) {
+          chunk.swap(pending);
+        }
+        const double seconds = std::chrono::duration<double>(game.elapsed).count();
+        std::printf("game=%zu opening=%zu white=%s result=%s end=%s plies=%zu seconds=%.3f "
+                    "nps=%.0f\n",
+                    i + 1, i / 2 % openings.size() + 1, white == 0 ? "A" : "B",
+                    std::array{"*", "1-0", "1/2-1/2", "0-1"}[std::to_underlying(game.result)],
+                    game_end_names[std::to_underlying(game.end)].data(), game.moves.size(),
+                    seconds, (game.nodes[0] + game.nodes[1]) / seconds);
+        std::fflush(stdout);
+      }
+      std::fwrite(chunk.data(), 1, chunk.size(), out);
+      written.clear();
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned i = 1; i < concurrency; ++i) {
+      workers.emplace_back(work);
+    }
+    work();
+  }
+  std::fwrite(pending.data(), 1, pending.size(), out);
+  if (std::fclose(out) != 0) {
+    std::perror(argv[2]);
+    return 1;
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const elo_estimate elo = estimate_elo(outcomes[0], outcomes[1], outcomes[2]);
+  const auto depth = [&](const int player) {
+    return total_searches[player] ? double(total_depths[player]) / total_searches[player] : 0;
+  };
+  std::printf("games=%zu wins=%llu draws=%llu losses=%llu elo=%.1f margin=%.1f nps=%.0f "
+              "depth_a=%.2f depth_b=%.2f plies=%llu seconds=%.3f games_per_second=%.2f\n",
+              games, static_cast<unsigned long long>(outcomes[0]),
+              static_cast<unsigned long long>(outcomes[1]),
+              static_cast<unsigned long long>(outcomes[2]), elo.elo, elo.margin,
+              (total_nodes[0] + total_nodes[1]) / seconds, depth(0), depth(1),
+              static_cast<unsigned long long>(total_plies), seconds, games / seconds);
+}
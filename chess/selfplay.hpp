@@ -0,0 +1,147 @@
+#pragma once
+#include "pgn.hpp"
+#include "search.hpp"
+#include <cmath>
+
+/** When a game between engines is over before either is mated, and how long it may last. */
+struct adjudication_rules {
+  int draw_from_ply = 80;  // Score-based draws only from then on,
+  int draw_score = 10;     // when the scores of both sides stay within this
+  int draw_plies = 16;     // for as many plies in a row.
+  int win_score = 1'000;   // A win when the scores of both sides agree on this,
+  int win_plies = 8;       // for as many plies in a row.
+  int max_plies = 400;     // A draw then.
+};
+
+enum class game_end : uint8_t {
+  checkmate,
+  stalemate,
+  repetition,
+  fifty_moves,
+  material,
+  score,
+  length
+};
+inline constexpr std::array<std::string_view, 7> game_end_names{
+    "checkmate", "stalemate", "repetition", "fifty_moves", "material", "score", "length"};
+
+/** A game played out, with what the searches of each side cost, white's first. */
+struct played_game {
+  std::vector<move> moves;
+  game_result result = game_result::unknown;
+  game_end end = game_end::length;
+  std::array<uint64_t, 2> nodes{};
+  std::array<uint64_t, 2> depths{}; // Summed over the searches.
+  std::array<uint64_t, 2> searches{};
+  std::chrono::nanoseconds elapsed{0};
+};
+
+/** Whether neither side has the material to mate: kings, and at most one knight or bishop. */
+constexpr bool insufficient_material(const configuration &config) noexcept {
+  uint64_t heavy = 0, minor = 0;
+  for (const bool is_white : {true, false}) {
+    const side &s = config.get_side(is_white);
+    heavy |= s.bitboard(piece::pawn) | s.bitboard(piece::rook) | s.bitboard(piece::queen);
+    minor |= s.bitboard(piece::knight) | s.bitboard(piece::bishop);
+  }
+  return !heavy && std::popcount(minor) <= 1;
+}
+
+/**
+ * Plays a game from `start`, white searching within `limits[0]` with `tables[0]`, black within
+ * `limits[1]` with `tables[1]`, until it is over by the rules or by `rules`. Positions repeated
+ * twice, and 50 moves without a capture nor a pawn move, end it drawn.
+ */
+inline played_game play_game(const ply &start, const std::array<const search_limits *, 2> limits,
+                             const std::array<transposition_table *, 2> tables,
+                             const adjudication_rules &rules = {}) {
+  const auto begin = std::chrono::steady_clock::now();
+  played_game game;
+  ply position = start;
+  std::vector<uint64_t> history;
+  int reversible = 0, drawish = 0, winning = 0; // Plies in a row.
+  int last_score = 0;
+  const auto end = [&](const game_result result, const game_end why) {
+    game.result = result;
+    game.end = why;
+    game.elapsed = std::chrono::steady_clock::now() - begin;
+    return game;
+  };
+  const auto won_by = [](const bool is_white) {
+    return is_white ? game_result::white_wins : game_result::black_wins;
+  };
+  for (;;) {
+    move_list moves;
+    generate_moves(position.config, position.white_turn, moves);
+    if (moves.empty()) {
+      return king_safety(position.config, position.white_turn).checkers
+                 ? end(won_by(!position.white_turn), game_end::checkmate)
+                 : end(game_result::draw, game_end::stalemate);
+    }
+    const uint64_t key = position.config.get_key();
+    if (std::ranges::count(history | std::views::reverse | std::views::take(reversible), key) >=
+        2) {
+      return end(game_result::draw, game_end::repetition);
+    }
+    if (reversible >= 100) {
+      return end(game_result::draw, game_end::fifty_moves);
+    }
+    if (insufficient_material(position.config)) {
+      return end(game_result::draw, game_end::material);
+    }
+    if (std::ssize(game.moves) >= rules.max_plies) {
+      return end(game_result::draw, game_end::length);
+    }
+
+    const int turn = !position.white_turn;
+    const search_report report = search(position, *limits[turn], *tables[turn], history);
+    game.nodes[turn] += report.nodes;
+    game.depths[turn] += report.depth;
+    ++game.searches[turn];
+    const move m = *report.best();
+
+    // Both sides must agree, one seeing the other's score from across the board.
+    const bool agree = std::ssize(game.moves) > 0 && (last_score > 0) != (report.score > 0);
+    winning = std::abs(report.score) >= rules.win_score && agree ? winning + 1 : 0;
+    drawish = std::abs(report.score) <= rules.draw_score &&
+                      std::ssize(game.moves) >= rules.draw_from_ply
+                  ? drawish + 1
+                  : 0;
+    last_score = report.score;
+    if (winning >= rules.win_plies) {
+      return end(won_by(position.white_turn == (report.score > 0)), game_end::score);
+    }
+    if (drawish >= rules.draw_plies) {
+      return end(game_result::draw, game_end::score);
+    }
+
+    const side &us = position.config.get_side(position.white_turn);
+    const bool irreversible = us.at(m.from()) == piece::pawn ||
+                              m.dst(position.config.get_side(!position.white_turn));
+    reversible = irreversible ? 0 : reversible + 1;
+    history.push_back(key);
+    game.moves.push_back(m);
+    position = {position.config.make_move(m), !position.white_turn};
+  }
+}
+
+/** The Elo difference that scoring as many wins, draws and losses implies, and its 95% margin. */
+struct elo_estimate {
+  double elo = 0, margin = 0;
+};
+
+inline elo_estimate estimate_elo(const uint64_t wins, const uint64_t draws, const uint64_t losses) {
+  const double games = static_cast<double>(wins + draws + losses);
+  if (games == 0) {
+    return {0, INFINITY};
+  }
+  const double score = (wins + draws / 2.0) / games;
+  const auto squared = [score](const double points) { return (points - score) * (points - score); };
+  const double variance =
+      (wins * squared(1) + draws * squared(0.5) + losses * squared(0)) / games;
+  const double spread = 1.959964 * std::sqrt(variance / games);
+  const auto elo = [](const double s) {
+    return s <= 0 ? -INFINITY : s >= 1 ? INFINITY : -400 * std::log10(1 / s - 1);
+  };
+  return {elo(score), (elo(score + spread) - elo(score - spread)) / 2};
+}
@@ -0,0 +1,93 @@
+#include "epd.hpp"
+#include "mapped_file.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ * Usage: suite file [depth=8] [threads=all cores] [hash megabytes per thread=16] [network]
+ *
+ * Searches every position of the EPD `file` to `depth`, or evaluates it if `depth` is 0, several
+ * positions at a time on `threads` threads. Prints a line per position as it is done, then the
+ * totals, as `key=value` pairs; positions with `bm` or `am` operations are marked solved or
+ * missed, and the exit status is 1 if any was missed. Evaluates with the network mapped from the
+ * file `network` if given, else with the piece-square tables.
+ */
+int main(const int argc, const char *argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "usage: %s file [depth] [threads] [hash megabytes] [network]\n", argv[0]);
+    return 2;
+  }
+  const mapped_file file(argv[1]);
+  if (!file) {
+    std::perror(argv[1]);
+    return 2;
+  }
+  const int depth = argc > 2 ? std::clamp(std::atoi(argv[2]), 0, max_ply - 1) : 8;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned threads = argc > 3 ? std::max(std::atoi(argv[3]), 1) : cores;
+  const size_t megabytes = argc > 4 ? std::max(std::strtoull(argv[4], nullptr, 10), 1ull) : 16;
+  const mapped_file network_file(argc > 5 ? argv[5] : "");
+  const network *const net = network::load(network_file.view());
+  if (argc > 5 && !net) {
+    std::fprintf(stderr, "%s: not a network\n", argv[5]);
+    return 2;
+  }
+
+  const std::string_view text(reinterpret_cast<const char *>(file.view().data()),
+                              file.view().size());
+  std::vector<epd> suite;
+  std::vector<size_t> lines; // Of each position in the file, from 1.
+  size_t number = 0;
+  for (const auto range : std::views::split(text, '\n')) {
+    std::string_view line(range);
+    ++number;
+    if (line.ends_with('\r')) {
+      line.remove_suffix(1);
+    }
+    if (line.find_first_not_of(' ') == line.npos || line.starts_with('#')) {
+      continue;
+    }
+    if (const auto position = parse_epd(line)) {
+      suite.push_back(*position);
+      lines.push_back(number);
+    } else {
+      std::fprintf(stderr, "%s:%zu: not a position\n", argv[1], number);
+    }
+  }
+  std::printf("suite version=1 file=%s positions=%zu depth=%d threads=%u hash_mb=%zu eval=%s\n",
+              argv[1], suite.size(), depth, threads, megabytes, net ? "network" : "tables");
+  std::fflush(stdout);
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto results = run_suite(
+      suite, {.depth = depth, .net = net}, threads, megabytes,
+      [&](const size_t i, const suite_result &result) {
+        const ply &position = suite[i].position;
+        const auto best = result.report.best();
+        std::printf("line=%zu id=\"%.*s\" depth=%d score=%d best=%s nodes=%llu seconds=%.3f "
+                    "result=%s\n",
+                    lines[i], static_cast<int>(suite[i].operation("id").value_or("").size()),
+                    suite[i].operation("id").value_or("").data(), result.report.depth,
+                    result.report.score,
+                    best ? to_san(position.config, position.white_turn, *best).c_str() : "-",
+                    static_cast<unsigned long long>(result.report.nodes),
+                    std::chrono::duration<double>(result.report.elapsed).count(),
+                    !result.solved ? "-" : *result.solved ? "solved" : "missed");
+        std::fflush(stdout);
+      });
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint64_t nodes = 0;
+  size_t solved = 0, missed = 0;
+  for (const suite_result &result : results) {
+    nodes += result.report.nodes;
+    solved += result.solved == true;
+    missed += result.solved == false;
+  }
+  std::printf("positions=%zu solved=%zu missed=%zu nodes=%llu seconds=%.3f nps=%.0f "
+              "positions_per_second=%.1f\n",
+              suite.size(), solved, missed, static_cast<unsigned long long>(nodes), seconds,
+              nodes / seconds, suite.size() / seconds);
+  return missed ? 1 : 0;
+}
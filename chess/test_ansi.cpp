@@ -2,6 +2,38 @@
 #include <cassert>
 #include <sstream>
 
+/** Whether `value` formats as `expected`, into a buffer of just the bound on its size. */
+template <typename T> constexpr bool formats(const T &value, const std::string_view expected) {
+  char chars[ansi::size_bound<T>];
+  return ansi::buffer(chars).append(value).view() == expected;
+}
+
+static_assert(formats(ansi::style::reset, "\033[0m"));
+static_assert(formats(ansi::style::bold, "\033[1m"));
+static_assert(formats(ansi::style::underline, "\033[4m"));
+static_assert(formats(ansi::fg(ansi::color::red), "\033[31m"));
+static_assert(formats(ansi::fg::bright(ansi::color::cyan), "\033[96m"));
+static_assert(formats(ansi::bg(ansi::color::green), "\033[42m"));
+static_assert(formats(ansi::bg::bright(ansi::color::magenta), "\033[105m"));
+static_assert(formats(ansi::fg(255, 255, 255), "\033[38;2;255;255;255m"));
+static_assert(formats(ansi::bg(uint8_t{208}), "\033[48;5;208m"));
+static_assert(formats(ansi::sgr(ansi::fg::bright(ansi::color::black), ansi::style::underline,
+                                ansi::bg(ansi::color::white), ansi::style::italic),
+                      "\033[90;4;47;3m"));
+static_assert(formats(ansi::cursor_position(11, 1), "\033[11;1H"));
+static_assert(formats(ansi::cursor_position(-2147483647 - 1, -2147483647 - 1),
+                      "\033[-2147483648;-2147483648H"));
+static_assert(formats(ansi::cursor_up(3), "\033[3A"));
+static_assert(formats(ansi::cursor_column(255), "\033[255G"));
+
+// Constants, concatenated at compile time.
+static_assert(ansi::cursor_hide == "\033[?25l" && ansi::hard_clear_screen.view().size() == 6);
+constexpr auto reset_all = ansi::clear_screen + ansi::cursor_reset + ansi::cursor_show;
+static_assert(reset_all == "\033[2J\033[H\033[?25h" && reset_all.max_size == 13);
+constexpr auto title = ansi::constant<80>::of(ansi::cursor_position(1, 1), ansi::style::bold,
+                                              "chess", ansi::style::reset);
+static_assert(title == "\033[1;1H\033[1mchess\033[0m");
+
 int main() {
   std::ostringstream os;
 
@@ -45,4 +77,19 @@ int main() {
   os << ansi::sgr(ansi::fg::bright(ansi::color::black), ansi::style::underline,
                   ansi::bg(ansi::color::white), ansi::style::italic);
   assert(os.str() == "\033[90;4;47;3m");
+
+  os.str({});
+  os.clear();
+  os << ansi::cursor_position(11, 1) << ansi::cursor_back(2) << ansi::hard_clear_screen;
+  assert(os.str() == "\033[11;1H\033[2D\033[3J\033c");
+
+  // Appending to a buffer, a frame at a time, writes nothing past it.
+  char chars[64];
+  chars[63] = '!';
+  ansi::buffer buffer(std::span(chars, 63));
+  buffer.append(ansi::cursor_up(1), "ab", ansi::cursor_hide);
+  assert(buffer.view() == "\033[1Aab\033[?25l" && buffer.size() == 12);
+  buffer.clear();
+  buffer.append(ansi::cursor_position(10, 20), ansi::style::reset);
+  assert(buffer.view() == "\033[10;20H\033[0m" && chars[63] == '!');
 }
@@ -0,0 +1,73 @@
+#include "perft.hpp"
+
+/** Plays `game` on both layouts from `fen`, then checks they agree square by square. */
+constexpr bool agree(const std::string_view fen, const std::string_view game) {
+  configuration config = parse_fen(fen)->config;
+  board b(config);
+  for (const auto m : std::views::split(game, ' ')) {
+    config = config.make_move(*parse_move(std::string_view(m)));
+    b.make_move(*parse_move(std::string_view(m)));
+  }
+  for (int s = 0; s < 64; ++s) {
+    const piece white = config.get_white().at(s), black = config.get_black().at(s);
+    if (b.at(s) != (white == piece::empty ? black : white) ||
+        (b.at(s) != piece::empty && b.is_white_at(s) != (white != piece::empty))) {
+      return false;
+    }
+  }
+  return b == board(config);
+}
+
+/** Plays then takes back every move of `fen`, which MUST restore the board exactly. */
+constexpr bool round_trips(const std::string_view fen) {
+  const ply p = *parse_fen(fen);
+  const board before(p.config);
+  board b = before;
+  move_list moves;
+  generate_moves(b, p.white_turn, moves);
+  for (const move m : moves) {
+    const board::undo u = b.make_move(m);
+    if (b != board(p.config.make_move(m))) {
+      return false;
+    }
+    b.unmake_move(u);
+    if (b != before) {
+      return false;
+    }
+  }
+  return !moves.empty();
+}
+
+constexpr std::string_view initial_fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -";
+constexpr std::string_view kiwipete =
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+
+static_assert(board() == board(parse_fen(initial_fen)->config));
+static_assert(board().at(make_square(4, 0)) == piece::king);
+static_assert(board().is_white_at(make_square(4, 0)) && !board().is_white_at(make_square(4, 7)));
+static_assert(board().king_square(false) == make_square(4, 7));
+static_assert(board().get_side(true).bitboard(piece::rook) == 0x81);
+
+// Captures, en passant, castling and promotion, each with the rights and square they affect.
+static_assert(agree(initial_fen, "e2e4 d7d5 e4d5 d8d5 b1c3"));
+static_assert(agree(initial_fen, "e2e4 a7a6 e4e5 d7d5 e5d6"));
+static_assert(agree(initial_fen, "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 e1g1"));
+static_assert(agree(initial_fen, "a2a4 b7b5 a4b5 a7a6 b5a6 c8b7 a6b7 b8c6 b7a8q"));
+static_assert(agree(kiwipete, "e1c1 e8g8 e5f7 f8f7"));
+
+static_assert(round_trips(initial_fen));
+static_assert(round_trips("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -"));
+static_assert(round_trips("4k3/8/8/3pP3/8/8/8/4K3 w - d6"));
+
+int main() {
+  assert(round_trips(kiwipete));
+  assert(round_trips("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"));
+
+  board b(parse_fen(kiwipete)->config);
+  const board before = b;
+  assert(perft(b, true, 3) == 97'862);
+  assert(perft(b, true, 4) == 4'085'603);
+  assert(b == before);
+  b = board();
+  assert(perft(b, true, 5) == 4'865'609);
+}
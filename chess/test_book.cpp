@@ -0,0 +1,74 @@
+#include "book.hpp"
+#include <cstdlib>
+
+/** The Polyglot code of `text`, in coordinates, played in `fen`. */
+constexpr uint16_t code(const std::string_view fen, const std::string_view text) {
+  return book_move(parse_fen(fen)->config, *parse_move(text));
+}
+
+constexpr std::string_view initial = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -";
+static_assert(code(initial, "e2e4") == 796 && code(initial, "g1f3") == 405);
+static_assert(code("4k3/8/8/8/8/8/8/R3K2R w KQ -", "e1g1") == code(initial, "e1h1"));
+static_assert(code("4k3/8/8/8/8/8/8/R3K2R w KQ -", "e1c1") == 256);
+static_assert(code("r3k3/8/8/8/8/8/8/4K3 b q -", "e8c8") == (7 << 9 | 4 << 6 | 7 << 3));
+static_assert(code("4k3/P7/8/8/8/8/8/4K3 w - -", "a7a8q") == (4 << 12 | 6 << 9 | 7 << 3));
+static_assert(code("4k3/P7/8/8/8/8/8/4K3 w - -", "a7a8n") == (1 << 12 | 6 << 9 | 7 << 3));
+
+/** The Polyglot key after `moves`, in coordinates and separated by spaces, from the start. */
+uint64_t key_after(const std::string_view moves) {
+  configuration config;
+  bool is_white = true;
+  for (const auto m : std::views::split(moves, ' ')) {
+    config = config.make_move(*parse_move(std::string_view(m)));
+    is_white = !is_white;
+  }
+  return polyglot_key(config, is_white);
+}
+
+int main() {
+  // Polyglot's published keys, relative to the initial position's, as the queens and kings stand
+  // alike: en passant counts after 1. e4 d5 2. e5 f5 and after 3. c4, not after 1. e4.
+  const uint64_t initial_key = polyglot_key(configuration(), true);
+  for (const auto &[moves, key] : std::initializer_list<std::pair<std::string_view, uint64_t>>{
+           {"e2e4", 0x823C9B50FD114196},
+           {"e2e4 d7d5", 0x0756B94461C50FB0},
+           {"e2e4 d7d5 e4e5", 0x662FAFB965DB29D4},
+           {"e2e4 d7d5 e4e5 f7f5", 0x22A48B5A8E47FF78},
+           {"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3C8123EA7B067637},
+           {"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5C3F9B829B279560}}) {
+    assert((key_after(moves) ^ initial_key) == (key ^ 0x463B96181691FC9C));
+  }
+
+  // 1. e4 in 3 games, 2 won by white; 1. d4 in 2, both drawn; 1. c4 in 1, below the minimum.
+  std::u8string games;
+  for (const auto *game : {u8"1. e4 e5 1-0", u8"1. e4 e5 1-0", u8"1. e4 c5 0-1",
+                           u8"1. d4 d5 1/2-1/2", u8"1. d4 Nf6 1/2-1/2", u8"1. c4 e5 1-0"}) {
+    games += game;
+    games += u8"\n\n";
+  }
+  const position_counter counter = import_pgn(games, 2, 4);
+  const std::vector<book_entry> entries = make_book(counter.positions, 1, 2);
+  assert(entries.size() == 2);
+
+  char path[] = "/tmp/test_book.XXXXXX";
+  const int fd = mkstemp(path);
+  assert(fd >= 0 && save_book(fd, entries));
+  close(fd);
+  {
+    const opening_book book(path);
+    assert(book.size() == 2);
+    const ply start{configuration(), true};
+    const auto moves = book.moves(start);
+    assert(moves.size() == 2 && to_string(moves[0].first) == "e2e4" && moves[0].second == 65535);
+    assert(to_string(moves[1].first) == "d2d4" && moves[1].second == 65535 * 2 / 4);
+    assert(book.moves({configuration().make_move(moves[0].first), false}).empty());
+
+    // Drawn by weight: 1. e4 for the first two thirds or so of the range, 1. d4 for the rest.
+    assert(to_string(*book.pick(start, 0)) == "e2e4");
+    assert(to_string(*book.pick(start, UINT64_MAX / 2)) == "e2e4");
+    assert(to_string(*book.pick(start, UINT64_MAX)) == "d2d4");
+    assert(!book.pick({configuration().make_move(moves[1].first), false}, 0));
+  }
+  unlink(path);
+  assert(!opening_book(path).size());
+}
@@ -0,0 +1,185 @@
+#include "perft.hpp"
+#include <random>
+#include <string_view>
+
+/** The squares named in `names`, e.g. "e2 f3". */
+constexpr uint64_t squares(const std::string_view names) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i + 1 < names.size(); i += 3) {
+    bits |= uint64_t{1} << make_square(names[i] - 'a', names[i + 1] - '1');
+  }
+  return bits;
+}
+
+static_assert(make_square(7, 0) == 0 && make_square(0, 0) == 7 && make_square(0, 7) == 63);
+static_assert(file_of(make_square(4, 6)) == 4 && rank_of(make_square(4, 6)) == 6);
+
+static_assert(knight_attacks(make_square(6, 0)) == squares("e2 f3 h3"));
+static_assert(knight_attacks(make_square(0, 7)) == squares("b6 c7"));
+static_assert(king_attacks(make_square(0, 0)) == squares("a2 b1 b2"));
+static_assert(king_attacks(make_square(4, 3)) == squares("d3 d4 d5 e3 e5 f3 f4 f5"));
+static_assert(pawn_attacks(true, make_square(4, 1)) == squares("d3 f3"));
+static_assert(pawn_attacks(true, make_square(7, 1)) == squares("g3"));
+static_assert(pawn_attacks(false, make_square(0, 6)) == squares("b6"));
+
+static_assert(rook_attacks(make_square(0, 0), 0) ==
+              squares("a2 a3 a4 a5 a6 a7 a8 b1 c1 d1 e1 f1 g1 h1"));
+static_assert(rook_attacks(make_square(3, 3), squares("d6 b4 g4 d1")) ==
+              squares("d5 d6 c4 b4 e4 f4 g4 d3 d2 d1"));
+static_assert(bishop_attacks(make_square(2, 0), squares("d2 a3")) == squares("b2 a3 d2"));
+static_assert(queen_attacks(make_square(7, 7), squares("g7")) ==
+              squares("g8 f8 e8 d8 c8 b8 a8 h7 h6 h5 h4 h3 h2 h1 g7"));
+
+constexpr configuration initial;
+static_assert(initial.test_move(piece::knight, move(make_square(6, 0), make_square(5, 2))));
+static_assert(!initial.test_move(piece::knight, move(make_square(6, 0), make_square(6, 2))));
+static_assert(!initial.test_move(piece::rook, move(make_square(0, 0), make_square(0, 2))));
+static_assert(!initial.test_move(piece::king, move(make_square(7, 0), make_square(0, 1))));
+
+/** Plays the space-separated moves of `game` from the initial position, white first. */
+constexpr configuration play(const std::string_view game) {
+  configuration config;
+  for (const auto m : std::views::split(game, ' ')) {
+    config = config.make_move(*parse_move(std::string_view(m)));
+  }
+  return config;
+}
+
+constexpr bool has_move(const configuration &config, const bool is_white,
+                        const std::string_view m) {
+  move_list moves;
+  generate_moves(config, is_white, moves);
+  return std::ranges::count(moves, *parse_move(m)) == 1;
+}
+
+static_assert(perft(initial, true, 1) == 20);
+static_assert(perft(initial, true, 2) == 400);
+
+// The side's nibbles follow its pieces as they move, are captured and are promoted.
+static_assert(play("e2e4 d7d5 e4d5").get_white().at(make_square(4, 3)) == piece::empty);
+static_assert(play("e2e4 d7d5 e4d5").get_white().at(make_square(3, 4)) == piece::pawn);
+static_assert(play("e2e4 d7d5 e4d5").get_black().size() == 15);
+static_assert(play("g1f3 b8c6").get_white().bitboard(piece::knight) == squares("b1 f3"));
+
+// En passant, only right after the double step, and not when it uncovers a check along the rank.
+static_assert(has_move(play("e2e4 a7a6 e4e5 d7d5"), true, "e5d6"));
+static_assert(!has_move(play("e2e4 a7a6 e4e5 d7d5 a2a3 a6a5"), true, "e5d6"));
+static_assert(play("e2e4 a7a6 e4e5 d7d5 e5d6").get_black().at(make_square(3, 4)) == piece::empty);
+
+// Check evasions, and promotion to each piece, captures included.
+static_assert(perft(play("f2f3 e7e5 g2g4 d8h4"), true, 1) == 0);
+static_assert(perft(play("e2e4 f7f6 d2d4 g7g5 d1h5"), false, 1) == 0);
+static_assert(perft(play("e2e4 e7e5 d1h5 a7a6 h5f7"), false, 1) == 1);
+constexpr auto promoting = play("a2a4 b7b5 a4b5 a7a6 b5a6 c8b7 a6b7 b8c6");
+static_assert(has_move(promoting, true, "b7a8q") && has_move(promoting, true, "b7a8n") &&
+              has_move(promoting, true, "b7b8r") && !has_move(promoting, true, "b7b8"));
+static_assert(play("a2a4 b7b5 a4b5 a7a6 b5a6 c8b7 a6b7 b8c6 b7a8n").get_white().at(
+                  make_square(0, 7)) == piece::knight);
+
+// Castling, on both sides, until the king or rook moves or a square on the way is attacked.
+constexpr std::string_view developed =
+    "e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 d2d3 d7d6 c1g5 c8g4 b1c3 d8d7 d1d2 g8f6";
+static_assert(has_move(play(developed), true, "e1g1") && has_move(play(developed), true, "e1c1"));
+static_assert(play("e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 e1g1").get_white().at(make_square(5, 0)) ==
+              piece::rook);
+static_assert(play("e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 e1g1").get_white().at(make_square(7, 0)) ==
+              piece::empty);
+constexpr auto rook_moved = play("e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 h1g1 h7h6 g1h1 h6h5");
+static_assert(!has_move(rook_moved, true, "e1g1") && has_move(rook_moved, true, "e1f1"));
+constexpr auto attacked = play("e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 d2d4 c5d4 f3d4 c6d4 c2c3 d8g5 "
+                               "c3d4 g5g2");
+static_assert(!has_move(attacked, true, "e1g1"));
+
+// Coordinate notation and FEN, round trips and rejections.
+static_assert(parse_square("a1") == make_square(0, 0) && parse_square("h8") == make_square(7, 7));
+static_assert(!parse_square("i1") && !parse_square("a9") && !parse_square("a"));
+static_assert(to_string(*parse_move("e7e8q")) == "e7e8q");
+static_assert(to_string(*parse_move("g1f3")) == "g1f3");
+static_assert(parse_move("e7e8n")->get_promotion() == piece::knight);
+static_assert(!parse_move("e7e8k") && !parse_move("e7e") && !parse_move("e7e8qq"));
+constexpr std::string_view kiwipete =
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+constexpr auto start = parse_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+static_assert(start->white_turn && start->config.get_castling() == castling::all);
+static_assert(start->config.get_black().get_pieces() == initial.get_black().get_pieces());
+static_assert(perft(parse_fen(kiwipete)->config, true, 1) == 48);
+static_assert(parse_fen("4k3/8/8/8/8/8/8/4K2R w KQ -")->config.get_castling() ==
+              castling::white_king);
+static_assert(parse_fen("4k3/8/8/3pP3/8/8/8/4K3 w - d6")->config.get_en_passant() ==
+              squares("d6"));
+static_assert(!parse_fen("4k3/8/8/8/8/8/8/4K3 w -") && !parse_fen("4k3/8/8/8/8/8/8/8 w - -"));
+static_assert(!parse_fen("4k3/8/8/8/8/8/8/4K3 x - -") && !parse_fen("4k3/9/8/8/8/8/8/4K3 w - -"));
+static_assert(!parse_fen("4k3/8/8/8/8/8/8/4K3 w - d5") && !parse_fen("4k3/8/8/8/8/8/4K3 w - -"));
+static_assert(to_fen(*parse_fen(kiwipete)) == kiwipete);
+static_assert(to_fen(*start) == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+static_assert(to_fen(*parse_fen("4k3/8/8/3pP3/8/8/8/4K2R w K d6")) ==
+              "4k3/8/8/3pP3/8/8/8/4K2R w K d6 0 1");
+static_assert(to_fen(*parse_fen("8/8/8/8/8/8/8/k6K b - -")) == "8/8/8/8/8/8/8/k6K b - - 0 1");
+
+// Zobrist keys, kept up to date move by move, and equal exactly when the positions are.
+constexpr bool same_key(const std::string_view game, const bool is_white) {
+  return play(game).get_key() == play(game).compute_key(is_white);
+}
+static_assert(initial.get_key() == initial.compute_key(true));
+static_assert(same_key("e2e4 d7d5 e4d5 d8d5", true) && same_key("e2e4 d7d5 e4d5", false));
+static_assert(same_key("e2e4 a7a6 e4e5 d7d5 e5d6", false));
+static_assert(same_key("e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 e1g1", false));
+static_assert(same_key("a2a4 b7b5 a4b5 a7a6 b5a6 c8b7 a6b7 b8c6 b7a8q", false));
+static_assert(play("g1f3 g8f6 b1c3").get_key() == play("b1c3 g8f6 g1f3").get_key());
+static_assert(play("g1f3 g8f6 f3g1 f6g8").get_key() == initial.get_key());
+static_assert(play("g1f3").get_key() != initial.get_key());
+static_assert(play("e2e4").get_key() != play("e2e3 a7a6 e3e4").get_key()); // En passant and turn.
+static_assert(play("g1f3 g8f6 f3g1 f6g8 h1g1 h8g8 g1h1 g8h8").get_key() != initial.get_key());
+constexpr auto after_e4 = parse_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3");
+static_assert(after_e4->config.get_key() == play("e2e4").get_key());
+
+// Attacks seen from the target square, and the check and pins they make.
+constexpr auto pinned = parse_fen("4k3/4r3/8/8/2n5/8/4N3/2B1K3 w - -")->config;
+static_assert(attackers_to(pinned, make_square(4, 0), pinned.occupancy()) == 0);
+static_assert(attackers_to(pinned, make_square(3, 1), pinned.occupancy()) == squares("c4 c1 e1"));
+static_assert(king_safety(pinned, true).pinned == squares("e2"));
+static_assert(king_safety(pinned, true).checkers == 0);
+static_assert(!pinned.try_move(piece::knight, *parse_move("e2c3")));
+static_assert(pinned.try_move(piece::king, *parse_move("e1f2")));
+static_assert(!pinned.try_move(piece::king, *parse_move("e1d2")));
+constexpr auto checked = parse_fen("4k3/4r3/8/8/8/8/8/4K1N1 w - -")->config;
+static_assert(king_safety(checked, true).evasions == squares("e2 e3 e4 e5 e6 e7"));
+static_assert(checked.try_move(piece::knight, *parse_move("g1e2")));
+static_assert(!checked.try_move(piece::knight, *parse_move("g1f3")));
+static_assert(!checked.try_move(piece::king, *parse_move("e1e2")));
+static_assert(checked.try_move(piece::king, *parse_move("e1d1")));
+static_assert(!checked.try_move(piece::knight, *parse_move("g1f3"), king_safety(checked, true)));
+static_assert(checked.try_move(piece::knight, *parse_move("g1e2"), king_safety(checked, true)));
+
+int main() {
+  // The tables MUST agree with walking the rays, for every square and many sets of blockers.
+  std::mt19937_64 rng(42);
+  for (int s = 0; s < 64; ++s) {
+    for (int i = 0; i < 1000; ++i) {
+      const uint64_t occupancy = rng() & rng() & (i % 2 ? rng() : ~uint64_t{0});
+      assert(rook_attacks(s, occupancy) ==
+             chess_impl::slide(s, occupancy, chess_impl::rook_directions));
+      assert(bishop_attacks(s, occupancy) ==
+             chess_impl::slide(s, occupancy, chess_impl::bishop_directions));
+    }
+  }
+  const configuration config;
+  assert(config.test_move(piece::knight, move(make_square(1, 7), make_square(2, 5))));
+  assert(!config.test_move(piece::queen, move(make_square(3, 0), make_square(3, 3))));
+  assert(!config.test_move(piece::bishop, move(make_square(2, 0), make_square(4, 2))));
+
+  assert(perft(config, true, 3) == 8'902);
+  assert(perft(config, true, 4) == 197'281);
+  assert(perft(config, true, 5) == 4'865'609);
+
+  // Split among threads, or sped up by the table, the counts stay the same.
+  const ply p = *parse_fen(kiwipete);
+  perft_table table(1);
+  assert(perft(p.config, true, 3, &table) == 97'862);
+  assert(perft(p.config, true, 3, &table) == 97'862);
+  uint64_t nodes = 0;
+  for (const auto &[m, n] : divide(p.config, true, 3, 4, &table)) {
+    nodes += n;
+  }
+  assert(nodes == 97'862);
+}
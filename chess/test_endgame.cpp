@@ -0,0 +1,134 @@
+#include "search.hpp"
+#include <cstdlib>
+
+/** The table and entry of `fen`. */
+constexpr std::pair<endgame_material, size_t> locate(const std::string_view fen) {
+  const ply p = *parse_fen(fen);
+  return chess_impl::endgame_locate(p.config, p.white_turn);
+}
+
+/** Whether the position at the entry of `fen` is `fen`, but perhaps mirrored or colors swapped. */
+constexpr bool round_trips(const std::string_view fen) {
+  const auto [material, index] = locate(fen);
+  const auto p = chess_impl::endgame_position(material, index);
+  return p && chess_impl::endgame_locate(p->config, p->white_turn).second == index;
+}
+
+static_assert(endgame_material{0x10000, 0x01000}.name() == "KQvKR");
+static_assert(
+    std::ranges::equal(endgame_materials(3) | std::views::transform(&endgame_material::name),
+                       std::array{"KQvK", "KRvK", "KBvK", "KNvK", "KPvK"}));
+static_assert(std::ranges::count(endgame_materials(4), endgame_material{0x01000, 0x00100}) == 1);
+static_assert(endgame_materials(4).back().name() == "KPPvK");
+
+// Mirrored, or colors swapped, a position is the same entry; black is the strong side in the last.
+static_assert(locate("8/8/8/8/8/8/1k6/KQ6 w - -") == locate("8/8/8/8/8/8/6k1/6QK w - -"));
+static_assert(locate("8/8/8/8/8/8/1k6/KQ6 w - -") == locate("KQ6/1k6/8/8/8/8/8/8 w - -"));
+static_assert(locate("8/8/8/8/8/8/1k6/KQ6 w - -") == locate("kq6/1K6/8/8/8/8/8/8 b - -"));
+static_assert(locate("8/8/8/8/8/3k4/8/1KQ5 w - -") == locate("8/8/8/8/2k5/Q7/K7/8 w - -"));
+static_assert(locate("8/8/8/8/8/8/1k6/KQ6 w - -") != locate("8/8/8/8/8/8/1k6/KQ6 b - -"));
+static_assert(locate("8/8/4k3/8/8/4P3/8/4K3 w - -") == locate("4k3/8/4p3/8/8/4K3/8/8 b - -"));
+static_assert(locate("8/8/4k3/8/8/4P3/8/4K3 w - -") != locate("4K3/8/4P3/8/8/4k3/8/8 w - -"));
+static_assert(round_trips("8/8/3k4/8/8/2N5/5K2/7B b - -"));
+static_assert(round_trips("8/5p2/8/8/k7/8/8/7K b - -"));
+static_assert(!chess_impl::endgame_position({0x10000, 0}, 0)); // Both kings on the same square.
+static_assert(!chess_impl::endgame_position(locate("8/8/8/8/8/8/8/KQk5 w - -").first,
+                                            locate("8/8/8/8/8/8/8/KQk5 w - -").second));
+
+// Pawns step back, 2 squares from the fourth rank; other pieces go back as they would go on.
+static_assert(chess_impl::endgame_unmoves(piece::pawn, true, *parse_square("e4"), 0) ==
+              (uint64_t{1} << *parse_square("e3") | uint64_t{1} << *parse_square("e2")));
+static_assert(chess_impl::endgame_unmoves(piece::pawn, false, *parse_square("e5"),
+                                          uint64_t{1} << *parse_square("e7")) ==
+              uint64_t{1} << *parse_square("e6"));
+static_assert(chess_impl::endgame_unmoves(piece::pawn, true, *parse_square("e2"), 0) == 0);
+static_assert(chess_impl::endgame_unmoves(piece::knight, true, *parse_square("a1"), 0) ==
+              knight_attacks(*parse_square("a1")));
+
+/** What `tables` say of `fen`. */
+std::optional<endgame_result> probe(const endgame_tables &tables, const std::string_view fen) {
+  const ply p = *parse_fen(fen);
+  return tables.probe(p.config, p.white_turn);
+}
+
+/** The longest mate in a table, in plies, with the side that mates to move. */
+int longest(const std::span<const uint8_t> entries) {
+  int plies = 0;
+  for (const uint8_t entry : entries) {
+    if (const auto result = chess_impl::endgame_decode(entry);
+        entry != chess_impl::endgame_invalid && result.outcome > 0) {
+      plies = std::max(plies, result.plies);
+    }
+  }
+  return plies;
+}
+
+int main() {
+  // The rook's: capturing it leads to bare kings, which need no table.
+  endgame_tables tables;
+  const endgame_material rook = endgame_materials(3)[1];
+  const std::vector<uint8_t> made = generate_endgame(rook, tables);
+  tables.add(rook, made);
+  assert(longest(made) == 31); // Mate in 16 moves.
+
+  assert((probe(tables, "k7/8/1K6/8/8/8/8/6R1 w - -") == endgame_result{1, 1}));
+  assert((probe(tables, "K7/8/1k6/8/8/8/8/6r1 b - -") == endgame_result{1, 1}));
+  assert((probe(tables, "R1k5/8/2K5/8/8/8/8/8 b - -") == endgame_result{-1, 0}));
+  assert((probe(tables, "k7/8/K7/8/8/8/8/1R6 b - -") == endgame_result{0, 0}));
+  assert((probe(tables, "8/8/8/2k5/8/8/8/3RK3 w - -")->outcome == 1));
+  assert((probe(tables, "8/8/8/2k5/8/8/8/3rK3 w - -") == endgame_result{0, 0})); // Taken.
+  assert((probe(tables, "8/8/8/3k4/8/8/3K4/8 w - -") == endgame_result{0, 0}));  // Bare kings.
+  assert(!probe(tables, "8/8/8/3k4/8/8/8/R3K3 w Q -"));
+  assert(!probe(tables, "8/8/8/3k4/8/8/8/B3K3 w - -"));
+
+  // Every entry follows from those its moves lead to.
+  for (size_t i = 0; i < rook.size(); i += 3) {
+    const auto p = chess_impl::endgame_position(rook, i);
+    if (!p) {
+      continue;
+    }
+    move_list moves;
+    generate_moves(p->config, p->white_turn, moves);
+    int win = INT_MAX, loss = 0;
+    bool all_lost = true;
+    for (const move m : moves) {
+      const endgame_result r = *tables.probe(p->config.make_move(m), !p->white_turn);
+      win = r.outcome < 0 ? std::min(win, r.plies + 1) : win;
+      loss = r.outcome > 0 ? std::max(loss, r.plies + 1) : loss;
+      all_lost &= r.outcome > 0;
+    }
+    const bool mated = moves.empty() && king_safety(p->config, p->white_turn).checkers;
+    const endgame_result expected = moves.empty()  ? endgame_result{-mated, 0}
+                                    : win != INT_MAX ? endgame_result{1, win}
+                                    : all_lost       ? endgame_result{-1, loss}
+                                                     : endgame_result{0, 0};
+    assert(tables.probe(p->config, p->white_turn) == expected);
+  }
+
+  // Saved, mapped and probed in place; anything else in the directory is skipped.
+  char directory[] = "/tmp/test_endgame.XXXXXX";
+  assert(mkdtemp(directory));
+  const std::string path = std::string(directory) + "/" + endgame_tables::file_name(rook);
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  assert(fd >= 0 && endgame_tables::save(fd, rook, made));
+  close(fd);
+  const std::string other = std::string(directory) + "/other.egt";
+  close(open(other.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644));
+  {
+    endgame_tables loaded;
+    assert(loaded.load(directory) == 1 && loaded.contains(rook));
+    assert(!loaded.contains(endgame_materials(3)[0]));
+    const std::string_view fen = "8/8/8/8/3k4/8/8/R3K3 b - -";
+    assert(probe(loaded, fen) == probe(tables, fen) && probe(loaded, fen)->outcome == -1);
+
+    // The search scores the mate the table knows of, far beyond its depth.
+    transposition_table table(4);
+    search_limits limits{.depth = 3, .endgames = &loaded};
+    const ply rook = *parse_fen("8/8/8/8/3k4/8/8/R3K3 w - -");
+    const search_report report = search(rook, limits, table);
+    assert(report.score == mate_score - probe(loaded, "8/8/8/8/3k4/8/8/R3K3 w - -")->plies);
+  }
+  unlink(path.c_str());
+  unlink(other.c_str());
+  rmdir(directory);
+}
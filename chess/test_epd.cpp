@@ -0,0 +1,84 @@
+#include "epd.hpp"
+
+constexpr std::string san(const std::string_view fen, const std::string_view coordinates) {
+  const ply p = *parse_fen(fen);
+  return to_san(p.config, p.white_turn, *parse_move(coordinates));
+}
+/** The move in coordinates, or nothing if `san` is no legal move. */
+constexpr std::string coordinates(const std::string_view fen, const std::string_view san) {
+  const ply p = *parse_fen(fen);
+  if (const auto m = parse_san(p.config, p.white_turn, san)) {
+    return to_string(*m);
+  }
+  return {};
+}
+
+constexpr std::string_view start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+constexpr std::string_view kiwipete =
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+constexpr std::string_view rooks = "3k4/8/8/R6R/8/8/8/R3K3 w Q - 0 1";
+constexpr std::string_view promotion = "1n2k3/P7/8/8/8/8/8/4K3 w - - 0 1";
+
+// Pieces, pawns, captures, castling, and telling apart pieces by file, rank or both.
+static_assert(san(start, "g1f3") == "Nf3" && san(start, "e2e4") == "e4");
+static_assert(san(kiwipete, "e1g1") == "O-O" && san(kiwipete, "e1c1") == "O-O-O");
+static_assert(san(kiwipete, "d5e6") == "dxe6" && san(kiwipete, "e2a6") == "Bxa6");
+static_assert(san(kiwipete, "c3b5") == "Nb5" && san(kiwipete, "e5g6") == "Nxg6");
+static_assert(san(rooks, "a5b5") == "Rab5" && san(rooks, "a5a3") == "R5a3");
+static_assert(san(rooks, "a1a3") == "R1a3" && san(rooks, "h5d5") == "Rhd5+");
+static_assert(san(promotion, "a7b8q") == "axb8=Q+" && san(promotion, "a7a8n") == "a8=N");
+static_assert(san("7k/8/8/8/8/8/R7/1R4K1 w - - 0 1", "b1b8") == "Rb8+");
+static_assert(san("7k/R7/8/8/8/8/8/1R4K1 w - - 0 1", "b1b8") == "Rb8#");
+
+// And back, leniently, but never for a move that is ambiguous, illegal or malformed.
+static_assert(coordinates(start, "Nf3") == "g1f3" && coordinates(start, "e4") == "e2e4");
+static_assert(coordinates(kiwipete, "0-0-0") == "e1c1" && coordinates(kiwipete, "O-O+") == "e1g1");
+static_assert(coordinates(kiwipete, "de6") == "d5e6" && coordinates(kiwipete, "Bxa6!?") == "e2a6");
+static_assert(coordinates(rooks, "Rab5") == "a5b5" && coordinates(rooks, "R1a3") == "a1a3");
+static_assert(coordinates(rooks, "Ra5a3") == "a5a3" && coordinates(rooks, "Ra3") == "");
+static_assert(coordinates(promotion, "axb8Q") == "a7b8q");
+static_assert(coordinates(promotion, "a8=N") == "a7a8n" && coordinates(promotion, "a8") == "");
+static_assert(coordinates(start, "Nf4") == "" && coordinates(start, "e5") == "");
+static_assert(coordinates(start, "Nf3x") == "" && coordinates(start, "") == "");
+static_assert(coordinates(start, "O-O") == "");
+
+// EPD operations, with quoted operands, and FEN taken for EPD.
+constexpr auto record =
+    parse_epd(R"(7k/8/8/8/8/8/R7/1R4K1 w - - bm Rb8+; id "ladder; 1";  c0  x ;)");
+static_assert(record && record->position.white_turn && record->operation("bm") == "Rb8+");
+static_assert(record->operation("id") == "ladder; 1" && record->operation("c0") == "x");
+static_assert(!record->operation("am") && !record->operation("b"));
+static_assert(parse_epd(kiwipete) && !parse_epd("8/8/8 w - -") && !parse_epd(""));
+static_assert(names_move(record->position, "Ra8 Rb8+", *parse_move("b1b8")));
+static_assert(names_move(record->position, "a2a8", *parse_move("a2a8")));
+static_assert(!names_move(record->position, "Rb8", *parse_move("a2a8")));
+
+int main() {
+  const std::array suite{
+      *parse_epd("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - bm Qxf7#;"),
+      *parse_epd("4k3/8/8/3q4/8/8/3R4/4K3 w - - bm Rxd5; id \"hanging\";"),
+      *parse_epd("4k3/2p5/3p4/8/8/8/3Q4/4K3 w - - am Qxd6;"),
+      *parse_epd("4k3/8/8/3q4/8/8/3R4/4K3 w - - bm Kf1;"),
+      *parse_epd(start),
+  };
+  size_t calls = 0;
+  const auto searched = run_suite(suite, {.depth = 3}, 2, 1,
+                                  [&](const size_t i, const suite_result &r) {
+                                    assert(i < suite.size() && r.report.depth > 0);
+                                    ++calls;
+                                  });
+  assert(calls == suite.size() && searched.size() == suite.size());
+  assert(searched[0].solved == true && searched[0].report.score == mate_score - 1);
+  assert(searched[1].solved == true && searched[2].solved == true);
+  assert(searched[3].solved == false && !searched[4].solved);
+
+  // Evaluated, the same with the tables as with their network.
+  const auto tables = run_suite(suite, {.depth = 0}, 3, 1);
+  static constexpr network net = make_piece_square_network();
+  const auto networked = run_suite(suite, {.depth = 0, .net = &net}, 1, 1);
+  for (size_t i = 0; i < suite.size(); ++i) {
+    assert(!tables[i].solved && !tables[i].report.best());
+    assert(tables[i].report.score == evaluate(suite[i].position.config, true));
+    assert(networked[i].report.score == tables[i].report.score);
+  }
+}
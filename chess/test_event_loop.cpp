@@ -0,0 +1,39 @@
+#include "event_loop.hpp"
+#include <cassert>
+#include <thread>
+
+int main() {
+  int fds[2];
+  assert(pipe(fds) == 0);
+  event_loop loop(fds[0], 4);
+  assert(loop);
+
+  // Nothing yet.
+  event_loop::events events = loop.wait(std::chrono::milliseconds(0));
+  assert(events.timed_out && events.input.empty() && !events.closed);
+
+  // Input arrives in batches, as much as the buffer holds, the rest at the next call.
+  assert(write(fds[1], "abcdef", 6) == 6);
+  events = loop.wait();
+  assert(events.input == "abcd" && !events.timed_out);
+  events = loop.wait();
+  assert(events.input == "ef");
+
+  // Wakeups from other threads are counted, resizes coalesced.
+  std::jthread([&loop] {
+    loop.notify();
+    loop.notify();
+  }).join();
+  raise(SIGWINCH);
+  raise(SIGWINCH);
+  events = loop.wait();
+  assert(events.notified == 2 && events.resized && events.input.empty());
+  assert(loop.wait(std::chrono::milliseconds(0)).timed_out);
+
+  // The end of input, once.
+  close(fds[1]);
+  events = loop.wait();
+  assert(events.closed && events.input.empty());
+  assert(loop.wait(std::chrono::milliseconds(0)).timed_out);
+  close(fds[0]);
+}
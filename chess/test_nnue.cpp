@@ -0,0 +1,80 @@
+#include "nnue.hpp"
+#include "mapped_file.hpp"
+#include "movegen.hpp"
+#include "search.hpp"
+
+constexpr network piece_squares = make_piece_square_network();
+
+// White's pawn on e2 is to white what black's on e7 is to black.
+static_assert(nnue_feature(true, true, piece::pawn, *parse_square("e2")) ==
+              nnue_feature(false, false, piece::pawn, *parse_square("e7")));
+static_assert(nnue_feature(true, false, piece::king, *parse_square("a8")) == nnue_features - 1);
+
+static_assert(evaluate(configuration(), true) == 0);
+static_assert(evaluate(piece_squares, refresh(piece_squares, configuration()), true) == 0);
+static_assert([] {
+  const configuration before, after = before.make_move(*parse_move("e2e4"));
+  accumulator acc;
+  update(piece_squares, refresh(piece_squares, before), before, after, acc);
+  return acc == refresh(piece_squares, after) && evaluate(piece_squares, acc, true) == 40 &&
+         evaluate(after, true) == 40;
+}());
+
+/**
+ * Checks at every node to `depth` that updating the accumulator move by move matches refreshing
+ * it, that the vector kernels match the scalar ones, and that the network of the piece-square
+ * tables computes them.
+ */
+void walk(const network &net, const configuration &config, const bool is_white,
+          const accumulator &acc, const int depth) {
+  assert(acc == refresh(net, config));
+  const int output = chess_impl::nnue_output_simd(net, acc, is_white);
+  assert(output == chess_impl::nnue_output_scalar(net, acc, is_white));
+  assert(output == evaluate(config, is_white) * nnue_output_scale);
+  if (depth == 0) {
+    return;
+  }
+  move_list moves;
+  generate_moves(config, is_white, moves);
+  for (const move m : moves) {
+    const configuration next = config.make_move(m);
+    accumulator child;
+    update(net, acc, config, next, child);
+    walk(net, next, !is_white, child, depth - 1);
+  }
+}
+
+int main() {
+  for (const auto fen : {
+           "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+           "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+           "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+           "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+       }) {
+    const ply root = *parse_fen(fen);
+    walk(piece_squares, root.config, root.white_turn, refresh(piece_squares, root.config), 3);
+  }
+
+  // Saved, mapped and used in place; anything else is refused.
+  char path[] = "/tmp/test_nnue.XXXXXX";
+  const int fd = mkstemp(path);
+  assert(fd >= 0);
+  assert(piece_squares.save(fd));
+  close(fd);
+  {
+    const mapped_file file(path);
+    assert(file);
+    const network *const net = network::load(file.view());
+    assert(net && std::memcmp(net, &piece_squares, sizeof(network)) == 0);
+    assert(!network::load(file.view().substr(0, file.view().size() - 1)));
+    assert(!network::load(file.view().substr(1)));
+
+    // The search evaluates with it, and still finds the mate.
+    transposition_table table(4);
+    const auto report =
+        search(*parse_fen("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 2 3"),
+               {.depth = 4, .net = net}, table);
+    assert(to_string(*report.best()) == "f3f7" && report.score == mate_score - 1);
+  }
+  unlink(path);
+}
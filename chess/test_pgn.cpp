@@ -0,0 +1,148 @@
+#include "pgn.hpp"
+
+constexpr std::u8string_view games = u8R"([Event "Test"]
+[White "Müller, Jürgen"]
+[Black "O\"Brien \\ Co"]
+[Result "1-0"]
+
+1. e4 e5 2. Nf3 {a comment (with parens)} Nc6 (2... d6 3. d4 (3. Bc4) exd4) 3. Bc4 $1 Bc5
+4. O-O Nf6 5. d3 d6 1-0
+
+[Event "Setup"]
+[FEN "4k3/P7/8/8/8/8/8/4K3 w - - 0 1"]
+[Result "*"]
+
+1. a8=Q+ Kd7 ; the rest of the line
+2. Qb7+ *
+
+[Event "Illegal"]
+[Result "0-1"]
+
+1. e4 e5 2. Ke3 Nf6 0-1
+
+[Event "No marker"]
+[Result "1/2-1/2"]
+
+1.d4 d5
+)";
+
+/** What a reader reports, game by game. */
+struct recorder final : pgn_visitor {
+  int max_ply = 128;
+  std::vector<std::u8string> players;
+  std::vector<int> plies;
+  std::vector<game_result> results;
+  std::vector<bool> valid;
+  std::vector<uint64_t> keys; // Of the last position of each game.
+  int ply = 0;
+  uint64_t key = 0;
+
+  constexpr void tag(const std::u8string_view name, const std::u8string_view value) override {
+    if (name == u8"White" || name == u8"Black") {
+      players.emplace_back(value);
+    }
+  }
+  constexpr bool position(const configuration &config, bool, const int at) override {
+    ply = at;
+    key = config.get_key();
+    return at < max_ply;
+  }
+  constexpr void end_game(const game_result result, const bool is_valid) override {
+    plies.push_back(ply);
+    results.push_back(result);
+    valid.push_back(is_valid);
+    keys.push_back(key);
+  }
+};
+
+constexpr recorder read(const std::u8string_view text, const int max_ply = 128) {
+  recorder r;
+  r.max_ply = max_ply;
+  pgn_reader(text, &r).read();
+  return r;
+}
+
+/** The key after playing `moves`, in coordinates, from the initial position. */
+constexpr uint64_t key_after(const std::string_view moves) {
+  configuration config;
+  for (const auto m : std::views::split(moves, ' ')) {
+    config = config.make_move(*parse_move(std::string_view(m)));
+  }
+  return config.get_key();
+}
+
+// Bad UTF-8 and bad setups make a game invalid; a game may lack tags and marker.
+static_assert(read(u8"[White \"\xFF\"]\n\n1. e4 *").valid == std::vector{false});
+static_assert(read(u8"1. e4 \xFF e5 *\n\n1. e4 {\xC3} e5 *\n\n1. d4 *").valid ==
+              std::vector{false, false, true});
+static_assert(read(u8"[FEN \"8/8 w - -\"]\n\n1. e4 *").valid == std::vector{false});
+static_assert(read(u8"1. e4 e5").plies == std::vector{2} && read(u8"").plies.empty());
+
+int main() {
+  // Tags unescaped, in UTF-8; comments, variations and annotations skipped; results from the
+  // termination marker, else the tag; an illegal move makes the game invalid but not end it.
+  const recorder r = read(games);
+  assert((r.players == std::vector<std::u8string>{u8"Müller, Jürgen", u8"O\"Brien \\ Co"}));
+  assert((r.plies == std::vector{10, 3, 2, 2}));
+  assert((r.results == std::vector{game_result::white_wins, game_result::unknown,
+                                   game_result::black_wins, game_result::draw}));
+  assert((r.valid == std::vector{true, true, false, true}));
+  assert(r.keys[0] == key_after("e2e4 e7e5 g1f3 b8c6 f1c4 f8c5 e1g1 g8f6 d2d3 d7d6"));
+  assert(r.keys[1] == parse_fen("8/1Q1k4/8/8/8/8/8/4K3 b - -")->config.get_key());
+  assert(r.keys[2] == key_after("e2e4 e7e5") && r.keys[3] == key_after("d2d4 d7d5"));
+  assert((read(games, 4).plies == std::vector{4, 3, 2, 2}));
+
+  // Split at game boundaries, parts read alone add up to the whole.
+  const auto bounds = split_pgn(games, 4);
+  assert(bounds.front() == 0 && bounds.back() == games.size() && bounds.size() == 5);
+  for (size_t i = 1; i + 1 < bounds.size(); ++i) {
+    assert(games.substr(bounds[i]).starts_with(u8"[Event") && bounds[i - 1] < bounds[i]);
+  }
+  assert(split_pgn(games, 100).size() == 5 && split_pgn(u8"", 4).size() == 2);
+
+  // A database of many copies gives the same counts on any number of threads.
+  std::u8string database;
+  for (int i = 0; i < 500; ++i) {
+    database += games;
+    database += u8"\n";
+  }
+  const position_counter one = import_pgn(database, 1, 6), three = import_pgn(database, 3, 6);
+  assert(one.games == 2000 && one.invalid == 500 && one.plies == 500 * (6 + 3 + 2 + 2));
+  assert(three.games == one.games && three.invalid == one.invalid && three.plies == one.plies);
+  assert(three.positions.size() == one.positions.size());
+  for (const auto &[key, stats] : one.positions) {
+    const position_stats &other = three.positions.at(key);
+    assert(other.games == stats.games && other.results == stats.results);
+  }
+
+  // The opening tree from the initial position: 1. e4 in 2 games of 4, one won by each side.
+  const auto first = continuations(one.positions, {configuration(), true});
+  assert(first.size() == 2 && to_string(first[0].first) == "e2e4");
+  assert(first[0].second.games == 1000 && first[1].second.games == 500);
+  assert(first[0].second.results[std::to_underlying(game_result::white_wins)] == 500);
+  assert(first[0].second.results[std::to_underlying(game_result::black_wins)] == 500);
+  assert(one.positions.at(configuration().get_key()).games == 1500);
+
+  // Written games read back the same, from a set-up position too, in lines of 80 columns at most.
+  std::string written;
+  std::vector<move> moves;
+  for (int i = 0; i < 30; ++i) {
+    for (const auto m : {"g1f3", "g8f6", "f3g1", "f6g8"}) {
+      moves.push_back(*parse_move(m));
+    }
+  }
+  const std::pair<std::string_view, std::string> tags[]{{"White", "A \"quoted\" name"}};
+  append_pgn(written, tags, {configuration(), true}, moves, game_result::draw);
+  const ply setup = *parse_fen("4k3/P7/8/8/8/8/8/4K3 b - -");
+  const std::array promotion{*parse_move("e8d7"), *parse_move("a7a8q")};
+  append_pgn(written, {}, setup, promotion, game_result::white_wins);
+  assert(written.contains("1. Nf3 Nf6 2. Ng1 Ng8") && written.contains("1... Kd7 2. a8=Q 1-0"));
+  assert(std::ranges::all_of(std::views::split(written, '\n'),
+                             [](const auto line) { return std::ranges::distance(line) <= 80; }));
+  const recorder back = read(std::u8string(written.begin(), written.end()));
+  assert((back.players == std::vector<std::u8string>{u8"A \"quoted\" name"}));
+  assert((back.plies == std::vector{120, 2}) && (back.valid == std::vector{true, true}));
+  assert((back.results == std::vector{game_result::draw, game_result::white_wins}));
+  assert(back.keys[0] == configuration().get_key());
+  assert(back.keys[1] == parse_fen("Q7/3k4/8/8/8/8/8/4K3 b - -")->config.get_key());
+}
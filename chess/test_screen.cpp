@@ -0,0 +1,77 @@
+#include "screen.hpp"
+#include <cstdlib>
+
+using namespace std::string_view_literals;
+
+constexpr uint8_t red = ansi::fg_code(ansi::color::red), blue = ansi::bg_code(ansi::color::blue);
+
+/** The bytes of the frames of `draw` on a 2 by 6 screen, after one with "ab" at the top left. */
+template <typename F> constexpr std::string after(const F draw) {
+  ansi::screen frame(2, 6);
+  ansi::renderer r(2, 6);
+  frame.print(0, 0, "ab", ansi::default_fg, ansi::default_bg);
+  (void)r.render(frame);
+  draw(frame);
+  return std::string(r.render(frame));
+}
+
+// The first frame draws every cell, colors coalesced, and hides the cursor.
+static_assert([] {
+  ansi::screen frame(2, 2);
+  frame.print(1, 0, "xy", red, blue);
+  return std::string(ansi::renderer(2, 2).render(frame));
+}() == "\033[1;1H\033[39;49m  \033[2;1H\033[31;44mxy\033[?25l"sv);
+
+// Then only what changed: nothing, a cell, cells skipped over, or colors alone.
+static_assert(after([](ansi::screen &) {}).empty());
+static_assert(after([](ansi::screen &s) { s.print(0, 1, "c", 39, 49); }) == "\033[1;2Hc");
+static_assert(after([](ansi::screen &s) {
+                s.print(0, 0, "x", 39, 49);
+                s.print(0, 4, "z", 39, 49);
+              }) == "\033[1;1Hx\033[3Cz");
+static_assert(after([](ansi::screen &s) {
+                s.print(0, 0, "x", 39, 49);
+                s.print(1, 0, "y", 39, 49);
+              }) == "\033[1;1Hx\r\ny");
+static_assert(after([](ansi::screen &s) { s.print(0, 0, "ab", red, 49); }) ==
+              "\033[1;1H\033[31mab");
+static_assert(after([](ansi::screen &s) { s.print(1, 5, "q", 39, blue); }) == "\033[2;6H\033[44mq");
+
+// Full-width characters take 2 columns, and give way to what covers half of them.
+static_assert(after([](ansi::screen &s) {
+                s.put(1, 0, "Ｐ", 2, 39, 49);
+                s.print(1, 2, "z", 39, 49);
+              }) == "\033[2;1HＰz");
+static_assert(after([](ansi::screen &s) {
+                s.put(0, 0, "Ｐ", 2, 39, 49);
+                s.print(0, 1, "z", 39, 49);
+              }) == "\033[1;1H z");
+
+// The cursor, where wanted, shown only then.
+static_assert([] {
+  ansi::screen frame(3, 3);
+  ansi::renderer r(3, 3);
+  (void)r.render(frame);
+  const std::string shown(r.render(frame, std::pair(2, 1)));
+  const std::string moved(r.render(frame, std::pair(2, 2)));
+  const std::string hidden(r.render(frame));
+  return shown == "\033[3;2H\033[?25h" && moved == "\033[C" && hidden == "\033[?25l";
+}());
+
+int main() {
+  // Written with a single `write`, the frame reaches the other end of a pipe whole.
+  int fds[2];
+  assert(pipe(fds) == 0);
+  ansi::screen frame(10, 20);
+  ansi::renderer r(10, 20);
+  frame.print(4, 3, "hello", red, blue);
+  const std::string expected(r.render(frame));
+  r.invalidate();
+  assert(r.present(fds[1], frame));
+  std::string got(expected.size() + 1, '\0');
+  assert(read(fds[0], got.data(), got.size()) == std::ssize(expected));
+  got.resize(expected.size());
+  assert(got == expected);
+  close(fds[0]);
+  close(fds[1]);
+}
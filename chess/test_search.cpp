@@ -0,0 +1,54 @@
+#include "search.hpp"
+
+/** The report of a search of `fen` to `depth` on `threads` threads, with a fresh table. */
+search_report search_fen(const std::string_view fen, const int depth, const unsigned threads = 1) {
+  transposition_table table(4);
+  search_limits limits;
+  limits.depth = depth;
+  limits.threads = threads;
+  return search(*parse_fen(fen), limits, table);
+}
+
+static_assert(chess_impl::from_table(chess_impl::to_table(mate_score - 7, 3), 5) == mate_score - 9);
+static_assert(chess_impl::make_budget({.movetime = std::chrono::milliseconds(100)}).hard ==
+              std::chrono::milliseconds(100));
+static_assert(chess_impl::make_budget({.time_left = std::chrono::milliseconds(30'020)}).soft ==
+              std::chrono::seconds(1));
+
+int main() {
+  // Mate in 1, in 2 with the king ladder, and the scores that say so.
+  const auto scholar =
+      search_fen("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 2 3", 4);
+  assert(to_string(*scholar.best()) == "f3f7" && scholar.score == mate_score - 1);
+  const auto ladder = search_fen("7k/8/8/8/8/8/R7/1R4K1 w - -", 5);
+  assert(ladder.score == mate_score - 3 && ladder.pv.size() == 3);
+  const auto mated = search_fen("6k1/R7/8/8/8/8/8/1R4K1 b - -", 4);
+  assert(mated.score == -mate_score + 2);
+
+  // Material, quiescence seeing the recapture, and stalemate as a draw.
+  assert(to_string(*search_fen("4k3/8/8/3q4/8/8/3R4/4K3 w - -", 3).best()) == "d2d5");
+  assert(to_string(*search_fen("4k3/2p5/3q4/8/8/8/3R4/3RK3 w - -", 2).best()) == "d2d6");
+  assert(search_fen("4k3/2p5/3p4/8/8/8/3Q4/4K3 w - -", 3).best() != parse_move("d2d6"));
+  const auto stalemate = search_fen("k7/2Q5/1K6/8/8/8/8/8 b - -", 3);
+  assert(!stalemate.best() && stalemate.score == 0);
+
+  // Repeating a position of the game scores a draw, for the side behind as for the side ahead.
+  const ply behind = *parse_fen("6k1/8/8/8/8/8/q7/6K1 w - -");
+  transposition_table table(4);
+  search_limits limits{.depth = 3};
+  const std::array history{behind.config.make_move(*parse_move("g1h1")).get_key()};
+  assert(search(behind, limits, table, history).score == 0);
+
+  // Helpers share the table without changing what is found.
+  assert(search_fen("7k/8/8/8/8/8/R7/1R4K1 w - -", 5, 4).score == mate_score - 3);
+
+  // Limits on time and nodes, and reports at each depth.
+  limits = {.movetime = std::chrono::milliseconds(50), .threads = 2};
+  int reports = 0;
+  const auto timed = search(ply{configuration(), true}, limits, table, {},
+                            [&](const search_report &r) { reports += r.depth > 0; });
+  assert(timed.best() && reports > 0 && timed.elapsed < std::chrono::milliseconds(500));
+  limits = {.nodes = 10'000};
+  const auto counted = search(ply{configuration(), true}, limits, table);
+  assert(counted.best() && counted.nodes < 20'000);
+}
@@ -0,0 +1,59 @@
+#include "selfplay.hpp"
+#include <cstdlib>
+
+static_assert(insufficient_material(parse_fen("8/8/4k3/8/8/2B5/8/4K3 w - -")->config));
+static_assert(!insufficient_material(parse_fen("8/8/4k3/8/8/2B5/8/4K2N w - -")->config));
+static_assert(!insufficient_material(parse_fen("8/8/4k3/8/8/2P5/8/4K3 w - -")->config));
+
+/** Plays from `fen` with both sides searching to `nodes` nodes, each with a small table. */
+played_game play(const std::string_view fen, const uint64_t nodes,
+                 const adjudication_rules &rules = {}) {
+  transposition_table white(1), black(1);
+  const search_limits limits{.nodes = nodes};
+  return play_game(*parse_fen(fen), {&limits, &limits}, {&white, &black}, rules);
+}
+
+int main() {
+  // Even scores are 0 Elo; 3 points of 4 are 191; margins shrink with more games alike.
+  assert(estimate_elo(10, 20, 10).elo == 0 && estimate_elo(10, 20, 10).margin > 0);
+  assert(std::abs(estimate_elo(5, 5, 0).elo - 190.85) < 0.01);
+  assert(estimate_elo(50, 100, 50).margin < estimate_elo(10, 20, 10).margin);
+  assert(estimate_elo(3, 0, 0).elo == INFINITY);
+
+  // Mate, stalemate, lack of material, and scores that settle a game.
+  const played_game mate = play("6k1/5ppp/8/8/8/8/8/R5K1 w - -", 1000);
+  assert(mate.result == game_result::white_wins && mate.end == game_end::checkmate);
+  assert(mate.moves.size() == 1 && to_string(mate.moves[0]) == "a1a8");
+  assert(mate.searches[0] == 1 && mate.searches[1] == 0 && mate.nodes[0] > 0);
+  const played_game stalemate = play("k7/8/1Q6/8/8/8/8/7K b - -", 1000);
+  assert(stalemate.result == game_result::draw && stalemate.end == game_end::stalemate);
+  const played_game taken = play("8/8/4k3/8/8/2B5/8/4K3 w - -", 1000);
+  assert(taken.end == game_end::material && taken.moves.empty());
+  const played_game queen =
+      play("8/8/4k3/8/8/8/8/3QK3 b - -", 2000, {.win_score = 500, .win_plies = 4});
+  assert(queen.result == game_result::white_wins);
+  assert(queen.end == game_end::score || queen.end == game_end::checkmate);
+
+  // A whole game from the initial position ends by the rules, as its PGN replays.
+  const played_game game = play("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -", 300,
+                                {.draw_from_ply = 20, .max_plies = 60});
+  assert(game.result != game_result::unknown && game.moves.size() <= 60);
+  std::string text;
+  append_pgn(text, {}, {configuration(), true}, game.moves, game.result);
+  struct counter final : pgn_visitor {
+    int plies = 0;
+    game_result result = game_result::unknown;
+    bool valid = false;
+    bool position(const configuration &, bool, const int ply) override {
+      plies = ply;
+      return true;
+    }
+    void end_game(const game_result r, const bool v) override {
+      result = r;
+      valid = v;
+    }
+  } read;
+  const std::u8string bytes(text.begin(), text.end());
+  pgn_reader(bytes, &read).read();
+  assert(read.valid && read.result == game.result && read.plies == std::ssize(game.moves));
+}
@@ -0,0 +1,56 @@
+#include "transposition.hpp"
+#include <random>
+#include <thread>
+#include <vector>
+
+int main() {
+  transposition_table table(1);
+  assert(table.size() == (1 << 20) / 16);
+  assert(!table.probe(configuration().get_key()));
+
+  const move e2e4 = *parse_move("e2e4"), e7e8q = *parse_move("e7e8q");
+  const uint64_t key = configuration().get_key();
+  table.store(key, {e2e4, 35, 12, bound::exact});
+  const auto found = table.probe(key);
+  assert(found && found->best == e2e4 && found->score == 35 && found->depth == 12 &&
+         found->kind == bound::exact);
+  table.store(key, {e7e8q, -32'000, 3, bound::upper}); // Replaces, being of the same key.
+  assert(table.probe(key)->best == e7e8q && table.probe(key)->score == -32'000);
+  table.store(key, {std::nullopt, 0, 0, bound::lower});
+  assert(table.probe(key) && !table.probe(key)->best);
+  assert(!table.probe(key ^ 1));
+
+  // Keys landing in one bucket: the 5th evicts the shallowest, then older searches give way.
+  constexpr uint64_t same_bucket = 1 << 20; // Far below the bits that pick the bucket.
+  table.clear();
+  for (int i = 0; i < 4; ++i) {
+    table.store(i * same_bucket, {std::nullopt, 0, 10 + i, bound::exact});
+  }
+  table.store(4 * same_bucket, {std::nullopt, 0, 1, bound::exact});
+  assert(!table.probe(0) && table.probe(same_bucket) && table.probe(4 * same_bucket));
+  table.new_search();
+  table.new_search();
+  table.store(5 * same_bucket, {std::nullopt, 0, 1, bound::exact});
+  assert(!table.probe(4 * same_bucket) && table.probe(5 * same_bucket));
+  table.prefetch(key);
+
+  // Threads racing on a small table: whatever a probe finds MUST be what was stored for its key.
+  transposition_table shared(1);
+  std::vector<std::jthread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&shared, t] {
+      std::mt19937_64 rng(t);
+      for (int i = 0; i < 200'000; ++i) {
+        const uint64_t key = rng() % 100'000 * 0x9E37'79B9'7F4A'7C15;
+        const int score = static_cast<int16_t>(key >> 20), depth = key >> 40 & 0xFF;
+        if (const auto d = shared.probe(key)) {
+          assert(d->score == score && d->depth == depth);
+        } else {
+          shared.store(key, {std::nullopt, score, depth, bound::exact});
+        }
+      }
+    });
+  }
+  threads.clear();
+  assert(shared.hashfull() > 0);
+}
@@ -0,0 +1,125 @@
+#include "uci.hpp"
+#include <cstdlib>
+
+/** What an engine writes, line by line, for this thread to wait on. */
+struct transcript {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<std::string> lines;
+
+  void add(const std::string_view line) {
+    {
+      const std::lock_guard lock(mutex);
+      lines.emplace_back(line);
+    }
+    changed.notify_all();
+  }
+
+  /** The first line written since `from` that starts with `prefix`, once there is one. */
+  std::string wait(const std::string_view prefix, size_t &from) {
+    std::unique_lock lock(mutex);
+    for (;; changed.wait(lock)) {
+      for (; from < lines.size(); ++from) {
+        if (lines[from].starts_with(prefix)) {
+          return lines[from++];
+        }
+      }
+    }
+  }
+
+  /** How many lines have been written so far. */
+  size_t size() {
+    const std::lock_guard lock(mutex);
+    return lines.size();
+  }
+
+  /** Whether a line written since `from` starts with `prefix`. */
+  bool has(const std::string_view prefix, const size_t from) {
+    const std::lock_guard lock(mutex);
+    return std::ranges::any_of(lines | std::views::drop(from),
+                               [&](const std::string &line) { return line.starts_with(prefix); });
+  }
+};
+
+int main() {
+  assert(uci_score(25) == "cp 25" && uci_score(-300) == "cp -300");
+  assert(uci_score(mate_score - 1) == "mate 1" && uci_score(mate_score - 3) == "mate 2");
+  assert(uci_score(-mate_score) == "mate 0" && uci_score(2 - mate_score) == "mate -1");
+
+  transcript out;
+  uci_engine engine([&out](const std::string_view line) { out.add(line); });
+  size_t at = 0;
+  engine.command("uci");
+  assert(out.wait("option name Hash", at) ==
+         "option name Hash type spin default 16 min 1 max 65536");
+  out.wait("uciok", at);
+  engine.command("setoption name Hash value 4");
+  engine.command("setoption name Threads value 2");
+  engine.command("isready");
+  out.wait("readyok", at);
+
+  // Moves played from the initial position, then a search to a depth, reporting as it goes.
+  engine.command("position startpos moves e2e4 e7e5 g1f3");
+  engine.command("go depth 3");
+  const std::string info = out.wait("info depth 3", at);
+  assert(info.contains(" nodes ") && info.contains(" nps ") && info.contains(" hashfull "));
+  const std::string best = out.wait("bestmove", at);
+  assert(best.starts_with("bestmove ") && best.contains(" ponder "));
+
+  // Mates are counted in moves; with no legal move, the best is the null move.
+  engine.command("position fen 6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+  engine.command("go depth 2");
+  assert(out.wait("info", at).contains(" score mate 1 "));
+  assert(out.wait("bestmove", at) == "bestmove a1a8");
+  engine.command("position fen k7/8/1Q6/8/8/8/8/7K b - - 0 1");
+  engine.command("go depth 1");
+  assert(out.wait("bestmove", at) == "bestmove 0000");
+
+  // Infinite searches and pondering say their move only when told: at `stop`, or after the time
+  // left at `ponderhit`, even having stopped on their own before. Whatever the timing, the first
+  // `bestmove` since `go` must then come after every line written before the engine was told.
+  engine.command("position startpos");
+  engine.command("go infinite");
+  out.wait("info", at);
+  size_t told = out.size();
+  engine.command("stop");
+  out.wait("bestmove", at);
+  assert(at > told);
+
+  engine.command("position startpos moves d2d4");
+  engine.command("go ponder depth 2 wtime 1000 btime 1000");
+  out.wait("info depth 2", at);
+  told = out.size();
+  engine.command("ponderhit");
+  out.wait("bestmove", at);
+  assert(at > told);
+
+  // With 100 ms left, the move comes a few milliseconds after `ponderhit`; the bound only has to
+  // tell that from searching on, so it leaves ample room for the scheduler.
+  engine.command("go ponder wtime 100 btime 100");
+  out.wait("info", at);
+  told = out.size();
+  const auto hit = std::chrono::steady_clock::now();
+  engine.command("ponderhit");
+  out.wait("bestmove", at);
+  assert(at > told);
+  assert(std::chrono::steady_clock::now() - hit < std::chrono::seconds(5));
+
+  // An opening book answers at once; illegal moves end the list of those played.
+  char path[] = "/tmp/test_uci.XXXXXX";
+  const int fd = mkstemp(path);
+  const configuration after_e4 = configuration().make_move(*parse_move("e2e4"));
+  assert(fd >= 0 && save_book(fd, {{polyglot_key(after_e4, false),
+                                    book_move(after_e4, *parse_move("c7c5")), 1, 0}}));
+  close(fd);
+  engine.command("setoption name BookFile value " + std::string(path));
+  engine.command("position startpos moves e2e4 e2e4");
+  engine.command("go wtime 1000 btime 1000");
+  assert(out.wait("bestmove", at) == "bestmove c7c5" && !out.has("info", at));
+  engine.command("setoption name BookFile value <empty>");
+  unlink(path);
+  engine.command("go depth 1");
+  out.wait("info", at);
+  out.wait("bestmove", at);
+  assert(!engine.command("quit"));
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include "chess.hpp"
+#include <atomic>
+#include <climits>
+#include <memory>
+
+/** How a stored score relates to the true one: the search may have cut off above or below. */
+enum class bound : uint8_t { none, upper, lower, exact };
+
+/** What a search learned about a position. */
+struct tt_data {
+  std::optional<move> best;
+  int score;
+  int depth; // In plies, 0 to 255.
+  bound kind;
+};
+
+/**
+ * A fixed-size table of what searches learned about positions, by Zobrist key, that any number of
+ * threads share without locks. Entries come in buckets of 4 filling a cache line, so a probe costs
+ * at most one miss, and `prefetch` lets it start while the caller does something else.
+ *
+ * Each entry holds its data and the key XORed with it, both stored relaxed: should the stores of
+ * 2 threads interleave, the pair no longer decodes to the key and a probe misses rather than lies.
+ */
+class transposition_table {
+  struct entry {
+    std::atomic<uint64_t> check, data;
+  };
+  struct alignas(64) bucket {
+    std::array<entry, 4> entries;
+  };
+  size_t count;
+  std::unique_ptr<bucket[]> buckets;
+  uint8_t generation = 0; // Of the current search; older entries are replaced first.
+
+  /** Any number of buckets, not just powers of 2: the high bits of the key times `count`. */
+  [[nodiscard]] bucket &bucket_of(const uint64_t key) const noexcept {
+    return buckets[static_cast<unsigned __int128>(key) * count >> 64];
+  }
+
+  // From the low bits: source and destination squares, promotion, bound, a bit set in every
+  // entry stored, depth, generation and the score, 16 bits and signed, on top.
+  [[nodiscard]] uint64_t pack(const tt_data &d) const noexcept {
+    uint64_t data = uint64_t{std::to_underlying(d.kind)} << 16 | uint64_t{1} << 18 |
+                    static_cast<uint64_t>(d.depth) << 24 | uint64_t{generation} << 32 |
+                    uint64_t{static_cast<uint16_t>(d.score)} << 48;
+    if (d.best) {
+      data |= uint64_t{d.best->from()} | uint64_t{d.best->to()} << 6 |
+              uint64_t{std::to_underlying(d.best->get_promotion())} << 12;
+    }
+    return data;
+  }
+  [[nodiscard]] static tt_data unpack(const uint64_t data) noexcept {
+    std::optional<move> best;
+    if (data & 0xFFF) {
+      best = move(data & 63, data >> 6 & 63, static_cast<piece>(data >> 12 & 7));
+    }
+    return {best, static_cast<int16_t>(data >> 48), static_cast<int>(data >> 24 & 0xFF),
+            static_cast<bound>(data >> 16 & 3)};
+  }
+
+public:
+  /** As many buckets as fit in `megabytes`, which MUST be nonzero. */
+  explicit transposition_table(const size_t megabytes)
+      : count((megabytes << 20) / sizeof(bucket)), buckets(std::make_unique<bucket[]>(count)) {}
+
+  [[nodiscard]] size_t size() const noexcept { return count * 4; }
+
+  /** Starts loading the bucket of `key` into the cache, for a `probe` or `store` soon after. */
+  void prefetch(const uint64_t key) const noexcept { __builtin_prefetch(&bucket_of(key)); }
+
+  [[nodiscard]] std::optional<tt_data> probe(const uint64_t key) const noexcept {
+    for (const entry &e : bucket_of(key).entries) {
+      const uint64_t data = e.data.load(std::memory_order_relaxed);
+      if ((e.check.load(std::memory_order_relaxed) ^ data) == key && data != 0) {
+        return unpack(data);
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Replaces the entry of the same key if any, else the least valuable of the bucket: the one
+   * searched least deep, each search since it was stored counting as 8 plies less.
+   */
+  void store(const uint64_t key, const tt_data &d) noexcept {
+    auto &entries = bucket_of(key).entries;
+    entry *victim = &entries[0];
+    int lowest = INT_MAX;
+    for (entry &e : entries) {
+      const uint64_t data = e.data.load(std::memory_order_relaxed);
+      if ((e.check.load(std::memory_order_relaxed) ^ data) == key) {
+        victim = &e;
+        break;
+      }
+      const int age = static_cast<uint8_t>(generation - (data >> 32 & 0xFF));
+      if (const int value = static_cast<int>(data >> 24 & 0xFF) - 8 * age; value < lowest) {
+        victim = &e;
+        lowest = value;
+      }
+    }
+    const uint64_t data = pack(d);
+    victim->check.store(key ^ data, std::memory_order_relaxed);
+    victim->data.store(data, std::memory_order_relaxed);
+  }
+
+  /** To call before each search, not during one, so entries of earlier ones give way. */
+  void new_search() noexcept { ++generation; }
+
+  void clear() noexcept {
+    for (size_t i = 0; i < count; ++i) {
+      for (entry &e : buckets[i].entries) {
+        e.check.store(0, std::memory_order_relaxed);
+        e.data.store(0, std::memory_order_relaxed);
+      }
+    }
+    generation = 0;
+  }
+
+  /** Entries per thousand stored by the current search, sampled from the first buckets, as UCI. */
+  [[nodiscard]] int hashfull() const noexcept {
+    const size_t sampled = std::min<size_t>(count, 250);
+    int used = 0;
+    for (size_t i = 0; i < sampled; ++i) {
+      for (const entry &e : buckets[i].entries) {
+        const uint64_t data = e.data.load(std::memory_order_relaxed);
+        used += data != 0 && (data >> 32 & 0xFF) == generation;
+      }
+    }
+    return sampled ? used * 1000 / static_cast<int>(sampled * 4) : 0;
+  }
+};
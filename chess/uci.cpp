@@ -0,0 +1,19 @@
+#include "uci.hpp"
+#include <cstdio>
+#include <iostream>
+
+/**
+ * Usage: uci
+ *
+ * Speaks the Universal Chess Interface on standard input and output, for GUIs and match
+ * runners. Each line written is flushed at once.
+ */
+int main() {
+  uci_engine engine([](const std::string_view line) {
+    std::fwrite(line.data(), 1, line.size(), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+  });
+  for (std::string line; std::getline(std::cin, line) && engine.command(line);) {
+  }
+}
@@ -0,0 +1,279 @@
+#pragma once
+#include "book.hpp"
+#include "search.hpp"
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+
+/** A score as UCI has it: "cp 25", or "mate 3" when mating in 3 moves, "mate -3" when mated. */
+inline std::string uci_score(const int score) {
+  if (std::abs(score) < mate_score - max_ply) {
+    return "cp " + std::to_string(score);
+  }
+  const int plies = mate_score - std::abs(score);
+  return "mate " + std::to_string(score > 0 ? (plies + 1) / 2 : -plies / 2);
+}
+
+/** The `info` line of a report. */
+inline std::string uci_info(const search_report &report) {
+  std::string line = "info depth " + std::to_string(report.depth) + " score " +
+                     uci_score(report.score) + " nodes " + std::to_string(report.nodes) + " nps " +
+                     std::to_string(static_cast<uint64_t>(report.nps())) + " hashfull " +
+                     std::to_string(report.hashfull) + " time " +
+                     std::to_string(report.elapsed / std::chrono::milliseconds(1)) + " pv";
+  for (const move m : report.pv) {
+    line += ' ';
+    line += to_string(m);
+  }
+  return line;
+}
+
+/**
+ * The engine side of the Universal Chess Interface, a line of input at a time. Searches run on a
+ * thread of their own, so that `isready`, `stop` and `ponderhit` are answered while searching.
+ * Options beyond `Hash` and `Threads` load an opening book, endgame tables and a network.
+ */
+class uci_engine {
+  std::function<void(std::string_view)> write;
+  std::mutex output; // Lines are written whole, from this thread and the search's.
+
+  size_t megabytes = 16;
+  unsigned threads = 1;
+  std::unique_ptr<transposition_table> table = std::make_unique<transposition_table>(megabytes);
+  std::optional<opening_book> book;
+  endgame_tables endgames;
+  size_t endgames_loaded = 0;
+  mapped_file net_file{""};
+  const network *net = nullptr;
+  uint64_t random = std::chrono::steady_clock::now().time_since_epoch().count(); // For the book.
+
+  ply position{configuration(), true};
+  std::vector<uint64_t> history; // The keys of the positions of the game before `position`.
+  search_limits limits;
+
+  std::mutex mutex;
+  std::condition_variable_any condition;
+  bool waiting = false; // To ponder or search on until told to stop, with the result kept.
+  std::optional<std::chrono::nanoseconds> ponder_time;
+  std::jthread searching, timer; // Last, so that they stop first.
+
+  static std::string join(const std::span<const std::string_view> words) {
+    std::string text;
+    for (const std::string_view word : words) {
+      text += text.empty() ? "" : " ";
+      text += word;
+    }
+    return text;
+  }
+
+  void say(const std::string_view line) {
+    const std::lock_guard lock(output);
+    write(line);
+  }
+
+  /** Ends the search under way, if any, which says its best move. */
+  void finish() {
+    timer = {};
+    {
+      const std::lock_guard lock(mutex);
+      waiting = false;
+    }
+    condition.notify_all();
+    searching = {};
+  }
+
+  void set_position(const std::span<const std::string_view> words) {
+    const auto moves = std::ranges::find(words, "moves");
+    std::optional<ply> start;
+    if (!words.empty() && words[0] == "startpos") {
+      start = ply{configuration(), true};
+    } else if (!words.empty() && words[0] == "fen") {
+      start = parse_fen(join({words.begin() + 1, moves}));
+    }
+    if (!start) {
+      return;
+    }
+    position = *start;
+    history.clear();
+    for (const std::string_view word :
+         std::span(moves, words.end()).subspan(moves != words.end())) {
+      move_list legal;
+      generate_moves(position.config, position.white_turn, legal);
+      const auto m = parse_move(word);
+      if (!m || std::ranges::find(legal, *m) == legal.end()) {
+        break;
+      }
+      history.push_back(position.config.get_key());
+      position = {position.config.make_move(*m), !position.white_turn};
+    }
+  }
+
+  void go(const std::span<const std::string_view> words) {
+    limits = {.threads = threads,
+              .net = net,
+              .endgames = endgames_loaded ? &endgames : nullptr};
+    bool infinite = false, ponder = false;
+    for (size_t i = 0; i < words.size(); ++i) {
+      const std::string_view word = words[i];
+      int64_t value = 0;
+      if (i + 1 < words.size()) {
+        const std::string_view next = words[i + 1];
+        std::from_chars(next.data(), next.data() + next.size(), value);
+      }
+      const auto ms = std::chrono::milliseconds(std::max<int64_t>(value, 0));
+      if (word == "infinite") {
+        infinite = true;
+      } else if (word == "ponder") {
+        ponder = true;
+      } else if (word == (position.white_turn ? "wtime" : "btime")) {
+        limits.time_left = ms;
+      } else if (word == (position.white_turn ? "winc" : "binc")) {
+        limits.increment = ms;
+      } else if (word == "movestogo") {
+        limits.moves_to_go = static_cast<int>(value);
+      } else if (word == "depth") {
+        limits.depth = std::clamp(static_cast<int>(value), 1, max_ply - 1);
+      } else if (word == "nodes") {
+        limits.nodes = static_cast<uint64_t>(std::max<int64_t>(value, 1));
+      } else if (word == "movetime") {
+        limits.movetime = ms;
+      }
+    }
+    if (!infinite && !ponder && book) {
+      random = chess_impl::mix(random + 0x9E37'79B9'7F4A'7C15);
+      if (const auto m = book->pick(position, random)) {
+        say("bestmove " + to_string(*m));
+        return;
+      }
+    }
+    // Pondering, the clock is not running yet: it starts at `ponderhit`, for as long as searching
+    // would have taken to start an iteration.
+    ponder_time.reset();
+    if (ponder && (limits.movetime || limits.time_left)) {
+      ponder_time = chess_impl::make_budget(limits).soft;
+      limits.movetime.reset();
+      limits.time_left.reset();
+    }
+    waiting = infinite || ponder;
+    searching = std::jthread([this](const std::stop_token stop) {
+      const search_report report = search(
+          position, limits, *table, history, [this](const search_report &r) { say(uci_info(r)); },
+          stop);
+      {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, stop, [this] { return !waiting; });
+      }
+      std::string line = "bestmove " + (report.best() ? to_string(*report.best()) : "0000");
+      if (report.pv.size() > 1) {
+        line += " ponder " + to_string(report.pv[1]);
+      }
+      say(line);
+    });
+  }
+
+  void ponderhit() {
+    {
+      const std::lock_guard lock(mutex);
+      waiting = false;
+    }
+    condition.notify_all();
+    if (ponder_time) {
+      timer = std::jthread([this, time = *ponder_time](const std::stop_token stop) {
+        std::unique_lock lock(mutex);
+        condition.wait_for(lock, stop, time, [] { return false; });
+        lock.unlock();
+        if (!stop.stop_requested()) {
+          searching.request_stop();
+        }
+      });
+    }
+  }
+
+  void set_option(const std::span<const std::string_view> words) {
+    const auto name_at = std::ranges::find(words, "name");
+    const auto value_at = std::ranges::find(words, "value");
+    if (name_at == words.end() || value_at < name_at) {
+      return;
+    }
+    const std::string name = join({name_at + 1, value_at});
+    std::string value = value_at == words.end() ? "" : join({value_at + 1, words.end()});
+    if (value == "<empty>") {
+      value.clear();
+    }
+    const auto number = [&value](const size_t low, const size_t high) {
+      size_t n = 0;
+      std::from_chars(value.data(), value.data() + value.size(), n);
+      return std::clamp(n, low, high);
+    };
+    if (name == "Hash") {
+      megabytes = number(1, 1 << 16);
+      table = std::make_unique<transposition_table>(megabytes);
+    } else if (name == "Threads") {
+      threads = static_cast<unsigned>(number(1, 1024));
+    } else if (name == "BookFile") {
+      book.reset();
+      if (!value.empty()) {
+        book.emplace(value.c_str());
+      }
+    } else if (name == "EndgamePath") {
+      endgames = {};
+      endgames_loaded = value.empty() ? 0 : endgames.load(value.c_str());
+    } else if (name == "EvalFile") {
+      net_file = mapped_file(value.c_str());
+      net = network::load(net_file.view());
+    }
+  }
+
+public:
+  /** Writes the lines of output, without their line feeds, to `write`. */
+  explicit uci_engine(std::function<void(std::string_view)> write) : write(std::move(write)) {}
+  ~uci_engine() { finish(); }
+
+  /** Acts on a line of input; false once told to quit. */
+  bool command(const std::string_view line) {
+    std::vector<std::string_view> words;
+    for (const auto word : std::views::split(line, ' ')) {
+      if (!word.empty()) {
+        words.emplace_back(word);
+      }
+    }
+    if (words.empty()) {
+      return true;
+    }
+    const std::string_view name = words[0];
+    const std::span<const std::string_view> arguments = std::span(words).subspan(1);
+    if (name == "uci") {
+      say("id name ccc chess");
+      say("id author kuotsanhsu");
+      say("option name Hash type spin default 16 min 1 max 65536");
+      say("option name Threads type spin default 1 min 1 max 1024");
+      say("option name Ponder type check default false");
+      say("option name BookFile type string default <empty>");
+      say("option name EndgamePath type string default <empty>");
+      say("option name EvalFile type string default <empty>");
+      say("uciok");
+    } else if (name == "isready") {
+      say("readyok");
+    } else if (name == "ucinewgame") {
+      finish();
+      table->clear();
+    } else if (name == "position") {
+      finish();
+      set_position(arguments);
+    } else if (name == "go") {
+      finish();
+      go(arguments);
+    } else if (name == "stop") {
+      finish();
+    } else if (name == "ponderhit") {
+      ponderhit();
+    } else if (name == "setoption") {
+      finish();
+      set_option(arguments);
+    } else if (name == "quit") {
+      finish();
+      return false;
+    }
+    return true;
+  }
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace chess_impl {
+
+/** The finalizer of SplitMix64: every bit of `x` flips each bit of the result half the time. */
+constexpr uint64_t mix(uint64_t x) noexcept {
+  x = (x ^ x >> 30) * 0xBF58'476D'1CE4'E5B9;
+  x = (x ^ x >> 27) * 0x94D0'49BB'1331'11EB;
+  return x ^ x >> 31;
+}
+
+/**
+ * A random number for each feature of a position; the key of a position is the XOR of those of
+ * its features, so a move updates it with a few XORs. Drawn from a fixed seed, keys are the same
+ * on every run, which keeps tables and logs comparable.
+ */
+struct zobrist_keys {
+  std::array<std::array<std::array<uint64_t, 64>, 7>, 2> pieces; // By color, type and square.
+  std::array<uint64_t, 16> castling;                             // By the set of rights.
+  std::array<uint64_t, 8> en_passant;                            // By file.
+  uint64_t black_to_move;
+};
+
+constexpr zobrist_keys make_zobrist_keys() noexcept {
+  uint64_t state = 0;
+  const auto next = [&state] { return mix(state += 0x9E37'79B9'7F4A'7C15); };
+  zobrist_keys keys{};
+  for (auto &color : keys.pieces) {
+    for (auto &type : color) {
+      for (uint64_t &key : type) {
+        key = next();
+      }
+    }
+  }
+  for (uint64_t &key : keys.castling) {
+    key = next();
+  }
+  for (uint64_t &key : keys.en_passant) {
+    key = next();
+  }
+  keys.black_to_move = next();
+  return keys;
+}
+
+inline constexpr zobrist_keys zobrist = make_zobrist_keys();
+
+} // namespace chess_impl
@@ -33,16 +33,21 @@ struct json_visitor {
 };
 
 /**
+ * `V` is the static type of the visitor; when it is a `final` class every event is a direct call
+ * that can be inlined, otherwise a virtual one.
+ *
  * Guiding principles:
  * 1. A negative codepoint SHOULD NOT end any lexeme/token/subtree OTHER THAN numbers, whitespaces
  * or json-text.
  * 2. Numbers are ended by the first non-numeric codepoint including a negative codepoint.
  * 3. TODO: disable recursion and use custom allocated stacks instead.
  */
-template <codepoint_sequence R> class json_parser {
+template <codepoint_sequence R, std::derived_from<json_visitor> V = json_visitor>
+class json_parser {
   std::ranges::iterator_t<R> source_iter;
-  json_visitor *visitor;
+  V *visitor;
 
+public:
   enum {
     err_lex_value = -10,
     err_lex_literal = -11,
@@ -56,6 +61,7 @@ template <codepoint_sequence R> class json_parser {
     err_lex_string = -21,
   };
 
+private:
   constexpr static bool isdigit(int c) noexcept { return '0' <= c && c <= '9'; }
 
   constexpr static bool isxdigit(int c) noexcept {
@@ -63,7 +69,7 @@ template <codepoint_sequence R> class json_parser {
   }
 
 public:
-  constexpr json_parser(R source, json_visitor *visitor)
+  constexpr json_parser(R source, V *visitor)
       : source_iter(std::ranges::begin(source)), visitor(visitor) {}
 
   /** Repeated calls to lex_json_text will always return -1. */
@@ -192,7 +198,8 @@ private:
     }
   }
 
-  template <void (json_visitor::*end_func)()> constexpr int lex_1_or_more_digits(char c) {
+  /** Ends with `end_exp` if `exp`, otherwise with `end_frac`. */
+  template <bool exp> constexpr int lex_1_or_more_digits(char c) {
     if (c < 0) {
       return c;
     }
@@ -203,7 +210,11 @@ private:
       visitor->digit(c);
       c = *source_iter++;
     } while (isdigit(c));
-    (visitor->*end_func)();
+    if constexpr (exp) {
+      visitor->end_exp();
+    } else {
+      visitor->end_frac();
+    }
     return c;
   }
 
@@ -217,14 +228,14 @@ private:
         visitor->digit(c);
       }
     }
+    visitor->end_int(); // Numbers are ended by any non-digit, including a negative codepoint.
     if (c < 0) {
       return c;
     }
-    visitor->end_int();
 
     if (c == '.') {
       visitor->begin_frac();
-      c = lex_1_or_more_digits<&json_visitor::end_frac>(*source_iter++);
+      c = lex_1_or_more_digits<false>(*source_iter++);
     }
     switch (c) {
     case 'E':
@@ -238,7 +249,7 @@ private:
         c = *source_iter++;
       }
       visitor->begin_exp(minus);
-      c = lex_1_or_more_digits<&json_visitor::end_exp>(c);
+      c = lex_1_or_more_digits<true>(c);
     }
     }
     return c;
@@ -255,7 +266,12 @@ private:
 
   constexpr int lex_array() {
     visitor->begin_array();
-    for (int c = *source_iter++;;) {
+    int c = lex_whitespace(*source_iter++);
+    if (c == ']') { // Empty array.
+      visitor->end_array();
+      return *source_iter++;
+    }
+    while (true) {
       if (c = lex_value(c); c < 0) {
         return c;
       }
@@ -277,7 +293,12 @@ private:
 
   constexpr int lex_object() {
     visitor->begin_object();
-    for (int c = *source_iter++;;) {
+    int c = lex_whitespace(*source_iter++);
+    if (c == '}') { // Empty object.
+      visitor->end_object();
+      return *source_iter++;
+    }
+    while (true) {
       if (c = lex_whitespace(c); c < 0) {
         return c;
       }
@@ -0,0 +1,116 @@
+#pragma once
+#include "json.hpp"
+#include "json_index.hpp"
+#include <algorithm>
+#include <string>
+
+/**
+ * Keeps a json-text together with the spans of its containers so that an edit only re-lexes the
+ * smallest array or object strictly enclosing it. Splicing the index is a linear pass over the
+ * compact span array; the text outside the re-lexed container is never looked at again. Any edit
+ * that changes the bracket structure of that container, or touches no container at all, falls back
+ * to a full parse.
+ */
+class incremental_json_parser {
+  std::u8string text;
+  std::vector<json_span> spans;
+  /** Result of the last lex; when not -1, all errors lie within `invalid`. */
+  int status = -1;
+  json_span invalid{};
+  json_span relexed{};
+
+  constexpr int lex(const size_t begin, const size_t end, json_visitor *visitor) {
+    relexed = {begin, end, json_span::npos};
+    const auto source = std::u8string_view(text).substr(begin, end - begin);
+    status = json_parser(source | to_codepoint, visitor).lex_json_text();
+    invalid = status == -1 ? json_span{} : relexed;
+    return status;
+  }
+
+  /** Index of the smallest span strictly enclosing [first, last), or `npos`. */
+  [[nodiscard]] constexpr size_t enclosing(const size_t first, const size_t last) const {
+    // The enclosing span is the last span beginning before `first` or one of its ancestors.
+    const auto it = std::ranges::partition_point(
+        spans, [first](const json_span &span) { return span.begin < first; });
+    for (size_t k = it - spans.begin() - 1; k != json_span::npos; k = spans[k].parent) {
+      if (last < spans[k].end) {
+        return k;
+      }
+    }
+    return json_span::npos;
+  }
+
+  /** Replaces the descendants of span `k` with `fresh[1..]` and shifts everything after it. */
+  constexpr void splice(const size_t k, const std::vector<json_span> &fresh,
+                        const ptrdiff_t delta) {
+    const size_t old_end = spans[k].end;
+    const auto first = spans.begin() + k + 1;
+    const auto last = std::ranges::partition_point(
+        first, spans.end(), [old_end](const json_span &span) { return span.begin < old_end; });
+    const ptrdiff_t count_delta = std::ssize(fresh) - 1 - (last - first);
+    for (auto &span : std::ranges::subrange(last, spans.end())) {
+      span.begin += delta;
+      span.end += delta;
+      if (span.parent != json_span::npos && span.parent > k) { // Never an ancestor of `k`.
+        span.parent += count_delta;
+      }
+    }
+    for (size_t a = spans[k].parent; a != json_span::npos; a = spans[a].parent) {
+      spans[a].end += delta;
+    }
+    spans[k].end = fresh.front().end;
+    const auto at = spans.erase(first, last);
+    const auto inserted = spans.insert(at, fresh.begin() + 1, fresh.end());
+    for (auto &span : std::ranges::subrange(inserted, inserted + std::ssize(fresh) - 1)) {
+      span.parent += k; // Local to `fresh`, where `k` was index 0.
+    }
+  }
+
+public:
+  constexpr explicit incremental_json_parser(std::u8string text) : text(std::move(text)) {}
+
+  [[nodiscard]] constexpr std::u8string_view get_text() const noexcept { return text; }
+  [[nodiscard]] constexpr const auto &get_spans() const noexcept { return spans; }
+  /** The region handed to the visitor by the last `parse` or `edit`. */
+  [[nodiscard]] constexpr json_span get_relexed() const noexcept { return relexed; }
+
+  /** Lexes the whole text and rebuilds the index. Returns -1 iff the text is a valid json-text. */
+  constexpr int parse(json_visitor *visitor) {
+    spans.clear();
+    if (!index_json_containers(text, spans)) {
+      spans.clear();
+    }
+    return lex(0, text.size(), visitor);
+  }
+
+  /**
+   * Replaces `length` bytes at `offset` with `replacement` and re-lexes as little as possible; the
+   * visitor sees only the re-lexed value (see `get_relexed`). Returns -1 iff the whole text is
+   * a valid json-text afterwards.
+   */
+  constexpr int edit(const size_t offset, const size_t length,
+                     const std::u8string_view replacement, json_visitor *visitor) {
+    assert(offset + length <= text.size());
+    size_t first = offset;
+    size_t last = offset + length;
+    if (status != -1) { // Re-lex at least the region the errors were found in.
+      first = std::min(first, invalid.begin + 1);
+      last = std::max(last, invalid.end - 1);
+    }
+    text.replace(offset, length, replacement);
+    const size_t k = enclosing(first, last);
+    if (k == json_span::npos) {
+      return parse(visitor);
+    }
+    const ptrdiff_t delta = std::ssize(replacement) - static_cast<ptrdiff_t>(length);
+    const size_t begin = spans[k].begin;
+    const size_t end = spans[k].end + delta;
+    std::vector<json_span> fresh;
+    if (!index_json_containers(std::u8string_view(text).substr(begin, end - begin), fresh, begin) ||
+        fresh.front().end != end) {
+      return parse(visitor); // The bracket structure changed.
+    }
+    splice(k, fresh, delta);
+    return lex(begin, end, visitor);
+  }
+};
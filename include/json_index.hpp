@@ -0,0 +1,146 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** Where an array or object sits in the text. */
+struct json_span {
+  static constexpr size_t npos = -1;
+  size_t begin;  // The `[` or `{`.
+  size_t end;    // One past the matching `]` or `}`.
+  size_t parent; // Index of the enclosing span, or `npos`.
+
+  constexpr bool operator==(const json_span &) const = default;
+};
+
+/**
+ * Appends the spans of all arrays and objects in `text`, shifted by `base`, in document order, so
+ * a span's descendants directly follow it. Only brackets, quotes and escapes are understood; this
+ * is NOT validation. Returns false if the brackets do not balance or a string is left open.
+ */
+constexpr bool index_json_containers(const std::u8string_view text, std::vector<json_span> &spans,
+                                     const size_t base = 0) {
+  size_t open = json_span::npos; // The innermost open span.
+  bool in_string = false;
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char8_t c = text[i];
+    if (in_string) {
+      if (c == '\\') {
+        ++i;
+      } else if (c == '"') {
+        in_string = false;
+      }
+      continue;
+    }
+    switch (c) {
+    case '"':
+      in_string = true;
+      break;
+    case '[':
+    case '{':
+      spans.push_back({base + i, json_span::npos, open});
+      open = spans.size() - 1;
+      break;
+    case ']':
+    case '}':
+      if (open == json_span::npos || text[spans[open].begin - base] != (c == ']' ? '[' : '{')) {
+        return false;
+      }
+      spans[open].end = base + i + 1;
+      open = spans[open].parent;
+      break;
+    }
+  }
+  return open == json_span::npos && !in_string;
+}
+
+/** Bitmasks over a 64-byte block of text; bit i stands for byte i. */
+struct json_block {
+  uint64_t quote, backslash, open, close, comma;
+};
+
+/** Classifies 64 bytes at `p`: with SSE2 if available, else one byte at a time. */
+inline json_block classify_json_block(const char8_t *p) noexcept {
+  json_block block{};
+#if defined(__SSE2__)
+  std::array<__m128i, 4> chunks;
+  for (int i = 0; i < 4; ++i) {
+    chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * i));
+  }
+  const auto eq = [&chunks](const char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+      const auto bits = _mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle));
+      mask |= uint64_t{static_cast<uint16_t>(bits)} << 16 * i;
+    }
+    return mask;
+  };
+  block.quote = eq('"');
+  block.backslash = eq('\\');
+  block.comma = eq(',');
+  // `[` is 0x5B and `{` is 0x7B; `]` is 0x5D and `}` is 0x7D: fold them together with bit 0x20.
+  const __m128i fold = _mm_set1_epi8(0x20);
+  for (auto &chunk : chunks) {
+    chunk = _mm_or_si128(chunk, fold);
+  }
+  block.open = eq('{');
+  block.close = eq('}');
+#else
+  for (int i = 0; i < 64; ++i) {
+    const uint64_t bit = uint64_t{1} << i;
+    switch (p[i]) {
+    case '"':
+      block.quote |= bit;
+      break;
+    case '\\':
+      block.backslash |= bit;
+      break;
+    case ',':
+      block.comma |= bit;
+      break;
+    case '[':
+    case '{':
+      block.open |= bit;
+      break;
+    case ']':
+    case '}':
+      block.close |= bit;
+      break;
+    }
+  }
+#endif
+  return block;
+}
+
+/** Carries escapes and strings from one block to the next, 64 bytes at a time without branches. */
+struct json_string_state {
+  uint64_t escaped = 0;   // 1 if the first byte of the next block is escaped.
+  uint64_t in_string = 0; // All ones if the next block starts inside a string.
+
+  /** Returns the bytes of `block` inside strings, opening quotes included and closing excluded. */
+  constexpr uint64_t next(const json_block &block) noexcept {
+    constexpr uint64_t even_bits = 0x5555'5555'5555'5555;
+    // An escaped backslash escapes nothing. Within a run of backslashes every other byte, starting
+    // from the second, is escaped, as is the byte after an odd-length run. Adding the starts of
+    // the runs that begin at odd bits clears those runs, so the remaining runs begin at even bits.
+    const uint64_t backslash = block.backslash & ~escaped;
+    const uint64_t follows_backslash = backslash << 1 | escaped;
+    const uint64_t odd_starts = backslash & ~even_bits & ~follows_backslash;
+    const uint64_t even_runs = odd_starts + backslash;
+    escaped = even_runs < backslash; // Carry out of an odd-started run reaching bit 63.
+    const uint64_t escaped_bytes = (even_bits ^ even_runs << 1) & follows_backslash;
+
+    uint64_t quotes = block.quote & ~escaped_bytes;
+    for (int shift = 1; shift < 64; shift <<= 1) { // Prefix XOR.
+      quotes ^= quotes << shift;
+    }
+    const uint64_t inside = quotes ^ in_string;
+    in_string = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    return inside;
+  }
+};
@@ -0,0 +1,242 @@
+#pragma once
+#include "json.hpp"
+#include "json_index.hpp"
+#include "json_tape.hpp"
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <span>
+#include <thread>
+
+namespace json_impl {
+
+/** Calls `f(offset, block)` for each 64-byte block of text[first, last), padding the last one. */
+template <typename F>
+void for_each_json_block(const std::u8string_view text, const size_t first, const size_t last,
+                         F &&f) {
+  for (size_t offset = first; offset < last; offset += 64) {
+    if (last - offset >= 64) {
+      f(offset, classify_json_block(text.data() + offset));
+    } else {
+      std::array<char8_t, 64> tail;
+      tail.fill(' ');
+      std::ranges::copy(text.substr(offset, last - offset), tail.begin());
+      f(offset, classify_json_block(tail.data()));
+    }
+  }
+}
+
+/** 1 if the byte at `offset` is escaped, judging by the run of backslashes right before it. */
+constexpr uint64_t escaped_at(const std::u8string_view text, const size_t offset) noexcept {
+  size_t n = 0;
+  while (n < offset && text[offset - 1 - n] == '\\') {
+    ++n;
+  }
+  return n % 2;
+}
+
+/** Runs `f(i)` for each `i` in [0, n), each on its own thread. */
+template <typename F> void parallel_for(const unsigned n, F &&f) {
+  if (n == 1) {
+    f(0u);
+    return;
+  }
+  std::vector<std::jthread> workers;
+  workers.reserve(n);
+  for (unsigned i = 0; i < n; ++i) {
+    workers.emplace_back([&f, i] { f(i); });
+  }
+}
+
+constexpr bool is_whitespace(const std::u8string_view text) noexcept {
+  return text.find_first_not_of(u8" \t\n\r") == std::u8string_view::npos;
+}
+
+} // namespace json_impl
+
+/**
+ * Finds the `[` of a top-level array, the commas between its elements and its `]`, scanning
+ * `threads` slices of the text in parallel. Not knowing whether it starts inside a string, each
+ * slice is first summarised under both guesses; the guesses are resolved in document order, and
+ * then each slice is scanned again from its true string state and depth. Returns `std::nullopt`
+ * if the text is not a single array, as far as brackets, quotes and escapes can tell.
+ */
+inline std::optional<std::vector<size_t>> split_json_array(const std::u8string_view text,
+                                                           unsigned threads) {
+  threads = std::max(threads, 1u);
+  const size_t slice = (text.size() / threads + 63) & ~size_t{63}; // Whole blocks only.
+  const auto bounds = [&](const unsigned i) {
+    return std::pair(std::min(text.size(), i * slice),
+                     i + 1 == threads ? text.size() : std::min(text.size(), (i + 1) * slice));
+  };
+
+  struct summary {
+    bool odd_quotes = false;
+    bool balanced = true;
+    int64_t depth[2]{}; // Net depth change when starting outside and inside a string.
+    std::vector<size_t> separators;
+  };
+  std::vector<summary> summaries(threads);
+  json_impl::parallel_for(threads, [&](const unsigned i) {
+    const auto [first, last] = bounds(i);
+    auto &s = summaries[i];
+    json_string_state state{.escaped = json_impl::escaped_at(text, first)};
+    json_impl::for_each_json_block(text, first, last, [&](size_t, const json_block &block) {
+      const uint64_t inside = state.next(block);
+      s.depth[0] += std::popcount(block.open & ~inside) - std::popcount(block.close & ~inside);
+      s.depth[1] += std::popcount(block.open & inside) - std::popcount(block.close & inside);
+    });
+    s.odd_quotes = state.in_string != 0;
+  });
+
+  std::vector<std::pair<bool, int64_t>> starts(threads);
+  bool in_string = false;
+  int64_t depth = 0;
+  for (unsigned i = 0; i < threads; ++i) {
+    starts[i] = {in_string, depth};
+    depth += summaries[i].depth[in_string];
+    in_string ^= summaries[i].odd_quotes;
+  }
+  if (in_string || depth != 0) {
+    return std::nullopt;
+  }
+
+  json_impl::parallel_for(threads, [&](const unsigned i) {
+    const auto [first, last] = bounds(i);
+    auto &s = summaries[i];
+    int64_t level = starts[i].second;
+    json_string_state state{.escaped = json_impl::escaped_at(text, first),
+                            .in_string = starts[i].first ? ~uint64_t{0} : 0};
+    json_impl::for_each_json_block(text, first, last, [&](size_t offset, const json_block &block) {
+      const uint64_t inside = state.next(block);
+      for (uint64_t bits = (block.open | block.close | block.comma) & ~inside; bits != 0;
+           bits &= bits - 1) {
+        const uint64_t bit = bits & -bits;
+        const size_t at = offset + std::countr_zero(bits);
+        if (block.open & bit) {
+          if (level++ == 0) {
+            s.separators.push_back(at);
+          }
+        } else if (block.close & bit) {
+          if (--level == 0) {
+            s.separators.push_back(at);
+          }
+          s.balanced &= level >= 0;
+        } else if (level == 1) {
+          s.separators.push_back(at);
+        }
+      }
+    });
+  });
+
+  std::vector<size_t> separators;
+  for (const auto &s : summaries) {
+    if (!s.balanced) {
+      return std::nullopt;
+    }
+    separators.insert(separators.end(), s.separators.begin(), s.separators.end());
+  }
+  if (separators.size() < 2 || text[separators.front()] != '[' || text[separators.back()] != ']' ||
+      !json_impl::is_whitespace(text.substr(0, separators.front())) ||
+      !json_impl::is_whitespace(text.substr(separators.back() + 1))) {
+    return std::nullopt;
+  }
+  const auto commas = std::span(separators).subspan(1, separators.size() - 2);
+  if (!std::ranges::all_of(commas, [text](size_t at) { return text[at] == ','; })) {
+    return std::nullopt;
+  }
+  return separators;
+}
+
+namespace json_impl {
+
+/**
+ * Lexes the elements of the array `text` whose `[`, commas and `]` are at `separators`, in one
+ * contiguous run per visitor, as `lex_json_array_parallel` does.
+ */
+inline int lex_json_elements(const std::u8string_view text,
+                             const std::span<const size_t> separators,
+                             const std::span<json_visitor *const> visitors) {
+  using parser = json_parser<codepoint_view<std::u8string_view>>;
+  const auto element = [&](const size_t i) {
+    return text.substr(separators[i] + 1, separators[i + 1] - separators[i] - 1);
+  };
+  if (separators.size() == 2 && is_whitespace(element(0))) {
+    return -1; // Empty array.
+  }
+
+  const size_t runs = visitors.size();
+  std::vector<size_t> first_element(runs + 1, separators.size() - 1);
+  for (size_t r = 0; r < runs; ++r) {
+    const size_t target =
+        separators.front() + (separators.back() - separators.front()) * r / runs;
+    first_element[r] =
+        std::min<size_t>(std::ranges::lower_bound(separators, target) - separators.begin(),
+                         separators.size() - 1);
+  }
+  std::vector<int> results(runs, -1);
+  parallel_for(runs, [&](const unsigned r) {
+    for (size_t i = first_element[r]; i < first_element[r + 1]; ++i) {
+      if (is_whitespace(element(i))) {
+        results[r] = parser::err_lex_value;
+        return;
+      }
+      if (const int ret = parser(element(i) | to_codepoint, visitors[r]).lex_json_text();
+          ret != -1) {
+        results[r] = ret;
+        return;
+      }
+    }
+  });
+  const auto error = std::ranges::find_if(results, [](int ret) { return ret != -1; });
+  return error == results.end() ? -1 : *error;
+}
+
+} // namespace json_impl
+
+/**
+ * Lexes a top-level array in parallel. Its elements are split into one contiguous run per visitor,
+ * of roughly equal size in bytes, and each run is lexed on its own thread by its own visitor, one
+ * json-text per element. The visitors see neither the array's `[` and `]` nor each other's
+ * elements, so what each builds is relative to its own run; `parse_json_tape_parallel` shows how
+ * to stitch tapes back into the document. Any other text is lexed sequentially by the first
+ * visitor. Returns -1 iff the text is a valid json-text, otherwise the error of the first invalid
+ * element.
+ */
+inline int lex_json_array_parallel(const std::u8string_view text,
+                                   const std::span<json_visitor *const> visitors) {
+  assert(!visitors.empty());
+  if (const auto separators = split_json_array(text, visitors.size())) {
+    return json_impl::lex_json_elements(text, *separators, visitors);
+  }
+  return json_parser(text | to_codepoint, visitors.front()).lex_json_text();
+}
+
+/**
+ * Parses `text` onto `tape` with `threads` threads, as `lex_json_array_parallel` lexes it: each
+ * run of elements goes onto a tape of its own, and these are then appended to `tape` in document
+ * order between the array's `[` and `]`, rebased, so that `tape` ends up the same as if `text` had
+ * been parsed sequentially. Returns -1 iff the text is a valid json-text.
+ */
+inline int parse_json_tape_parallel(const std::u8string_view text, const unsigned threads,
+                                    json_tape_builder &tape) {
+  const auto separators = split_json_array(text, std::max(threads, 1u));
+  if (!separators) {
+    return json_parser(text | to_codepoint, &tape).lex_json_text();
+  }
+  std::vector<json_tape_builder> runs(std::max(threads, 1u));
+  std::vector<json_visitor *> visitors;
+  for (auto &run : runs) {
+    visitors.push_back(&run);
+  }
+  if (const int ret = json_impl::lex_json_elements(text, *separators, visitors); ret != -1) {
+    return ret;
+  }
+  tape.begin_array();
+  for (const auto &run : runs) {
+    tape.append(run.tape());
+  }
+  tape.end_array();
+  tape.end_json_text();
+  return -1;
+}
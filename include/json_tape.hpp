@@ -0,0 +1,516 @@
+#pragma once
+#include "json.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * A parsed document flattened into one 64-bit word per value; the tag lives in the top byte and
+ * the payload in the low 56 bits.
+ * - `[` / `{`: bits 32..55 hold the number of elements or members (saturating at 2^24-1) and
+ *   bits 0..31 the index of the word right after the matching `]` / `}`, so a subtree is skipped
+ *   in O(1). A tape is thus limited to 2^32-1 words.
+ * - `]` / `}`: the index of the matching `[` / `{`.
+ * - `"`: a byte offset into the string arena, where a 32-bit little-endian length precedes the
+ *   UTF-8.
+ * - `l` / `d`: the next word holds the pre-decoded `int64_t` / `double`.
+ * - `n`, `t`, `f`: no payload.
+ */
+enum class json_tape_tag : char {
+  null = 'n',
+  true_value = 't',
+  false_value = 'f',
+  string = '"',
+  int64 = 'l',
+  float64 = 'd',
+  array = '[',
+  end_array = ']',
+  object = '{',
+  end_object = '}',
+};
+
+struct json_member;
+
+class json_value {
+  const uint64_t *words;
+  const char8_t *strings;
+  size_t index;
+
+  static constexpr uint64_t payload_mask = (uint64_t{1} << 56) - 1;
+
+  [[nodiscard]] constexpr uint64_t payload() const noexcept { return words[index] & payload_mask; }
+
+  [[nodiscard]] constexpr bool is_container() const noexcept {
+    return tag() == json_tape_tag::array || tag() == json_tape_tag::object;
+  }
+
+public:
+  template <typename T> class iterator;
+
+  constexpr json_value(const uint64_t *words, const char8_t *strings, const size_t index) noexcept
+      : words(words), strings(strings), index(index) {}
+
+  [[nodiscard]] constexpr json_tape_tag tag() const noexcept {
+    return static_cast<json_tape_tag>(words[index] >> 56);
+  }
+  [[nodiscard]] constexpr size_t get_index() const noexcept { return index; }
+
+  /** The value right after this one (and its subtree) on the tape. */
+  [[nodiscard]] constexpr json_value next() const noexcept {
+    switch (tag()) {
+    case json_tape_tag::array:
+    case json_tape_tag::object:
+      return {words, strings, static_cast<uint32_t>(payload())};
+    case json_tape_tag::int64:
+    case json_tape_tag::float64:
+      return {words, strings, index + 2};
+    default:
+      return {words, strings, index + 1};
+    }
+  }
+
+  [[nodiscard]] constexpr bool is_null() const noexcept { return tag() == json_tape_tag::null; }
+
+  [[nodiscard]] constexpr std::optional<bool> get_bool() const noexcept {
+    switch (tag()) {
+    case json_tape_tag::true_value:
+      return true;
+    case json_tape_tag::false_value:
+      return false;
+    default:
+      return std::nullopt;
+    }
+  }
+
+  [[nodiscard]] constexpr std::optional<int64_t> get_int64() const noexcept {
+    if (tag() != json_tape_tag::int64) {
+      return std::nullopt;
+    }
+    return std::bit_cast<int64_t>(words[index + 1]);
+  }
+
+  /** Integers are widened to `double`. */
+  [[nodiscard]] constexpr std::optional<double> get_double() const noexcept {
+    switch (tag()) {
+    case json_tape_tag::float64:
+      return std::bit_cast<double>(words[index + 1]);
+    case json_tape_tag::int64:
+      return static_cast<double>(std::bit_cast<int64_t>(words[index + 1]));
+    default:
+      return std::nullopt;
+    }
+  }
+
+  [[nodiscard]] constexpr std::optional<std::u8string_view> get_string() const noexcept {
+    if (tag() != json_tape_tag::string) {
+      return std::nullopt;
+    }
+    const auto *const s = strings + payload();
+    const uint32_t length = s[0] | s[1] << 8 | s[2] << 16 | uint32_t{s[3]} << 24;
+    return std::u8string_view(s + 4, length);
+  }
+
+  /** Number of elements or members; 0 for scalars. */
+  [[nodiscard]] constexpr size_t size() const noexcept;
+
+  [[nodiscard]] constexpr auto elements() const noexcept;
+  [[nodiscard]] constexpr auto members() const noexcept;
+
+  /** The element at position `i` of an array. */
+  [[nodiscard]] constexpr std::optional<json_value> at(size_t i) const noexcept;
+
+  /** The value of the first member named `name` of an object. */
+  [[nodiscard]] constexpr std::optional<json_value>
+  operator[](std::u8string_view name) const noexcept;
+};
+
+struct json_member {
+  std::u8string_view name;
+  json_value value;
+};
+
+template <typename T> class json_value::iterator {
+  json_value cursor;
+
+public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = T;
+
+  constexpr iterator(const json_value cursor) noexcept : cursor(cursor) {}
+
+  constexpr T operator*() const noexcept {
+    if constexpr (std::same_as<T, json_member>) {
+      return {*cursor.get_string(), cursor.next()};
+    } else {
+      return cursor;
+    }
+  }
+
+  constexpr iterator &operator++() noexcept {
+    cursor = cursor.next();
+    if constexpr (std::same_as<T, json_member>) {
+      cursor = cursor.next();
+    }
+    return *this;
+  }
+
+  constexpr iterator operator++(int) noexcept {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+
+  constexpr bool operator==(std::default_sentinel_t) const noexcept {
+    return cursor.tag() == json_tape_tag::end_array || cursor.tag() == json_tape_tag::end_object;
+  }
+};
+
+constexpr auto json_value::elements() const noexcept {
+  consteval_assert(tag() == json_tape_tag::array);
+  return std::ranges::subrange(iterator<json_value>({words, strings, index + 1}),
+                               std::default_sentinel);
+}
+
+constexpr auto json_value::members() const noexcept {
+  consteval_assert(tag() == json_tape_tag::object);
+  return std::ranges::subrange(iterator<json_member>({words, strings, index + 1}),
+                               std::default_sentinel);
+}
+
+constexpr size_t json_value::size() const noexcept {
+  if (!is_container()) {
+    return 0;
+  }
+  if (const size_t count = payload() >> 32; count != payload_mask >> 32) {
+    return count;
+  }
+  return tag() == json_tape_tag::array ? std::ranges::distance(elements())
+                                       : std::ranges::distance(members());
+}
+
+constexpr std::optional<json_value> json_value::at(size_t i) const noexcept {
+  if (tag() != json_tape_tag::array) {
+    return std::nullopt;
+  }
+  for (const json_value element : elements()) {
+    if (i-- == 0) {
+      return element;
+    }
+  }
+  return std::nullopt;
+}
+
+constexpr std::optional<json_value> json_value::operator[](std::u8string_view name) const noexcept {
+  if (tag() != json_tape_tag::object) {
+    return std::nullopt;
+  }
+  for (const auto [member_name, value] : members()) {
+    if (member_name == name) {
+      return value;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * A tape together with its string arena. Both spans are borrowed, either from a
+ * `json_tape_builder` or straight from the bytes of a saved tape, e.g. a `mapped_file`.
+ */
+class json_tape {
+  std::span<const uint64_t> words;
+  std::u8string_view strings;
+
+  /** Saved layout: header, then the words, then the string arena. */
+  struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t word_count;
+    uint64_t string_bytes;
+  };
+  static_assert(sizeof(header) == 32 && sizeof(header) % alignof(uint64_t) == 0);
+  static constexpr char magic[8]{'c', 'c', 'c', 't', 'a', 'p', 'e', '\n'};
+  static constexpr uint32_t version = 1;
+  static constexpr uint32_t byte_order = 0x0102'0304;
+
+  friend class json_tape_builder;
+
+public:
+  constexpr json_tape(std::span<const uint64_t> words, std::u8string_view strings) noexcept
+      : words(words), strings(strings) {}
+
+  [[nodiscard]] constexpr bool empty() const noexcept { return words.empty(); }
+
+  /** Whether both tapes hold the same words and strings, as tapes of the same json-texts do. */
+  constexpr bool operator==(const json_tape &other) const noexcept {
+    return std::ranges::equal(words, other.words) && strings == other.strings;
+  }
+
+  /** The first json-text on the tape. */
+  [[nodiscard]] constexpr json_value root() const noexcept {
+    consteval_assert(!words.empty());
+    return {words.data(), strings.data(), 0};
+  }
+
+  /**
+   * Reinterprets saved bytes in place; nothing is parsed or copied. `bytes` MUST stay alive and
+   * 8-byte aligned, which a `mapped_file` guarantees.
+   */
+  [[nodiscard]] static std::optional<json_tape> load(const std::u8string_view bytes) noexcept {
+    header h;
+    if (bytes.size() < sizeof(h)) {
+      return std::nullopt;
+    }
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if (!std::ranges::equal(h.magic, magic) || h.version != version ||
+        h.byte_order != byte_order) {
+      return std::nullopt;
+    }
+    const auto *const first = bytes.data() + sizeof(h);
+    if (reinterpret_cast<uintptr_t>(first) % alignof(uint64_t) != 0 ||
+        h.word_count > (bytes.size() - sizeof(h)) / sizeof(uint64_t) ||
+        h.string_bytes > bytes.size() - sizeof(h) - h.word_count * sizeof(uint64_t)) {
+      return std::nullopt;
+    }
+    return json_tape({reinterpret_cast<const uint64_t *>(first), h.word_count},
+                     {first + h.word_count * sizeof(uint64_t), h.string_bytes});
+  }
+
+  /** Writes the tape in the layout `load` expects; returns false on any I/O error. */
+  [[nodiscard]] bool save(const int fd) const noexcept {
+    header h{.version = version,
+             .byte_order = byte_order,
+             .word_count = words.size(),
+             .string_bytes = strings.size()};
+    std::ranges::copy(magic, h.magic);
+    const auto write_all = [fd](const void *data, size_t size) {
+      for (const auto *p = static_cast<const char *>(data); size != 0;) {
+        const ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+          return false;
+        }
+        p += n;
+        size -= n;
+      }
+      return true;
+    };
+    return write_all(&h, sizeof(h)) && write_all(words.data(), words.size_bytes()) &&
+           write_all(strings.data(), strings.size());
+  }
+};
+
+/**
+ * Records every json-text it visits onto a tape. Numbers are decoded once here: integers that fit
+ * become `int64_t`, everything else `double`. Only use the tape of a successfully lexed json-text;
+ * that of one too large for a tape is empty.
+ */
+class json_tape_builder final : public json_visitor {
+  std::vector<uint64_t> words;
+  std::u8string strings;
+  /** Open containers: the index of their `[` / `{` and the number of values seen so far. */
+  std::vector<std::pair<size_t, uint64_t>> open;
+  size_t string_start = 0;
+  std::string number;
+  bool pending_number = false;
+  bool integer = false;
+  bool too_large = false; // A skip index overflowed its 32 bits.
+
+  static constexpr uint64_t word(const json_tape_tag tag, const uint64_t payload = 0) noexcept {
+    return uint64_t{static_cast<uint8_t>(tag)} << 56 | payload;
+  }
+
+  constexpr void value() {
+    if (!open.empty()) {
+      ++open.back().second;
+    }
+  }
+
+  constexpr void close(const json_tape_tag begin, const json_tape_tag end, uint64_t count) {
+    const size_t i = open.back().first;
+    open.pop_back();
+    count = std::min<uint64_t>(count, (1 << 24) - 1);
+    too_large |= words.size() + 1 > UINT32_MAX;
+    words[i] = word(begin, count << 32 | ((words.size() + 1) & UINT32_MAX));
+    words.push_back(word(end, i));
+  }
+
+  [[nodiscard]] static constexpr std::optional<int64_t> parse_int64(std::string_view text) {
+    const bool minus = text.starts_with('-');
+    text.remove_prefix(minus);
+    const uint64_t limit = uint64_t{INT64_MAX} + minus;
+    uint64_t magnitude = 0;
+    for (const char c : text) {
+      const unsigned d = c - '0';
+      if (magnitude > (limit - d) / 10) {
+        return std::nullopt;
+      }
+      magnitude = magnitude * 10 + d;
+    }
+    return minus ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+  }
+
+  [[nodiscard]] static constexpr double parse_double(const std::string &text) {
+    if !consteval {
+      return std::strtod(text.c_str(), nullptr); // Correctly rounded, unlike the loop below.
+    }
+    double mantissa = 0;
+    int scale = 0;
+    bool frac = false;
+    auto c = text.begin() + text.starts_with('-');
+    for (; c != text.end() && *c != 'e'; ++c) {
+      if (*c == '.') {
+        frac = true;
+      } else {
+        mantissa = mantissa * 10 + (*c - '0');
+        scale -= frac;
+      }
+    }
+    if (c != text.end()) {
+      const bool minus = c[1] == '-';
+      int exp = 0;
+      for (c += 2; c != text.end(); ++c) {
+        exp = std::min(exp * 10 + (*c - '0'), 1 << 16);
+      }
+      scale += minus ? -exp : exp;
+    }
+    for (; scale > 0; --scale) {
+      mantissa *= 10;
+    }
+    for (; scale < 0; ++scale) {
+      mantissa /= 10;
+    }
+    return text.starts_with('-') ? -mantissa : mantissa;
+  }
+
+  constexpr void flush_number() {
+    if (!pending_number) {
+      return;
+    }
+    pending_number = false;
+    if (integer) {
+      if (const auto i = parse_int64(number)) {
+        words.push_back(word(json_tape_tag::int64));
+        words.push_back(std::bit_cast<uint64_t>(*i));
+        return;
+      }
+    }
+    words.push_back(word(json_tape_tag::float64));
+    words.push_back(std::bit_cast<uint64_t>(parse_double(number)));
+  }
+
+public:
+  [[nodiscard]] constexpr json_tape tape() const noexcept {
+    return too_large ? json_tape({}, {}) : json_tape(words, strings);
+  }
+
+  constexpr void clear() noexcept {
+    words.clear();
+    strings.clear();
+    open.clear();
+    pending_number = false;
+    too_large = false;
+  }
+
+  /**
+   * Appends the json-texts on `tape` as values of the open container, or as json-texts if none is
+   * open, as though they had been visited here: the indices of its containers are rebased and its
+   * strings copied over. This is how tapes built in parallel are stitched together.
+   */
+  constexpr void append(const json_tape &tape) {
+    flush_number();
+    const size_t base = words.size();
+    const size_t string_base = strings.size();
+    words.insert(words.end(), tape.words.begin(), tape.words.end());
+    strings.append(tape.strings);
+    too_large |= words.size() > UINT32_MAX;
+    size_t depth = 0; // Of the containers on `tape` open at word i.
+    for (size_t i = base; i < words.size(); ++i) {
+      const auto tag = static_cast<json_tape_tag>(words[i] >> 56);
+      if (tag == json_tape_tag::end_array || tag == json_tape_tag::end_object) {
+        --depth;
+        words[i] += base;
+        continue;
+      }
+      if (depth == 0) {
+        value();
+      }
+      if (tag == json_tape_tag::array || tag == json_tape_tag::object) {
+        ++depth;
+        words[i] += base; // The skip index, in the low 32 bits, unless the tape is too large.
+      } else if (tag == json_tape_tag::string) {
+        words[i] += string_base;
+      } else if (tag == json_tape_tag::int64 || tag == json_tape_tag::float64) {
+        ++i; // The number itself.
+      }
+    }
+  }
+
+  constexpr void end_json_text() final { flush_number(); }
+  constexpr void begin_whitespace() final { flush_number(); }
+  constexpr void end_false() final {
+    value();
+    words.push_back(word(json_tape_tag::false_value));
+  }
+  constexpr void end_null() final {
+    value();
+    words.push_back(word(json_tape_tag::null));
+  }
+  constexpr void end_true() final {
+    value();
+    words.push_back(word(json_tape_tag::true_value));
+  }
+  constexpr void begin_string() final {
+    value();
+    words.push_back(word(json_tape_tag::string, strings.size()));
+    string_start = strings.size();
+    strings.append(4, u8'\0');
+  }
+  constexpr void codepoint(const int c) final {
+    char8_t units[4];
+    strings.append(units, encode_utf8(c, units));
+  }
+  constexpr void end_string() final {
+    const auto length = strings.size() - string_start - 4;
+    for (int i = 0; i < 4; ++i) {
+      strings[string_start + i] = length >> 8 * i & 0xFF;
+    }
+  }
+  constexpr void begin_array() final {
+    value();
+    open.emplace_back(words.size(), 0);
+    words.push_back(0); // Patched by end_array.
+  }
+  constexpr void end_array() final {
+    close(json_tape_tag::array, json_tape_tag::end_array, open.back().second);
+  }
+  constexpr void begin_object() final {
+    value();
+    open.emplace_back(words.size(), 0);
+    words.push_back(0); // Patched by end_object.
+  }
+  constexpr void end_object() final {
+    // Member names were counted as values too.
+    close(json_tape_tag::object, json_tape_tag::end_object, open.back().second / 2);
+  }
+  constexpr void begin_int(const bool minus) final {
+    value();
+    number.assign(minus ? "-" : "");
+    pending_number = integer = true;
+  }
+  constexpr void begin_frac() final {
+    number.push_back('.');
+    integer = false;
+  }
+  constexpr void begin_exp(const bool minus) final {
+    number.append(minus ? "e-" : "e+");
+    integer = false;
+  }
+  constexpr void digit(const char c) final { number.push_back(c); }
+};
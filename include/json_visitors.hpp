@@ -0,0 +1,506 @@
+#pragma once
+#include "json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <tuple>
+#include <vector>
+
+/**
+ * Forwards every event to each of `visitors` in turn. The forwarding calls are static: with
+ * `final` visitors and a `json_parser` that knows it holds a `json_tee`, nothing is virtual.
+ */
+template <std::derived_from<json_visitor>... Vs> class json_tee final : public json_visitor {
+  std::tuple<Vs &...> visitors;
+
+  constexpr void each(auto &&event) {
+    std::apply([&event](auto &...visitor) { (event(visitor), ...); }, visitors);
+  }
+
+public:
+  constexpr explicit json_tee(Vs &...visitors) noexcept : visitors(visitors...) {}
+
+  constexpr void begin_json_text() final { each([](auto &v) { v.begin_json_text(); }); }
+  constexpr void bom() final { each([](auto &v) { v.bom(); }); }
+  constexpr void end_json_text() final { each([](auto &v) { v.end_json_text(); }); }
+  constexpr void begin_whitespace() final { each([](auto &v) { v.begin_whitespace(); }); }
+  constexpr void end_whitespace() final { each([](auto &v) { v.end_whitespace(); }); }
+  constexpr void begin_false() final { each([](auto &v) { v.begin_false(); }); }
+  constexpr void end_false() final { each([](auto &v) { v.end_false(); }); }
+  constexpr void begin_null() final { each([](auto &v) { v.begin_null(); }); }
+  constexpr void end_null() final { each([](auto &v) { v.end_null(); }); }
+  constexpr void begin_true() final { each([](auto &v) { v.begin_true(); }); }
+  constexpr void end_true() final { each([](auto &v) { v.end_true(); }); }
+  constexpr void begin_string() final { each([](auto &v) { v.begin_string(); }); }
+  constexpr void codepoint(int c) final { each([c](auto &v) { v.codepoint(c); }); }
+  constexpr void end_string() final { each([](auto &v) { v.end_string(); }); }
+  constexpr void begin_array() final { each([](auto &v) { v.begin_array(); }); }
+  constexpr void end_array() final { each([](auto &v) { v.end_array(); }); }
+  constexpr void begin_object() final { each([](auto &v) { v.begin_object(); }); }
+  constexpr void end_object() final { each([](auto &v) { v.end_object(); }); }
+  constexpr void begin_int(bool minus) final { each([minus](auto &v) { v.begin_int(minus); }); }
+  constexpr void end_int() final { each([](auto &v) { v.end_int(); }); }
+  constexpr void begin_frac() final { each([](auto &v) { v.begin_frac(); }); }
+  constexpr void end_frac() final { each([](auto &v) { v.end_frac(); }); }
+  constexpr void begin_exp(bool minus) final { each([minus](auto &v) { v.begin_exp(minus); }); }
+  constexpr void end_exp() final { each([](auto &v) { v.end_exp(); }); }
+  constexpr void digit(char c) final { each([c](auto &v) { v.digit(c); }); }
+};
+
+/** Categories of events, to be combined as the mask of a `json_filter`. */
+struct json_events {
+  static constexpr unsigned text = 1 << 0;       // begin_json_text, bom, end_json_text
+  static constexpr unsigned whitespace = 1 << 1; // begin_whitespace, end_whitespace
+  static constexpr unsigned literal = 1 << 2;    // false, null and true
+  static constexpr unsigned string = 1 << 3;     // begin_string, end_string
+  static constexpr unsigned codepoint = 1 << 4;
+  static constexpr unsigned container = 1 << 5; // arrays and objects
+  static constexpr unsigned number = 1 << 6;    // int, frac and exp
+  static constexpr unsigned digit = 1 << 7;
+  static constexpr unsigned all = (1 << 8) - 1;
+};
+
+/** Forwards only the events in the `events` mask; the others compile to nothing. */
+template <unsigned events, std::derived_from<json_visitor> V>
+class json_filter final : public json_visitor {
+  V &visitor;
+
+public:
+  constexpr explicit json_filter(V &visitor) noexcept : visitor(visitor) {}
+
+  constexpr void begin_json_text() final {
+    if constexpr (events & json_events::text) {
+      visitor.begin_json_text();
+    }
+  }
+  constexpr void bom() final {
+    if constexpr (events & json_events::text) {
+      visitor.bom();
+    }
+  }
+  constexpr void end_json_text() final {
+    if constexpr (events & json_events::text) {
+      visitor.end_json_text();
+    }
+  }
+  constexpr void begin_whitespace() final {
+    if constexpr (events & json_events::whitespace) {
+      visitor.begin_whitespace();
+    }
+  }
+  constexpr void end_whitespace() final {
+    if constexpr (events & json_events::whitespace) {
+      visitor.end_whitespace();
+    }
+  }
+  constexpr void begin_false() final {
+    if constexpr (events & json_events::literal) {
+      visitor.begin_false();
+    }
+  }
+  constexpr void end_false() final {
+    if constexpr (events & json_events::literal) {
+      visitor.end_false();
+    }
+  }
+  constexpr void begin_null() final {
+    if constexpr (events & json_events::literal) {
+      visitor.begin_null();
+    }
+  }
+  constexpr void end_null() final {
+    if constexpr (events & json_events::literal) {
+      visitor.end_null();
+    }
+  }
+  constexpr void begin_true() final {
+    if constexpr (events & json_events::literal) {
+      visitor.begin_true();
+    }
+  }
+  constexpr void end_true() final {
+    if constexpr (events & json_events::literal) {
+      visitor.end_true();
+    }
+  }
+  constexpr void begin_string() final {
+    if constexpr (events & json_events::string) {
+      visitor.begin_string();
+    }
+  }
+  constexpr void codepoint(int c) final {
+    if constexpr (events & json_events::codepoint) {
+      visitor.codepoint(c);
+    }
+  }
+  constexpr void end_string() final {
+    if constexpr (events & json_events::string) {
+      visitor.end_string();
+    }
+  }
+  constexpr void begin_array() final {
+    if constexpr (events & json_events::container) {
+      visitor.begin_array();
+    }
+  }
+  constexpr void end_array() final {
+    if constexpr (events & json_events::container) {
+      visitor.end_array();
+    }
+  }
+  constexpr void begin_object() final {
+    if constexpr (events & json_events::container) {
+      visitor.begin_object();
+    }
+  }
+  constexpr void end_object() final {
+    if constexpr (events & json_events::container) {
+      visitor.end_object();
+    }
+  }
+  constexpr void begin_int(bool minus) final {
+    if constexpr (events & json_events::number) {
+      visitor.begin_int(minus);
+    }
+  }
+  constexpr void end_int() final {
+    if constexpr (events & json_events::number) {
+      visitor.end_int();
+    }
+  }
+  constexpr void begin_frac() final {
+    if constexpr (events & json_events::number) {
+      visitor.begin_frac();
+    }
+  }
+  constexpr void end_frac() final {
+    if constexpr (events & json_events::number) {
+      visitor.end_frac();
+    }
+  }
+  constexpr void begin_exp(bool minus) final {
+    if constexpr (events & json_events::number) {
+      visitor.begin_exp(minus);
+    }
+  }
+  constexpr void end_exp() final {
+    if constexpr (events & json_events::number) {
+      visitor.end_exp();
+    }
+  }
+  constexpr void digit(char c) final {
+    if constexpr (events & json_events::digit) {
+      visitor.digit(c);
+    }
+  }
+};
+
+template <unsigned events, std::derived_from<json_visitor> V>
+constexpr json_filter<events, V> make_json_filter(V &visitor) noexcept {
+  return json_filter<events, V>(visitor);
+}
+
+/**
+ * Forwards only the values found at `path`, each as a json-text of its own. A path segment names
+ * an object member, while `std::nullopt` stands for every element of an array or member of an
+ * object. The path MUST outlive the projection.
+ */
+template <std::derived_from<json_visitor> V> class json_project final : public json_visitor {
+public:
+  using path_type = std::span<const std::optional<std::u8string_view>>;
+
+private:
+  struct frame {
+    bool object;
+    bool on_path;       // This container is reached by a prefix of the path.
+    bool name_next;     // The next string of this object is a member name.
+    bool child_on_path; // The current member of this object continues the path.
+  };
+
+  V &visitor;
+  path_type path;
+  std::vector<frame> frames;
+  int nesting = -1;     // Containers open within the projected value; -1 when not projecting.
+  bool number = false;  // The projected value is a number, which ends at the next whitespace.
+  bool naming = false;  // Matching a member name against the path.
+  bool name_matches = false;
+  size_t name_size = 0; // Code units of the member name matched so far.
+
+  [[nodiscard]] constexpr bool projecting() const noexcept { return nesting >= 0; }
+
+  constexpr void end_projection() {
+    nesting = -1;
+    number = false;
+    visitor.end_json_text();
+  }
+
+  /** Returns true if the value beginning now is projected, in which case the caller forwards. */
+  constexpr bool begin_value(const bool container, const bool object) {
+    bool on_path = true;
+    if (!frames.empty()) {
+      auto &top = frames.back();
+      on_path = top.on_path && (top.object ? top.child_on_path : !path[frames.size() - 1]);
+      top.name_next = true;
+    }
+    if (on_path && frames.size() == path.size()) {
+      visitor.begin_json_text();
+      nesting = container;
+      return true;
+    }
+    if (container) {
+      frames.push_back({.object = object, .on_path = on_path, .name_next = true});
+    }
+    return false;
+  }
+
+  /** The path segment for the members of the innermost object, if that object is on the path. */
+  [[nodiscard]] constexpr const std::optional<std::u8string_view> *segment() const noexcept {
+    return frames.back().on_path ? &path[frames.size() - 1] : nullptr;
+  }
+
+  constexpr void end_scalar(auto &&forward) {
+    if (projecting()) {
+      forward();
+      if (nesting == 0) {
+        end_projection();
+      }
+    }
+  }
+
+  constexpr void end_container(auto &&forward) {
+    if (projecting()) {
+      forward();
+      if (--nesting == 0) {
+        end_projection();
+      }
+    } else {
+      frames.pop_back();
+    }
+  }
+
+public:
+  constexpr json_project(V &visitor, const path_type path) noexcept
+      : visitor(visitor), path(path) {}
+
+  constexpr void begin_json_text() final {
+    frames.clear();
+    nesting = -1;
+    number = naming = false;
+  }
+  constexpr void end_json_text() final {
+    if (number) {
+      end_projection();
+    }
+  }
+  constexpr void begin_whitespace() final {
+    if (number) {
+      end_projection();
+    } else if (nesting > 0) {
+      visitor.begin_whitespace();
+    }
+  }
+  constexpr void end_whitespace() final {
+    if (nesting > 0) {
+      visitor.end_whitespace();
+    }
+  }
+  constexpr void begin_false() final {
+    if (projecting() || begin_value(false, false)) {
+      visitor.begin_false();
+    }
+  }
+  constexpr void end_false() final {
+    end_scalar([this] { visitor.end_false(); });
+  }
+  constexpr void begin_null() final {
+    if (projecting() || begin_value(false, false)) {
+      visitor.begin_null();
+    }
+  }
+  constexpr void end_null() final {
+    end_scalar([this] { visitor.end_null(); });
+  }
+  constexpr void begin_true() final {
+    if (projecting() || begin_value(false, false)) {
+      visitor.begin_true();
+    }
+  }
+  constexpr void end_true() final {
+    end_scalar([this] { visitor.end_true(); });
+  }
+  constexpr void begin_string() final {
+    if (projecting()) {
+      visitor.begin_string();
+    } else if (!frames.empty() && frames.back().object && frames.back().name_next) {
+      frames.back().name_next = false;
+      naming = true;
+      name_matches = true;
+      name_size = 0;
+    } else if (begin_value(false, false)) {
+      visitor.begin_string();
+    }
+  }
+  constexpr void codepoint(int c) final {
+    if (projecting()) {
+      visitor.codepoint(c);
+      return;
+    }
+    const auto *const name = naming ? segment() : nullptr;
+    if (name == nullptr || !*name || !name_matches) {
+      return;
+    }
+    char8_t units[4];
+    for (const char8_t *u = units, *const last = encode_utf8(c, units); u != last; ++u) {
+      name_matches &= name_size < (*name)->size() && (**name)[name_size++] == *u;
+    }
+  }
+  constexpr void end_string() final {
+    if (!naming) {
+      end_scalar([this] { visitor.end_string(); });
+      return;
+    }
+    naming = false;
+    const auto *const name = segment();
+    frames.back().child_on_path =
+        name != nullptr && (!*name || (name_matches && name_size == (*name)->size()));
+  }
+  constexpr void begin_array() final {
+    if (projecting()) {
+      ++nesting;
+      visitor.begin_array();
+    } else if (begin_value(true, false)) {
+      visitor.begin_array();
+    }
+  }
+  constexpr void end_array() final {
+    end_container([this] { visitor.end_array(); });
+  }
+  constexpr void begin_object() final {
+    if (projecting()) {
+      ++nesting;
+      visitor.begin_object();
+    } else if (begin_value(true, true)) {
+      visitor.begin_object();
+    }
+  }
+  constexpr void end_object() final {
+    end_container([this] { visitor.end_object(); });
+  }
+  constexpr void begin_int(bool minus) final {
+    if (projecting()) {
+      visitor.begin_int(minus);
+    } else if (begin_value(false, false)) {
+      number = true;
+      visitor.begin_int(minus);
+    }
+  }
+  constexpr void end_int() final {
+    if (projecting()) {
+      visitor.end_int();
+    }
+  }
+  constexpr void begin_frac() final {
+    if (projecting()) {
+      visitor.begin_frac();
+    }
+  }
+  constexpr void end_frac() final {
+    if (projecting()) {
+      visitor.end_frac();
+    }
+  }
+  constexpr void begin_exp(bool minus) final {
+    if (projecting()) {
+      visitor.begin_exp(minus);
+    }
+  }
+  constexpr void end_exp() final {
+    if (projecting()) {
+      visitor.end_exp();
+    }
+  }
+  constexpr void digit(char c) final {
+    if (projecting()) {
+      visitor.digit(c);
+    }
+  }
+};
+
+/** Counts what json-texts are made of, and measures how long lexing them takes at runtime. */
+struct json_stats final : json_visitor {
+  size_t texts = 0;
+  size_t nulls = 0;
+  size_t booleans = 0;
+  size_t strings = 0; // Member names included.
+  size_t arrays = 0;
+  size_t objects = 0;
+  size_t integers = 0;
+  size_t decimals = 0;   // With a fraction but no exponent.
+  size_t scientific = 0; // With an exponent.
+  size_t string_bytes = 0;
+  size_t max_depth = 0;
+  std::chrono::nanoseconds elapsed{};
+
+  [[nodiscard]] constexpr size_t tokens() const noexcept {
+    return nulls + booleans + strings + arrays + objects + integers + decimals + scientific;
+  }
+
+  constexpr void begin_json_text() final {
+    if !consteval {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+  constexpr void end_json_text() final {
+    ++texts;
+    if !consteval {
+      elapsed += std::chrono::steady_clock::now() - start;
+    }
+  }
+  constexpr void end_false() final { ++booleans; }
+  constexpr void end_null() final { ++nulls; }
+  constexpr void end_true() final { ++booleans; }
+  constexpr void begin_string() final { ++strings; }
+  constexpr void codepoint(int c) final {
+    string_bytes += c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x1'0000 ? 3 : 4;
+  }
+  constexpr void begin_array() final {
+    ++arrays;
+    max_depth = std::max(max_depth, ++depth);
+  }
+  constexpr void end_array() final { --depth; }
+  constexpr void begin_object() final {
+    ++objects;
+    max_depth = std::max(max_depth, ++depth);
+  }
+  constexpr void end_object() final { --depth; }
+  constexpr void begin_int(bool) final {
+    ++integers;
+    fraction = false;
+  }
+  constexpr void begin_frac() final {
+    --integers;
+    ++decimals;
+    fraction = true;
+  }
+  constexpr void begin_exp(bool) final {
+    --(fraction ? decimals : integers);
+    ++scientific;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const json_stats &stats) {
+    return os << "texts=" << stats.texts << " tokens=" << stats.tokens()
+              << " nulls=" << stats.nulls << " booleans=" << stats.booleans
+              << " strings=" << stats.strings << " arrays=" << stats.arrays
+              << " objects=" << stats.objects << " integers=" << stats.integers
+              << " decimals=" << stats.decimals << " scientific=" << stats.scientific
+              << " string_bytes=" << stats.string_bytes << " max_depth=" << stats.max_depth
+              << " ns=" << stats.elapsed.count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start;
+  size_t depth = 0;
+  bool fraction = false;
+};
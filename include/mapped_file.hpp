@@ -0,0 +1,57 @@
+#pragma once
+#include <fcntl.h>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * Read-only, private memory mapping of a whole file. The file descriptor is closed right after
+ * mapping; an empty or unreadable file yields an empty (falsy) mapping.
+ */
+class mapped_file {
+  const char8_t *data = nullptr;
+  size_t size = 0;
+
+public:
+  explicit mapped_file(const char *path) noexcept {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    if (struct stat st{}; fstat(fd, &st) == 0 && st.st_size > 0) {
+      const auto length = static_cast<size_t>(st.st_size);
+      if (void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0); addr != MAP_FAILED) {
+        data = static_cast<const char8_t *>(addr);
+        size = length;
+      }
+    }
+    close(fd);
+  }
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  mapped_file(mapped_file &&other) noexcept
+      : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+  mapped_file &operator=(mapped_file &&other) noexcept {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    return *this;
+  }
+  ~mapped_file() {
+    if (data != nullptr) {
+      munmap(const_cast<char8_t *>(data), size);
+    }
+  }
+
+  [[nodiscard]] explicit operator bool() const noexcept { return data != nullptr; }
+  [[nodiscard]] std::u8string_view view() const noexcept { return {data, size}; }
+
+  /** Hints the kernel about the upcoming access pattern, e.g. `MADV_SEQUENTIAL`. */
+  void advise(const int advice) const noexcept {
+    if (data != nullptr) {
+      madvise(const_cast<char8_t *>(data), size, advice);
+    }
+  }
+};
@@ -152,6 +152,27 @@ template <utf8_code_unit_sequence R> constexpr int codepoint_view<R>::iterator::
   return codepoint ^ (0xF0 << 18);
 }
 
+/** Writes the UTF-8 encoding of a valid codepoint to `out`; returns one past the last code unit. */
+constexpr char8_t *encode_utf8(const int codepoint, char8_t *out) noexcept {
+  consteval_assert(0 <= codepoint && codepoint < 0x11'0000);
+  if (codepoint < 0x80) {
+    *out++ = codepoint;
+  } else if (codepoint < 0x800) {
+    *out++ = 0xC0 | codepoint >> 6;
+    *out++ = 0x80 | (codepoint & 0x3F);
+  } else if (codepoint < 0x1'0000) {
+    *out++ = 0xE0 | codepoint >> 12;
+    *out++ = 0x80 | (codepoint >> 6 & 0x3F);
+    *out++ = 0x80 | (codepoint & 0x3F);
+  } else {
+    *out++ = 0xF0 | codepoint >> 18;
+    *out++ = 0x80 | (codepoint >> 12 & 0x3F);
+    *out++ = 0x80 | (codepoint >> 6 & 0x3F);
+    *out++ = 0x80 | (codepoint & 0x3F);
+  }
+  return out;
+}
+
 constexpr inline struct to_codepoint : std::ranges::range_adaptor_closure<to_codepoint> {
   [[nodiscard]] constexpr auto operator()(utf8_code_unit_sequence auto &&code_units) const {
     return codepoint_view(code_units);
@@ -0,0 +1,326 @@
+#include "json_parallel.hpp"
+#include "json_tape.hpp"
+#include "json_visitors.hpp"
+#include "mapped_file.hpp"
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/** Appends to a corpus. Every writer is seeded the same, so corpora are the same on every run. */
+class corpus_writer {
+  std::u8string &text;
+
+public:
+  std::mt19937_64 rng{42};
+
+  explicit corpus_writer(std::u8string &text) : text(text) {}
+
+  corpus_writer &operator<<(const std::string_view ascii) {
+    text.append(ascii.begin(), ascii.end());
+    return *this;
+  }
+  corpus_writer &operator<<(const std::u8string_view utf8) {
+    text += utf8;
+    return *this;
+  }
+  corpus_writer &operator<<(const std::integral auto x) {
+    char buffer[24];
+    const auto end = std::to_chars(std::begin(buffer), std::end(buffer), x);
+    return *this << std::string_view(buffer, end.ptr);
+  }
+  /** Fixed notation with `digits` after the point, like coordinates in the wild. */
+  corpus_writer &fixed(const double x, const int digits) {
+    char buffer[64];
+    const auto end = std::to_chars(std::begin(buffer), std::end(buffer), x,
+                                   std::chars_format::fixed, digits);
+    return *this << std::string_view(buffer, end.ptr);
+  }
+  size_t uniform(const size_t n) { return rng() % n; }
+  double uniform(const double low, const double high) {
+    return std::uniform_real_distribution<double>(low, high)(rng);
+  }
+  size_t size() const { return text.size(); }
+};
+
+/** Statuses of a social network: mostly strings, with non-ASCII text, escapes and nulls. */
+std::u8string twitter(const size_t bytes) {
+  constexpr std::u8string_view words[] = {
+      u8"hello",       u8"world",      u8"東京",     u8"café",
+      u8"RT",          u8"@someone",   u8"#json",    u8"\U0001F600",
+      u8"line\\nbreak", u8"\\u00e9t\\u00e9", u8"\\\"quoted\\\"", u8"https:\\/\\/t.co\\/abc",
+  };
+  std::u8string text;
+  corpus_writer out(text);
+  out << "[";
+  for (uint64_t id = 505874924095815681; out.size() < bytes; ++id) {
+    out << (out.size() > 1 ? ",\n" : "\n")
+        << R"({"created_at": "Sun Aug 31 00:29:15 +0000 2014", "id": )" << id
+        << R"(, "id_str": ")" << id << R"(", "text": ")";
+    for (size_t n = 5 + out.uniform(20); n-- > 0;) {
+      out << words[out.uniform(std::size(words))] << (n ? " " : "");
+    }
+    out << R"(", "truncated": false, "in_reply_to_status_id": null, "user": {"id": )"
+        << out.uniform(1'000'000'000) << R"(, "name": "アカウント", )"
+        << R"("screen_name": "user_)" << out.uniform(100'000) << R"(", "location": "", )"
+        << R"("description": "弱虫ペダル", "followers_count": )"
+        << out.uniform(10'000) << R"(, "verified": false, "lang": "ja"}, "entities": )"
+        << R"({"hashtags": [], "urls": [], "user_mentions": [{"screen_name": "a", )"
+        << R"("indices": [3, 12]}]}, "retweet_count": )" << out.uniform(100)
+        << R"(, "favorited": false, "possibly_sensitive": null, "lang": "ja"})";
+  }
+  out << "\n]\n";
+  return text;
+}
+
+/** A country border as one multi-polygon: numbers almost exclusively, in long flat arrays. */
+std::u8string canada(const size_t bytes) {
+  std::u8string text;
+  corpus_writer out(text);
+  out << R"({"type": "FeatureCollection", "features": [{"type": "Feature", "properties": )"
+      << R"({"name": "Canada"}, "geometry": {"type": "Polygon", "coordinates": [)";
+  double longitude = -65.6, latitude = 43.5;
+  for (int ring = 0; out.size() < bytes; ++ring) {
+    out << (ring ? "],[" : "[");
+    for (int point = 0; point < 1000 && out.size() < bytes; ++point) {
+      longitude += out.uniform(-0.01, 0.01);
+      latitude += out.uniform(-0.01, 0.01);
+      out << (point ? "," : "") << "[";
+      out.fixed(longitude, 15) << ",";
+      out.fixed(latitude, 14) << "]";
+    }
+  }
+  out << "]]}}]}\n";
+  return text;
+}
+
+/** An array of small documents, each nested dozens of levels deep in alternating containers. */
+std::u8string nested(const size_t bytes) {
+  std::u8string text;
+  corpus_writer out(text);
+  out << "[";
+  for (int i = 0; out.size() < bytes; ++i) {
+    out << (i ? ",\n" : "\n");
+    const size_t depth = 8 + out.uniform(56);
+    for (size_t d = 0; d < depth; ++d) {
+      out << (d % 2 ? R"([true, )" : R"({"k": 0, "child": )");
+    }
+    out << i;
+    for (size_t d = depth; d-- > 0;) {
+      out << (d % 2 ? "]" : "}");
+    }
+  }
+  out << "\n]\n";
+  return text;
+}
+
+/** Newline-delimited request logs: one small object per line. */
+std::u8string ndjson(const size_t bytes) {
+  constexpr std::string_view levels[] = {"DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"};
+  constexpr std::string_view paths[] = {"/", "/api/v1/users", "/api/v1/orders?page=2",
+                                        "/static/app.js", "/healthz"};
+  std::u8string text;
+  corpus_writer out(text);
+  for (int64_t ms = 1'700'000'000'000; out.size() < bytes; ms += out.uniform(50)) {
+    out << R"({"ts": )" << ms << R"(, "level": ")" << levels[out.uniform(std::size(levels))]
+        << R"(", "msg": "request served", "path": ")" << paths[out.uniform(std::size(paths))]
+        << R"(", "status": )" << (out.uniform(10) ? 200 : 500) << R"(, "latency_ms": )";
+    out.fixed(out.uniform(0.1, 250.0), 3) << R"(, "bytes": )" << out.uniform(1 << 20)
+                                          << R"(, "cached": )"
+                                          << (out.uniform(2) ? "true" : "false")
+                                          << R"(, "trace": null})" << "\n";
+  }
+  return text;
+}
+
+/** A GeoJSON-like collection of point features, as a top-level array of about `bytes` bytes. */
+std::u8string feature_collection(const size_t bytes) {
+  std::u8string text;
+  corpus_writer out(text);
+  out << "[\n";
+  for (int id = 0; out.size() < bytes; ++id) {
+    out << (id ? ",\n  {" : "  {") << R"("type": "Feature", "properties": {"id": )" << id
+        << R"(, "name": "Feature \"#)" << id << R"(\"", "zip": "94)" << id % 1000
+        << R"(", "tags": ["a", "b"], "open": true}, "geometry": {"type": "Point", )"
+        << R"("coordinates": [)";
+    out.fixed(out.uniform(-122.6, -121.8), 6) << ", ";
+    out.fixed(out.uniform(37.2, 37.9), 6) << "]}}";
+  }
+  out << "\n]\n";
+  return text;
+}
+
+struct corpus {
+  const char *name;
+  std::u8string (*generate)(size_t bytes);
+  bool lines; // One json-text per line rather than a single one.
+};
+
+constexpr corpus corpora[] = {
+    {"twitter", twitter, false}, {"canada", canada, false}, {"nested", nested, false},
+    {"ndjson", ndjson, true},    {"features", feature_collection, false},
+};
+
+/** Splits `text` into `n` runs of whole lines, of roughly equal size in bytes. */
+std::vector<std::u8string_view> split_lines(const std::u8string_view text, const unsigned n) {
+  std::vector<std::u8string_view> runs;
+  size_t first = 0;
+  for (unsigned i = 1; i <= n; ++i) {
+    size_t last = i == n ? text.size() : std::max(first, text.size() * i / n);
+    last = last == text.size() ? last : std::min(text.find(u8'\n', last), text.size());
+    runs.push_back(text.substr(first, last - first));
+    first = last;
+  }
+  return runs;
+}
+
+/** Lexes every non-blank line of `text` as its own json-text; returns -1 iff all are valid. */
+template <std::derived_from<json_visitor> V> int lex_lines(std::u8string_view text, V &visitor) {
+  while (!text.empty()) {
+    const size_t end = std::min(text.find(u8'\n'), text.size());
+    if (const auto line = text.substr(0, end); !json_impl::is_whitespace(line)) {
+      if (const int ret = json_parser(line | to_codepoint, &visitor).lex_json_text(); ret != -1) {
+        return ret;
+      }
+    }
+    text.remove_prefix(std::min(end + 1, text.size()));
+  }
+  return -1;
+}
+
+/**
+ * Lexes `text` once with fresh visitors of type `V`, one per thread; returns -1 iff valid. Tapes
+ * built in parallel are stitched into one, as that is part of the cost of parsing in parallel.
+ */
+template <std::derived_from<json_visitor> V>
+int lex_corpus(const std::u8string_view text, const bool lines, const unsigned threads) {
+  std::vector<V> visitors(threads);
+  if (lines) {
+    const auto runs = split_lines(text, threads);
+    std::vector<int> results(threads);
+    json_impl::parallel_for(threads, [&](const unsigned i) {
+      results[i] = lex_lines(runs[i], visitors[i]);
+    });
+    const auto error = std::ranges::find_if(results, [](int ret) { return ret != -1; });
+    if constexpr (std::same_as<V, json_tape_builder>) {
+      if (threads > 1 && error == results.end()) {
+        json_tape_builder tape;
+        for (const auto &visitor : visitors) {
+          tape.append(visitor.tape());
+        }
+      }
+    }
+    return error == results.end() ? -1 : *error;
+  }
+  if (threads == 1) { // Statically dispatched to `V`.
+    return json_parser(text | to_codepoint, &visitors.front()).lex_json_text();
+  }
+  if constexpr (std::same_as<V, json_tape_builder>) {
+    json_tape_builder tape;
+    return parse_json_tape_parallel(text, threads, tape);
+  }
+  std::vector<json_visitor *> pointers;
+  for (auto &visitor : visitors) {
+    pointers.push_back(&visitor);
+  }
+  return lex_json_array_parallel(text, pointers);
+}
+
+/** Nearest-rank percentile of sorted samples. */
+double percentile(const std::vector<double> &sorted, const double p) {
+  const auto rank = static_cast<size_t>(std::ceil(p / 100 * sorted.size()));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+/**
+ * Usage: bench_json [megabytes=16] [repetitions=7] [threads=all cores]
+ *
+ * Prints one line per corpus, then one per measurement, as space-separated `key=value` pairs in a
+ * fixed order, so runs can be diffed or parsed to catch regressions. Each measurement is one
+ * warmup followed by `repetitions` timed runs; throughput is at the median and the p99 run time,
+ * and the speedup is the median on one thread over that on as many as measured.
+ */
+int main(const int argc, const char *argv[]) {
+  const size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+  const int repetitions = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 7;
+  const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const unsigned parallel = argc > 3 ? std::max(std::atoi(argv[3]), 1) : cores;
+  std::printf("bench_json version=2 megabytes=%zu repetitions=%d threads=%u\n", megabytes,
+              repetitions, parallel);
+
+  using lexer = int (*)(std::u8string_view, bool, unsigned);
+  constexpr std::pair<const char *, lexer> visitors[] = {
+      {"null", lex_corpus<json_visitor>},
+      {"stats", lex_corpus<json_stats>},
+      {"tape", lex_corpus<json_tape_builder>},
+  };
+
+  char path[] = "/tmp/bench_json.XXXXXX";
+  const int fd = mkstemp(path);
+  assert(fd >= 0);
+  for (const auto &[name, generate, lines] : corpora) {
+    const std::u8string generated = generate(megabytes << 20);
+    const std::u8string_view text = generated;
+    const int truncated = ftruncate(fd, 0);
+    const ssize_t written = pwrite(fd, text.data(), text.size(), 0);
+    assert(truncated == 0 && written == static_cast<ssize_t>(text.size()));
+    json_stats stats;
+    const int ret =
+        lines ? lex_lines(text, stats) : json_parser(text | to_codepoint, &stats).lex_json_text();
+    assert(ret == -1);
+    std::printf("corpus=%s bytes=%zu texts=%zu tokens=%zu max_depth=%zu\n", name, text.size(),
+                stats.texts, stats.tokens(), stats.max_depth);
+
+    // Parallel lexing splits top-level arrays and lines; other documents would be sequential.
+    // Threads double up to the count asked for, which is also measured.
+    std::vector<unsigned> thread_counts{1};
+    if (parallel > 1 && (lines || split_json_array(text, 1))) {
+      for (unsigned threads = 2; threads < parallel; threads *= 2) {
+        thread_counts.push_back(threads);
+      }
+      thread_counts.push_back(parallel);
+    }
+    double one[std::size(visitors)][2]; // Median seconds on one thread, by visitor and source.
+    for (const unsigned threads : thread_counts) {
+      for (size_t v = 0; v < std::size(visitors); ++v) {
+        const auto &[visitor, lex] = visitors[v];
+        for (const bool mmap : {false, true}) {
+          const auto run = [&] {
+            const auto start = std::chrono::steady_clock::now();
+            int ret;
+            if (mmap) {
+              const mapped_file file(path);
+              file.advise(MADV_SEQUENTIAL);
+              ret = lex(file.view(), lines, threads);
+            } else {
+              ret = lex(text, lines, threads);
+            }
+            assert(ret == -1);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          };
+          run();
+          std::vector<double> seconds;
+          for (int i = 0; i < repetitions; ++i) {
+            seconds.push_back(run());
+          }
+          std::ranges::sort(seconds);
+          const double mb = text.size() / double{1 << 20};
+          const double median = percentile(seconds, 50), p99 = percentile(seconds, 99);
+          if (threads == 1) {
+            one[v][mmap] = median;
+          }
+          std::printf("corpus=%s mode=%s threads=%u visitor=%s source=%s median_ms=%.3f "
+                      "p99_ms=%.3f median_MBps=%.1f p99_MBps=%.1f speedup=%.2f\n",
+                      name, threads == 1 ? "sequential" : "parallel", threads, visitor,
+                      mmap ? "mmap" : "view", median * 1e3, p99 * 1e3, mb / median, mb / p99,
+                      one[v][mmap] / median);
+          std::fflush(stdout);
+        }
+      }
+    }
+  }
+  close(fd);
+  unlink(path);
+}
@@ -17,6 +17,11 @@ static_assert(test(u8"null"sv));
 static_assert(test(u8"true"sv));
 static_assert(test(u8"\"Hello world!\""sv));
 static_assert(test(u8"42"sv));
+static_assert(test(u8"[ ]"sv));
+static_assert(test(u8"{}"sv));
+static_assert(test(u8"[{ }, []]"sv));
+static_assert(!test(u8"[,]"sv));
+static_assert(!test(u8"{,}"sv));
 
 constexpr char8_t file1[] = {
 #embed "Image.json"
@@ -0,0 +1,62 @@
+#include "json_incremental.hpp"
+
+using namespace std::string_view_literals;
+
+/** The spans of an edited document MUST equal those of a fresh index of its text. */
+constexpr bool consistent(const incremental_json_parser &parser) {
+  std::vector<json_span> spans;
+  return index_json_containers(parser.get_text(), spans) && spans == parser.get_spans();
+}
+
+constexpr bool relexed(const incremental_json_parser &parser, const size_t begin,
+                       const size_t end) {
+  const auto span = parser.get_relexed();
+  return span.begin == begin && span.end == end;
+}
+
+constexpr bool test_indexing() {
+  std::vector<json_span> spans;
+  return index_json_containers(u8R"({"a": [1, "]"], "b": {"c": "\"{"}})"sv, spans) &&
+         spans == std::vector<json_span>{{0, 34, json_span::npos}, {6, 14, 0}, {21, 33, 0}} &&
+         !index_json_containers(u8"[}"sv, spans) && !index_json_containers(u8"[\"]"sv, spans);
+}
+static_assert(test_indexing());
+
+constexpr bool test_edits() {
+  json_visitor visitor;
+  incremental_json_parser parser(std::u8string(u8R"({"a": [1, 2], "b": {"c": [true]}})"));
+  if (parser.parse(&visitor) != -1 || parser.get_spans().size() != 4) {
+    return false;
+  }
+  // Only the array holding the edited number is re-lexed; later spans shift by one.
+  if (parser.edit(10, 1, u8"20"sv, &visitor) != -1 || !relexed(parser, 6, 13) ||
+      !consistent(parser)) {
+    return false;
+  }
+  // An error stays confined to its container, and fixing it re-lexes just that container.
+  if (parser.edit(10, 2, u8"2x"sv, &visitor) == -1 || !relexed(parser, 6, 13) ||
+      parser.edit(11, 1, u8""sv, &visitor) != -1 || !relexed(parser, 6, 12)) {
+    return false;
+  }
+  // Brackets inside strings do not change the structure.
+  if (parser.edit(26, 4, u8"\"]\""sv, &visitor) != -1 || !relexed(parser, 25, 30) ||
+      parser.get_text() != u8R"({"a": [1, 2], "b": {"c": ["]"]}})"sv || !consistent(parser)) {
+    return false;
+  }
+  // Nested containers inserted into an array are indexed.
+  if (parser.edit(7, 0, u8"[{}], "sv, &visitor) != -1 || !relexed(parser, 6, 18) ||
+      parser.get_spans().size() != 6 || !consistent(parser)) {
+    return false;
+  }
+  // Changing the structure falls back to a full parse.
+  if (parser.edit(7, 1, u8""sv, &visitor) == -1 || !relexed(parser, 0, 37) ||
+      parser.edit(7, 0, u8"["sv, &visitor) != -1 || !relexed(parser, 0, 38) ||
+      !consistent(parser)) {
+    return false;
+  }
+  // Editing outside of every container parses everything.
+  return parser.edit(0, 0, u8" "sv, &visitor) == -1 && relexed(parser, 0, 39) && consistent(parser);
+}
+static_assert(test_edits());
+
+int main() {}
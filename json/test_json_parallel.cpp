@@ -0,0 +1,143 @@
+#include "json_parallel.hpp"
+#include <random>
+
+using namespace std::string_view_literals;
+
+/** One byte at a time: whether each byte is inside a string, as `json_string_state` defines it. */
+std::vector<bool> reference_inside(const std::u8string_view text) {
+  std::vector<bool> inside;
+  bool in_string = false;
+  bool escaped = false;
+  for (const char8_t c : text) {
+    if (c == '"' && !escaped) {
+      in_string = !in_string;
+    }
+    inside.push_back(in_string);
+    escaped = c == '\\' && !escaped;
+  }
+  return inside;
+}
+
+bool test_string_state(const std::u8string_view text) {
+  std::vector<bool> inside;
+  json_string_state state;
+  json_impl::for_each_json_block(text, 0, text.size(), [&](size_t offset, const json_block &b) {
+    const uint64_t mask = state.next(b);
+    for (size_t i = 0; i < 64 && offset + i < text.size(); ++i) {
+      inside.push_back(mask >> i & 1);
+    }
+  });
+  return inside == reference_inside(text);
+}
+
+/** Random arrays whose strings are full of escapes and brackets, nested a few levels deep. */
+void random_array(std::mt19937 &rng, std::u8string &text, const int depth) {
+  text += u8'[';
+  for (int n = rng() % 8; n-- > 0;) {
+    switch (rng() % (depth > 0 ? 4 : 3)) {
+    case 0:
+      text += u8"12.5e-3";
+      break;
+    case 1:
+      text += u8'"';
+      for (int k = rng() % 70; k-- > 0;) {
+        constexpr auto alphabet = u8"ab[]{},: \\"sv;
+        const auto c = alphabet[rng() % alphabet.size()];
+        text += c;
+        if (c == '\\') { // Always a valid escape.
+          text += "\"\\n"[rng() % 3];
+        }
+      }
+      text += u8'"';
+      break;
+    case 2:
+      text += u8"{\"k\": [null, {}]}";
+      break;
+    case 3:
+      random_array(rng, text, depth - 1);
+      break;
+    }
+    if (n > 0) {
+      text += u8", ";
+    }
+  }
+  text += u8']';
+}
+
+struct counting_visitor final : json_visitor {
+  int objects = 0;
+  int texts = 0;
+  constexpr void begin_object() final { ++objects; }
+  constexpr void end_json_text() final { ++texts; }
+};
+
+/** Whether parsing `text` onto a tape in parallel gives the tape a sequential parse does. */
+bool test_tape(const std::u8string_view text, const unsigned threads) {
+  json_tape_builder sequential, parallel;
+  const int expected = json_parser(text | to_codepoint, &sequential).lex_json_text();
+  return parse_json_tape_parallel(text, threads, parallel) == expected &&
+         (expected != -1 || parallel.tape() == sequential.tape());
+}
+
+int lex_in_parallel(const std::u8string_view text, std::vector<counting_visitor> &counters) {
+  std::vector<json_visitor *> visitors;
+  for (auto &counter : counters) {
+    visitors.push_back(&counter);
+  }
+  return lex_json_array_parallel(text, visitors);
+}
+
+constexpr char8_t file2[] = {
+#embed "San_Francisco_and_Sunnyvale.json"
+};
+
+int main() {
+  std::mt19937 rng(42);
+  for (int i = 0; i < 500; ++i) {
+    std::u8string text;
+    random_array(rng, text, 3);
+    assert(test_string_state(text));
+
+    // Every thread count MUST agree with a single scan.
+    const auto expected = split_json_array(text, 1);
+    assert(expected);
+    for (unsigned threads = 2; threads <= 9; ++threads) {
+      assert(split_json_array(text, threads) == expected);
+    }
+    for (const size_t at : *expected) {
+      assert(text[at] == (at == expected->front() ? '[' : at == expected->back() ? ']' : ','));
+    }
+    for (const unsigned threads : {1, 2, 3, 8}) {
+      assert(test_tape(text, threads));
+    }
+  }
+
+  const std::u8string_view sf(std::begin(file2), std::end(file2));
+  assert(split_json_array(sf, 3)->size() == 3);
+  for (const unsigned threads : {1, 2, 5}) {
+    std::vector<counting_visitor> counters(threads);
+    assert(lex_in_parallel(sf, counters) == -1);
+    int objects = 0;
+    int texts = 0;
+    for (const auto &counter : counters) {
+      objects += counter.objects;
+      texts += counter.texts;
+    }
+    assert(objects == 2 && texts == 2);
+    assert(test_tape(sf, threads));
+  }
+  for (const auto text : {u8" [ ] "sv, u8"[[1, \"a\"], {\"b\": [2.5]}, \"c\", [[], {}]]"sv,
+                          u8"[1] [2]"sv, u8"{\"a\": [1, 2]}"sv, u8"[1, , 3]"sv}) {
+    assert(test_tape(text, 3));
+  }
+
+  std::vector<counting_visitor> counters(2);
+  assert(lex_in_parallel(u8" [ ] "sv, counters) == -1);
+  assert(lex_in_parallel(u8"[1, 2, 3, 4]"sv, counters) == -1);
+  assert(lex_in_parallel(u8"[1, , 3, 4]"sv, counters) != -1);
+  assert(lex_in_parallel(u8"[1, 2, 3, 4x]"sv, counters) != -1);
+  assert(!split_json_array(u8"[1] [2]"sv, 2));
+  assert(lex_in_parallel(u8"[1] [2]"sv, counters) != -1); // Lexed sequentially.
+  assert(lex_in_parallel(u8"{\"a\": [1, 2]}"sv, counters) == -1);
+  assert(lex_in_parallel(u8"[\"],\\\"\", {\"]\": 1}]"sv, counters) == -1);
+}
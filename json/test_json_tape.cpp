@@ -0,0 +1,104 @@
+#include "json_tape.hpp"
+#include "mapped_file.hpp"
+#include <cstdlib>
+#include <unistd.h>
+
+constexpr bool build(utf8_code_unit_sequence auto &&source, json_tape_builder &builder) {
+  return json_parser(source | to_codepoint, &builder).lex_json_text() == -1;
+}
+
+using namespace std::string_view_literals;
+
+static_assert([] {
+  json_tape_builder builder;
+  return build(u8"null"sv, builder) && builder.tape().root().is_null();
+}());
+static_assert([] {
+  json_tape_builder builder;
+  return build(u8" true "sv, builder) && builder.tape().root().get_bool() == true;
+}());
+static_assert([] {
+  json_tape_builder builder;
+  return build(u8"-42"sv, builder) && builder.tape().root().get_int64() == -42;
+}());
+static_assert([] {
+  json_tape_builder builder;
+  return build(u8"-9223372036854775808"sv, builder) &&
+         builder.tape().root().get_int64() == INT64_MIN;
+}());
+static_assert([] {
+  json_tape_builder builder;
+  const auto root = (build(u8"9223372036854775808"sv, builder), builder.tape().root());
+  return !root.get_int64() && root.get_double() > 9.2e18;
+}());
+static_assert([] {
+  json_tape_builder builder;
+  return build(u8"1.5e1"sv, builder) && builder.tape().root().get_double() == 15;
+}());
+static_assert([] {
+  json_tape_builder builder;
+  return build(u8"\"a\\n\xC3\xA9\""sv, builder) &&
+         builder.tape().root().get_string() == u8"a\n\xC3\xA9"sv;
+}());
+static_assert([] {
+  json_tape_builder builder;
+  if (!build(u8"[1, [2, 3.5], {\"k\": true}, []]"sv, builder)) {
+    return false;
+  }
+  const auto root = builder.tape().root();
+  int64_t sum = 0;
+  for (const auto element : root.elements()) {
+    sum += element.get_int64().value_or(100);
+  }
+  return root.size() == 4 && sum == 301 && root.at(1)->size() == 2 &&
+         root.at(1)->at(1)->get_double() == 3.5 && (*root.at(2))[u8"k"]->get_bool() == true &&
+         !(*root.at(2))[u8"x"] && root.at(3)->size() == 0 && !root.at(4);
+}());
+
+constexpr char8_t file1[] = {
+#embed "Image.json"
+};
+constexpr char8_t file2[] = {
+#embed "San_Francisco_and_Sunnyvale.json"
+};
+
+static_assert([] {
+  json_tape_builder builder;
+  if (!build(std::views::all(file1), builder)) {
+    return false;
+  }
+  const auto image = *builder.tape().root()[u8"Image"];
+  const auto ids = *image[u8"IDs"];
+  return image.size() == 6 && (*image[u8"Thumbnail"])[u8"Url"]->get_string() ==
+                                  u8"http://www.example.com/image/481989943"sv &&
+         ids.size() == 4 && ids.at(3)->get_int64() == 38793 &&
+         image[u8"Animated"]->get_bool() == false;
+}());
+
+bool check_san_francisco_and_sunnyvale(const json_tape tape) {
+  const auto root = tape.root();
+  return root.size() == 2 && (*root.at(0))[u8"City"]->get_string() == u8"SAN FRANCISCO"sv &&
+         (*root.at(1))[u8"Longitude"]->get_double() == -122.026020 &&
+         (*root.at(1))[u8"Address"]->get_string() == u8""sv;
+}
+
+int main() {
+  json_tape_builder builder;
+  assert(build(std::views::all(file2), builder));
+  assert(check_san_francisco_and_sunnyvale(builder.tape()));
+
+  char path[] = "/tmp/test_json_tape.XXXXXX";
+  const int fd = mkstemp(path);
+  assert(fd >= 0);
+  assert(builder.tape().save(fd));
+  close(fd);
+  {
+    const mapped_file file(path);
+    assert(file);
+    const auto tape = json_tape::load(file.view());
+    assert(tape);
+    assert(check_san_francisco_and_sunnyvale(*tape));
+    assert(!json_tape::load(file.view().substr(0, 31)));
+  }
+  unlink(path);
+}
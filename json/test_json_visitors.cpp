@@ -0,0 +1,112 @@
+#include "json_tape.hpp"
+#include "json_visitors.hpp"
+#include <sstream>
+
+using namespace std::string_view_literals;
+
+constexpr char8_t file1[] = {
+#embed "Image.json"
+};
+constexpr char8_t file2[] = {
+#embed "San_Francisco_and_Sunnyvale.json"
+};
+
+template <std::derived_from<json_visitor> V>
+constexpr bool lex(utf8_code_unit_sequence auto &&source, V &visitor) {
+  return json_parser(source | to_codepoint, &visitor).lex_json_text() == -1;
+}
+
+struct counting_visitor final : json_visitor {
+  int texts = 0;
+  int containers = 0;
+  int others = 0;
+  constexpr void end_json_text() final { ++texts; }
+  constexpr void begin_array() final { ++containers; }
+  constexpr void begin_object() final { ++containers; }
+  constexpr void begin_string() final { ++others; }
+  constexpr void begin_int(bool) final { ++others; }
+  constexpr void begin_null() final { ++others; }
+};
+
+constexpr std::optional<std::u8string_view> any;
+
+static_assert([] {
+  json_stats stats;
+  return lex(std::views::all(file1), stats) && stats.texts == 1 && stats.objects == 3 &&
+         stats.arrays == 1 && stats.strings == 12 && stats.integers == 8 && stats.booleans == 1 &&
+         stats.max_depth == 3 && stats.tokens() == 25;
+}());
+static_assert([] {
+  json_stats stats;
+  return lex(u8"[1, -2.5, 3e2, 4.5E-1, null, \"\xC3\xA9\"]"sv, stats) && stats.integers == 1 &&
+         stats.decimals == 1 && stats.scientific == 2 && stats.nulls == 1 &&
+         stats.string_bytes == 2;
+}());
+
+// A tee delivers every event to each of its visitors, the same as lexing once for each.
+static_assert([] {
+  json_stats stats;
+  json_tape_builder builder;
+  json_tee tee(stats, builder);
+  return lex(std::views::all(file2), tee) && stats.objects == 2 && stats.strings == 28 &&
+         builder.tape().root().size() == 2;
+}());
+
+static_assert([] {
+  counting_visitor counter;
+  auto filter = make_json_filter<json_events::container | json_events::text>(counter);
+  return lex(std::views::all(file1), filter) && counter.texts == 1 && counter.containers == 4 &&
+         counter.others == 0;
+}());
+static_assert([] {
+  counting_visitor counter;
+  auto filter = make_json_filter<json_events::all>(counter);
+  return lex(std::views::all(file1), filter) && counter.containers == 4 && counter.others == 20;
+}());
+
+static_assert([] {
+  const std::optional<std::u8string_view> path[] = {u8"Image", u8"IDs", any};
+  json_stats stats;
+  json_project project(stats, path);
+  return lex(std::views::all(file1), project) && stats.texts == 4 && stats.integers == 4 &&
+         stats.tokens() == 4;
+}());
+static_assert([] {
+  const std::optional<std::u8string_view> path[] = {u8"Image", u8"Thumbnail", u8"Url"};
+  json_tape_builder builder;
+  json_project project(builder, path);
+  return lex(std::views::all(file1), project) &&
+         builder.tape().root().get_string() == u8"http://www.example.com/image/481989943"sv;
+}());
+static_assert([] {
+  const std::optional<std::u8string_view> path[] = {u8"Image", u8"Thumbnail"};
+  json_tape_builder builder;
+  json_project project(builder, path);
+  return lex(std::views::all(file1), project) && builder.tape().root().size() == 3 &&
+         builder.tape().root()[u8"Width"]->get_int64() == 100;
+}());
+static_assert([] {
+  const std::optional<std::u8string_view> path[] = {any, u8"City"};
+  json_stats stats;
+  json_project project(stats, path);
+  return lex(std::views::all(file2), project) && stats.texts == 2 && stats.strings == 2 &&
+         stats.string_bytes == 22;
+}());
+static_assert([] {
+  // Neither a prefix of a name nor a name extending the path's matches.
+  const std::optional<std::u8string_view> path[] = {u8"a", u8"bc"};
+  json_stats stats;
+  json_project project(stats, path);
+  return lex(u8R"({"a": {"b": 1, "bcd": 2, "bc": [3, {"bc": 4}]}, "ab": {"bc": 5}})"sv,
+             project) &&
+         stats.texts == 1 && stats.arrays == 1 && stats.objects == 1 && stats.integers == 2;
+}());
+
+int main() {
+  json_stats stats;
+  assert(lex(std::views::all(file2), stats));
+  std::ostringstream os;
+  os << stats;
+  assert(os.str().starts_with("texts=1 tokens=35 nulls=0 booleans=0 strings=28 arrays=1 "
+                              "objects=2 integers=0 decimals=4 scientific=0"));
+}
@@ -0,0 +1,353 @@
+#pragma once
+#include "formatter.hpp"
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <iterator>
+
+/**
+ * The textual syntax of formatter bytecode, whitespace between tokens and `#` to the end of the
+ * line a comment:
+ *
+ *   123u 123 -5             UInt and Int literals
+ *   "a\"b\\c\n\t\x7f"       String literals, with these escapes
+ *   @strlen                 Selectors, by their names in `Selector`
+ *   { ... }                 A block, which `begin` pushes
+ *   dup drop pick over swap rot if ifelse return call
+ *   + - * / << >> ~ | ^ = != < > <= >=
+ */
+
+/** An instruction of bytecode with its operand: a literal, or the instructions of a block. */
+struct instruction {
+  Instruction code;
+  uint64_t literal = 0; // A UInt, an Int in two's complement, or a Selector.
+  std::string string{};
+  std::vector<instruction> block{};
+
+  bool operator==(const instruction &) const = default;
+};
+
+namespace assembler_impl {
+
+inline constexpr std::array<std::pair<std::string_view, Instruction>, 25> mnemonics{{
+    {"dup", Instruction::dup},     {"drop", Instruction::drop},     {"pick", Instruction::pick},
+    {"over", Instruction::over},   {"swap", Instruction::swap},     {"rot", Instruction::rot},
+    {"if", Instruction::If},       {"ifelse", Instruction::IfElse}, {"return", Instruction::Return},
+    {"call", Instruction::Call},   {"+", Instruction::ADD},         {"-", Instruction::SUB},
+    {"*", Instruction::MUL},       {"/", Instruction::DIV},         {"<<", Instruction::SHL},
+    {">>", Instruction::SHR},      {"~", Instruction::NOT},         {"|", Instruction::OR},
+    {"^", Instruction::XOR},       {"=", Instruction::EQ},          {"!=", Instruction::EQ2},
+    {"<", Instruction::LT},        {">", Instruction::GT},          {"<=", Instruction::LE},
+    {">=", Instruction::GE},
+}};
+
+inline constexpr std::array<std::pair<std::string_view, Selector>, 23> selector_names{{
+    {"summary", Selector::summary},
+    {"type_summary", Selector::type_summary},
+    {"get_num_children", Selector::get_num_children},
+    {"get_child_at_index", Selector::get_child_at_index},
+    {"get_child_with_name", Selector::get_child_with_name},
+    {"get_child_index", Selector::get_child_index},
+    {"get_type", Selector::get_type},
+    {"get_template_argument_type", Selector::get_template_argument_type},
+    {"cast", Selector::cast},
+    {"get_synthetic_value", Selector::get_synthetic_value},
+    {"get_non_synthetic_value", Selector::get_non_synthetic_value},
+    {"get_value", Selector::get_value},
+    {"get_value_as_unsigned", Selector::get_value_as_unsigned},
+    {"get_value_as_signed", Selector::get_value_as_signed},
+    {"get_value_as_address", Selector::get_value_as_address},
+    {"read_memory_byte", Selector::read_memory_byte},
+    {"read_memory_uint32", Selector::read_memory_uint32},
+    {"read_memory_int32", Selector::read_memory_int32},
+    {"read_memory_unsigned", Selector::read_memory_unsigned},
+    {"read_memory_signed", Selector::read_memory_signed},
+    {"read_memory_address", Selector::read_memory_address},
+    {"sprintf", Selector::sprintf},
+    {"strlen", Selector::strlen},
+}};
+
+/**
+ * Parses instructions off the front of `text` up to a `}`, or its end if not within any of the
+ * `nesting` blocks; false if they are not in the syntax or nest deeper than `program` allows.
+ */
+inline bool parse(std::string_view &text, const size_t nesting, std::vector<instruction> &out) {
+  for (;;) {
+    while (!text.empty() && (std::isspace(static_cast<unsigned char>(text.front())) ||
+                             text.front() == '#')) {
+      if (text.front() == '#') {
+        text.remove_prefix(std::min(text.find('\n'), text.size()));
+      } else {
+        text.remove_prefix(1);
+      }
+    }
+    if (text.empty()) {
+      return nesting == 0;
+    }
+    if (text.front() == '}') {
+      text.remove_prefix(1);
+      return nesting != 0;
+    }
+    if (text.front() == '{') {
+      text.remove_prefix(1);
+      instruction &begin = out.emplace_back(Instruction::begin);
+      if (nesting == interpreter::control_capacity || !parse(text, nesting + 1, begin.block)) {
+        return false;
+      }
+      continue;
+    }
+    if (text.front() == '"') {
+      instruction &literal = out.emplace_back(Instruction::String);
+      size_t i = 1;
+      for (; i < text.size() && text[i] != '"'; ++i) {
+        if (text[i] != '\\') {
+          literal.string += text[i];
+          continue;
+        }
+        if (++i == text.size()) {
+          return false;
+        }
+        if (text[i] == 'n') {
+          literal.string += '\n';
+        } else if (text[i] == 't') {
+          literal.string += '\t';
+        } else if (text[i] == 'x') {
+          uint8_t byte = 0;
+          const char *const digits = text.data() + i + 1;
+          if (text.size() < i + 3 ||
+              std::from_chars(digits, digits + 2, byte, 16).ptr != digits + 2) {
+            return false;
+          }
+          literal.string += static_cast<char>(byte);
+          i += 2;
+        } else {
+          literal.string += text[i];
+        }
+      }
+      if (i == text.size()) {
+        return false;
+      }
+      text.remove_prefix(i + 1);
+      continue;
+    }
+    const size_t size = std::min(
+        std::ranges::find_if(text, [](const char c) {
+          return std::isspace(static_cast<unsigned char>(c)) || c == '{' || c == '}' || c == '"' ||
+                 c == '#';
+        }) - text.begin(),
+        static_cast<ptrdiff_t>(text.size()));
+    const std::string_view token = text.substr(0, size);
+    text.remove_prefix(size);
+    if (token.starts_with('@')) {
+      const auto named = std::ranges::find(selector_names, token.substr(1),
+                                           &std::pair<std::string_view, Selector>::first);
+      if (named == selector_names.end()) {
+        return false;
+      }
+      out.push_back({Instruction::Selector, std::to_underlying(named->second)});
+    } else if (const auto mnemonic = std::ranges::find(
+                   mnemonics, token, &std::pair<std::string_view, Instruction>::first);
+               mnemonic != mnemonics.end()) {
+      out.push_back({mnemonic->second});
+    } else if (token.ends_with('u')) {
+      uint64_t n = 0;
+      const char *const last = token.data() + token.size() - 1;
+      if (const auto [end, error] = std::from_chars(token.data(), last, n);
+          end != last || error != std::errc{}) {
+        return false;
+      }
+      out.push_back({Instruction::UInt, n});
+    } else {
+      int64_t n = 0;
+      const char *const last = token.data() + token.size();
+      if (const auto [end, error] = std::from_chars(token.data(), last, n);
+          end != last || error != std::errc{}) {
+        return false;
+      }
+      out.push_back({Instruction::Int, static_cast<uint64_t>(n)});
+    }
+  }
+}
+
+} // namespace assembler_impl
+
+/** Parses `text`, nullopt if it is not in the syntax above. */
+inline std::optional<std::vector<instruction>> parse_assembly(std::string_view text) {
+  std::vector<instruction> instructions;
+  if (!assembler_impl::parse(text, 0, instructions)) {
+    return std::nullopt;
+  }
+  return instructions;
+}
+
+/**
+ * Decodes `bytecode` into instructions, within `nesting` blocks; nullopt if it is not well formed
+ * or nests deeper than `program` allows.
+ */
+inline std::optional<std::vector<instruction>> parse_bytecode(std::span<const uint8_t> bytecode,
+                                                              const size_t nesting = 0) {
+  using formatter_impl::read_sleb, formatter_impl::read_uleb;
+  std::vector<instruction> instructions;
+  while (!bytecode.empty()) {
+    instruction &i = instructions.emplace_back(static_cast<Instruction>(bytecode.front()));
+    bytecode = bytecode.subspan(1);
+    switch (i.code) {
+    case Instruction::begin:
+    case Instruction::String: {
+      const auto size = read_uleb(bytecode);
+      if (!size || *size > bytecode.size() ||
+          (i.code == Instruction::begin && nesting == interpreter::control_capacity)) {
+        return std::nullopt;
+      }
+      const auto operand = bytecode.first(*size);
+      bytecode = bytecode.subspan(*size);
+      if (i.code == Instruction::String) {
+        i.string.assign(operand.begin(), operand.end());
+      } else if (auto block = parse_bytecode(operand, nesting + 1)) {
+        i.block = std::move(*block);
+      } else {
+        return std::nullopt;
+      }
+      break;
+    }
+    case Instruction::UInt:
+    case Instruction::Int: {
+      const auto n = i.code == Instruction::UInt
+                         ? read_uleb(bytecode)
+                         : read_sleb(bytecode).transform(
+                               [](const int64_t n) { return static_cast<uint64_t>(n); });
+      if (!n) {
+        return std::nullopt;
+      }
+      i.literal = *n;
+      break;
+    }
+    case Instruction::Selector:
+      if (bytecode.empty() || !selector_arity(static_cast<Selector>(bytecode.front()))) {
+        return std::nullopt;
+      }
+      i.literal = bytecode.front();
+      bytecode = bytecode.subspan(1);
+      break;
+    case Instruction::dup:
+    case Instruction::drop:
+    case Instruction::pick:
+    case Instruction::over:
+    case Instruction::swap:
+    case Instruction::rot:
+    case Instruction::If:
+    case Instruction::IfElse:
+    case Instruction::Return:
+    case Instruction::ADD:
+    case Instruction::SUB:
+    case Instruction::MUL:
+    case Instruction::DIV:
+    case Instruction::SHL:
+    case Instruction::SHR:
+    case Instruction::NOT:
+    case Instruction::OR:
+    case Instruction::XOR:
+    case Instruction::EQ:
+    case Instruction::EQ2:
+    case Instruction::LT:
+    case Instruction::GT:
+    case Instruction::LE:
+    case Instruction::GE:
+    case Instruction::Call:
+      break;
+    default:
+      return std::nullopt;
+    }
+  }
+  return instructions;
+}
+
+/** Appends the bytecode of `instructions`. */
+inline void encode(const std::span<const instruction> instructions, std::vector<uint8_t> &bytes) {
+  for (const instruction &i : instructions) {
+    bytes.push_back(std::to_underlying(i.code));
+    if (i.code == Instruction::begin) {
+      std::vector<uint8_t> block;
+      encode(i.block, block);
+      append_uleb(bytes, block.size());
+      bytes.insert(bytes.end(), block.begin(), block.end());
+    } else if (i.code == Instruction::String) {
+      append_uleb(bytes, i.string.size());
+      bytes.insert(bytes.end(), i.string.begin(), i.string.end());
+    } else if (i.code == Instruction::UInt) {
+      append_uleb(bytes, i.literal);
+    } else if (i.code == Instruction::Int) {
+      append_sleb(bytes, static_cast<int64_t>(i.literal));
+    } else if (i.code == Instruction::Selector) {
+      bytes.push_back(static_cast<uint8_t>(i.literal));
+    }
+  }
+}
+
+/** The bytecode of `text`, nullopt if it is not in the syntax above. */
+inline std::optional<std::vector<uint8_t>> assemble(const std::string_view text) {
+  return parse_assembly(text).transform([](const std::vector<instruction> &instructions) {
+    std::vector<uint8_t> bytes;
+    encode(instructions, bytes);
+    return bytes;
+  });
+}
+
+/** `instructions` in the syntax above, a space between tokens. */
+inline std::string disassemble(const std::span<const instruction> instructions) {
+  std::string text;
+  for (const instruction &i : instructions) {
+    if (!text.empty()) {
+      text += ' ';
+    }
+    char number[24];
+    switch (i.code) {
+    case Instruction::begin:
+      text += '{';
+      if (!i.block.empty()) {
+        text += ' ';
+        text += disassemble(i.block);
+      }
+      text += " }";
+      break;
+    case Instruction::UInt:
+      text.append(number, std::to_chars(number, std::end(number), i.literal).ptr);
+      text += 'u';
+      break;
+    case Instruction::Int:
+      text.append(number,
+                  std::to_chars(number, std::end(number), static_cast<int64_t>(i.literal)).ptr);
+      break;
+    case Instruction::String:
+      text += '"';
+      for (const char c : i.string) {
+        if (c == '"' || c == '\\') {
+          text += '\\';
+          text += c;
+        } else if (c == '\n') {
+          text += "\\n";
+        } else if (c == '\t') {
+          text += "\\t";
+        } else if (static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x7F) {
+          std::snprintf(number, sizeof number, "\\x%02x", static_cast<unsigned char>(c));
+          text += number;
+        } else {
+          text += c;
+        }
+      }
+      text += '"';
+      break;
+    case Instruction::Selector:
+      text += '@';
+      text += std::ranges::find(assembler_impl::selector_names, static_cast<Selector>(i.literal),
+                                &std::pair<std::string_view, Selector>::second)
+                  ->first;
+      break;
+    default:
+      text += std::ranges::find(assembler_impl::mnemonics, i.code,
+                                &std::pair<std::string_view, Instruction>::second)
+                  ->first;
+    }
+  }
+  return text;
+}
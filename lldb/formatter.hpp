@@ -0,0 +1,1241 @@
+// https://lldb.llvm.org/resources/formatterbytecode.html#design-of-the-virtual-machine
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// All objects on the data stack must have one of the following data types. These data types are
+// "host" data types, in LLDB parlance.
+struct DataType {
+  // Object and Type are opaque, they can only be used as a parameters of `call`.
+  enum class tag {
+    String,   // UTF-8
+    Int,      // 64 bit
+    UInt,     // 64 bit
+    Object,   // Basically an SBValue
+    Type,     // Basically an SBType
+    Selector, // One of the predefine functions
+  } tag;
+};
+
+enum class Instruction : uint8_t {
+  // Stack operations
+
+  // `(x -> x x)`
+  dup = 0x00,
+  // `(x y -> x)`
+  drop = 0x01,
+  // `(x ... UInt -> x ... x)`
+  pick = 0x02,
+  // `(x y -> x y x)`
+  over = 0x03,
+  // `(x y -> y x)`
+  swap = 0x04,
+  // `(x y z -> z x y)`
+  rot = 0x05,
+
+  // Control flow
+
+  // `{`: push a code block address onto the control stack.
+  // `}`: (technically not an opcode) syntax for end of code block.
+  begin = 0x10,
+  // `if (UInt -> )`: pop a block from the control stack, if the top of the data stack is nonzero,
+  // execute it.
+  If = 0x11,
+  // `ifelse (UInt -> )`: pop two blocks from the control stack, if the top of the data stack is
+  // nonzero, execute the first, otherwise the second.
+  IfElse = 0x12,
+  // `return`: pop the entire control stack and return.
+  Return = 0x13,
+
+  // Literals for basic types
+
+  // `123u ( -> UInt)`: push an unsigned 64-bit host integer.
+  UInt = 0x20,
+  // `123 ( -> Int)`: push a signed 64-bit host integer.
+  Int = 0x21,
+  // `"abc" ( -> String)`: push a UTF-8 host string.
+  String = 0x22,
+  // `@strlen ( -> Selector)`: push one of the predefined function selectors. See call.
+  Selector = 0x23,
+
+  // Conversion operations
+
+  // Arithmetic, logic, and comparison operations
+
+  // `(x y -> x op y)` on 2 Ints or 2 UInts, `NOT` `(x -> ~x)`; comparisons push UInt 0 or 1,
+  // `EQ2` being `!=`.
+  ADD = 0x30,
+  SUB,
+  MUL,
+  DIV,
+  SHL,
+  SHR,
+  NOT,
+  OR,
+  XOR,
+  EQ,
+  EQ2,
+  LT,
+  GT,
+  LE,
+  GE,
+
+  // Function calls
+
+  // `call (Object argN ... arg0 Selector -> retval)`
+  Call = 0x60,
+};
+
+// The functions `call` selects, and their stack effects.
+enum class Selector : uint8_t {
+  summary = 0x00,                    // `(Object -> String)`
+  type_summary = 0x01,               // `(Object -> String)`
+  get_num_children = 0x10,           // `(Object -> UInt)`
+  get_child_at_index = 0x11,         // `(Object UInt -> Object)`
+  get_child_with_name = 0x12,        // `(Object String -> Object)`
+  get_child_index = 0x13,            // `(Object String -> UInt)`
+  get_type = 0x15,                   // `(Object -> Type)`
+  get_template_argument_type = 0x16, // `(Type UInt -> Type)`
+  cast = 0x17,                       // `(Object Type -> Object)`
+  get_synthetic_value = 0x20,        // `(Object -> Object)`
+  get_non_synthetic_value = 0x21,    // `(Object -> Object)`
+  get_value = 0x22,                  // `(Object -> Object)`
+  get_value_as_unsigned = 0x23,      // `(Object -> UInt)`
+  get_value_as_signed = 0x24,        // `(Object -> Int)`
+  get_value_as_address = 0x25,       // `(Object -> UInt)`
+  read_memory_byte = 0x40,           // `(UInt -> UInt)`
+  read_memory_uint32 = 0x41,         // `(UInt -> UInt)`
+  read_memory_int32 = 0x42,          // `(UInt -> Int)`
+  read_memory_unsigned = 0x43,       // `(UInt UInt -> UInt)`, the address then the size
+  read_memory_signed = 0x44,         // `(UInt UInt -> Int)`
+  read_memory_address = 0x45,        // `(UInt -> UInt)`
+  // `(arg1 ... argN String -> String)`: the format String, with a `%d`, `%u`, `%x` or `%s` per
+  // argument in turn, `%%` for `%`.
+  sprintf = 0x51,
+  strlen = 0x52, // `(String -> UInt)`
+};
+
+/** The operands a selector takes below it, the format of `sprintf` only; 0 for none such. */
+constexpr int selector_arity(const Selector selector) noexcept {
+  switch (selector) {
+  case Selector::summary:
+  case Selector::type_summary:
+  case Selector::get_num_children:
+  case Selector::get_type:
+  case Selector::get_synthetic_value:
+  case Selector::get_non_synthetic_value:
+  case Selector::get_value:
+  case Selector::get_value_as_unsigned:
+  case Selector::get_value_as_signed:
+  case Selector::get_value_as_address:
+  case Selector::read_memory_byte:
+  case Selector::read_memory_uint32:
+  case Selector::read_memory_int32:
+  case Selector::read_memory_address:
+  case Selector::sprintf:
+  case Selector::strlen:
+    return 1;
+  case Selector::get_child_at_index:
+  case Selector::get_child_with_name:
+  case Selector::get_child_index:
+  case Selector::get_template_argument_type:
+  case Selector::cast:
+  case Selector::read_memory_unsigned:
+  case Selector::read_memory_signed:
+    return 2;
+  }
+  return 0;
+}
+
+/** Appends `n` in unsigned LEB128, as literals and block lengths are encoded. */
+constexpr void append_uleb(std::vector<uint8_t> &bytes, uint64_t n) {
+  do {
+    bytes.push_back((n & 0x7F) | (n > 0x7F ? 0x80 : 0));
+    n >>= 7;
+  } while (n);
+}
+
+/** Appends `n` in signed LEB128. */
+constexpr void append_sleb(std::vector<uint8_t> &bytes, int64_t n) {
+  for (bool more = true; more;) {
+    const uint8_t low = n & 0x7F;
+    n >>= 7;
+    more = !((n == 0 && !(low & 0x40)) || (n == -1 && (low & 0x40)));
+    bytes.push_back(low | (more ? 0x80 : 0));
+  }
+}
+
+/**
+ * Memory handed out in order and taken back all at once, for the strings of a run. Its blocks are
+ * kept from one `reset` to the next: once they are enough, it allocates nothing.
+ */
+class arena {
+  struct block {
+    std::unique_ptr<char[]> bytes;
+    size_t size;
+  };
+  std::vector<block> blocks;
+  size_t current = 0, used = 0; // The block handing out memory, and how much of it is gone.
+
+public:
+  static constexpr size_t block_size = 4096;
+
+  /** `size` bytes, valid until `reset`. */
+  char *allocate(const size_t size) {
+    while (current < blocks.size() && blocks[current].size - used < size) {
+      ++current;
+      used = 0;
+    }
+    if (current == blocks.size()) {
+      const size_t block_bytes = std::max(size, block_size);
+      blocks.push_back({std::make_unique_for_overwrite<char[]>(block_bytes), block_bytes});
+    }
+    char *const bytes = blocks[current].bytes.get() + used;
+    used += size;
+    return bytes;
+  }
+
+  void reset() noexcept {
+    current = 0;
+    used = 0;
+  }
+};
+
+/**
+ * A value on the data stack, in 16 bytes: its type, and an Int, UInt or Selector, an Object or
+ * Type by a handle the host gives meaning, or a String. Strings of up to `inline_capacity` bytes
+ * are held inline; longer ones refer to bytes held elsewhere, by an arena or a program, that must
+ * outlive them. Copies are shallow.
+ */
+struct value : DataType {
+  static constexpr size_t inline_capacity = 8;
+
+  uint32_t length = 0; // Of a String.
+  union {
+    uint64_t bits = 0;
+    const char *chars; // Of a String longer than `inline_capacity`.
+    char inline_chars[inline_capacity];
+  };
+
+  static value from_uint(const uint64_t n) { return {{DataType::tag::UInt}, 0, {n}}; }
+  static value from_int(const int64_t n) {
+    return {{DataType::tag::Int}, 0, {static_cast<uint64_t>(n)}};
+  }
+  static value from_selector(const Selector selector) {
+    return {{DataType::tag::Selector}, 0, {std::to_underlying(selector)}};
+  }
+  static value object(const uint64_t handle) { return {{DataType::tag::Object}, 0, {handle}}; }
+  static value type(const uint64_t handle) { return {{DataType::tag::Type}, 0, {handle}}; }
+  /** A String of `text`, which must outlive it if longer than `inline_capacity`. */
+  static value view(const std::string_view text) {
+    assert(text.size() <= UINT32_MAX);
+    value v{{DataType::tag::String}, static_cast<uint32_t>(text.size()), {}};
+    if (text.size() <= inline_capacity) {
+      std::memcpy(v.inline_chars, text.data(), text.size());
+    } else {
+      v.chars = text.data();
+    }
+    return v;
+  }
+  /** A String of a copy of `text`, held by `strings` if longer than `inline_capacity`. */
+  static value from_string(const std::string_view text, arena &strings) {
+    if (text.size() <= inline_capacity) {
+      return view(text);
+    }
+    char *const chars = strings.allocate(text.size());
+    std::ranges::copy(text, chars);
+    return view({chars, text.size()});
+  }
+
+  [[nodiscard]] int64_t as_int() const noexcept { return static_cast<int64_t>(bits); }
+  /** The bytes of a String. */
+  [[nodiscard]] std::string_view string() const noexcept {
+    return {length <= inline_capacity ? inline_chars : chars, length};
+  }
+
+  bool operator==(const value &other) const noexcept {
+    return tag == other.tag &&
+           (tag == DataType::tag::String ? string() == other.string() : bits == other.bits);
+  }
+};
+static_assert(sizeof(value) == 16 && std::is_trivially_copyable_v<value>);
+
+/** What a debugger provides: the selectors on Objects, Types and memory. */
+class formatter_host {
+public:
+  virtual ~formatter_host() = default;
+  /**
+   * `selector` on `args`, deepest first, as many as `selector_arity` says; nullopt if it fails.
+   * Strings it returns are held by `strings`, or by the host for as long as the result is used.
+   */
+  virtual std::optional<value> call(Selector selector, std::span<const value> args,
+                                    arena &strings) = 0;
+};
+
+enum class vm_error : uint8_t {
+  stack_underflow,
+  stack_overflow,
+  type_mismatch,
+  division_by_zero,
+  shift_out_of_range,
+  bad_selector,
+  call_failed,
+};
+inline constexpr std::array<std::string_view, 7> vm_error_names{
+    "stack_underflow", "stack_overflow", "type_mismatch", "division_by_zero",
+    "shift_out_of_range", "bad_selector", "call_failed"};
+
+namespace formatter_impl {
+
+/**
+ * The capacity of the interpreter's control stack, which is also as deep as blocks may nest:
+ * bytecode comes from the program being debugged, and decoding it must not recurse without end.
+ */
+inline constexpr size_t control_capacity = 64;
+
+/** Reads an unsigned LEB128 number off the front of `bytes`; nullopt if cut short. */
+constexpr std::optional<uint64_t> read_uleb(std::span<const uint8_t> &bytes) noexcept {
+  uint64_t n = 0;
+  for (int shift = 0; shift < 64 && !bytes.empty(); shift += 7) {
+    const uint8_t byte = bytes.front();
+    bytes = bytes.subspan(1);
+    n |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return n;
+    }
+  }
+  return std::nullopt;
+}
+
+/** Reads a signed LEB128 number off the front of `bytes`. */
+constexpr std::optional<int64_t> read_sleb(std::span<const uint8_t> &bytes) noexcept {
+  uint64_t n = 0;
+  for (int shift = 0; shift < 64 && !bytes.empty(); shift += 7) {
+    const uint8_t byte = bytes.front();
+    bytes = bytes.subspan(1);
+    n |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      if (shift + 7 < 64 && (byte & 0x40)) {
+        n |= ~uint64_t{0} << (shift + 7);
+      }
+      return static_cast<int64_t>(n);
+    }
+  }
+  return std::nullopt;
+}
+
+/** How many arguments the `sprintf` format `format` takes. */
+constexpr size_t conversions(const std::string_view format) noexcept {
+  size_t n = 0;
+  for (size_t i = 0; i + 1 < format.size(); ++i) {
+    if (format[i] == '%') {
+      n += format[++i] != '%';
+    }
+  }
+  return n;
+}
+
+/** Decoded instructions, numbered densely for dispatch, and those of the decoder's own. */
+enum class opcode : uint8_t {
+  // `a` the data stack depth the basic block it starts needs, `b` how much deeper it may go.
+  check,
+  dup,
+  drop,
+  pick,
+  over,
+  swap,
+  rot,
+  begin, // `a` the index of the block's first instruction, `b` of the one after its end.
+  end,   // Of a block, back to where `if` or `ifelse` left.
+  if_,
+  ifelse,
+  ret,
+  push_uint, // `b` the literal.
+  push_int,
+  push_selector,
+  push_string, // `a` the index of the literal in the program's strings.
+  add,
+  sub,
+  mul,
+  div,
+  shl,
+  shr,
+  bit_not,
+  bit_or,
+  bit_xor,
+  eq,
+  ne,
+  lt,
+  gt,
+  le,
+  ge,
+  call,
+
+  // Superinstructions, each for a sequence of the above.
+  call_selector, // A selector then `call`: `a` the operands, `b` the selector.
+  call_sprintf,  // A format, `@sprintf` then `call`: `a` the format, `b` its arguments.
+  add_lit,       // A literal then `ADD`: `a` the type of the literal, `b` the literal.
+  sub_lit,
+  eq_lit,
+  ne_lit,
+  lt_lit,
+  gt_lit,
+  nip, // `swap drop`.
+};
+
+struct op {
+  opcode code;
+  uint32_t a = 0;
+  uint64_t b = 0;
+};
+static_assert(sizeof(op) == 16);
+
+} // namespace formatter_impl
+
+/**
+ * Bytecode decoded once for the interpreter to run many times: literals decoded, blocks resolved
+ * to the indices of their instructions, and common sequences fused into superinstructions unless
+ * told otherwise.
+ *
+ * The stack effects of the program are then verified: given the stack depth on entry, that of every
+ * instruction is known to within bounds, whichever blocks run. That holds if every `call` has its
+ * selector, and the format of `sprintf`, as literals right before it, and blocks only pop the
+ * blocks they push. A verified program needs the data stack checked once, on entry; any other has
+ * each basic block, a run of instructions without control flow, preceded by a check of its own.
+ */
+class program {
+  std::vector<formatter_impl::op> ops;
+  std::vector<std::string> strings;
+  bool superinstructions = true, checks = false;
+  bool is_verified = false;
+  uint32_t need = 0, grow = 0; // Of the data stack, if verified: on entry, and beyond that.
+
+  friend class interpreter;
+
+  /**
+   * Decodes `bytes` as a block, ended by `last`, within `nesting` others; false if not well
+   * formed or nested too deep.
+   */
+  bool decode(std::span<const uint8_t> bytes, const formatter_impl::opcode last,
+              const size_t nesting = 0) {
+    using formatter_impl::opcode;
+    size_t check = 0;
+    int depth = 0, need = 0, grow = 0;
+    const auto close = [&] {
+      if (checks) {
+        ops[check].a = need;
+        ops[check].b = grow;
+      }
+    };
+    const auto open = [&] {
+      if (checks) {
+        check = ops.size();
+        ops.push_back({opcode::check});
+      }
+      depth = need = grow = 0;
+    };
+    // Replaces the last instructions, a sequence of the same basic block, with one that does the
+    // same: none of them is the target of a jump, which only ever follows a `begin`, `if` or
+    // `ifelse`.
+    const auto fuse = [this] {
+      const size_t n = ops.size();
+      formatter_impl::op &last = ops[n - 1], &before = ops[n - 2];
+      const auto with_literal = [](const opcode c) -> std::optional<opcode> {
+        switch (c) {
+        case opcode::add:
+          return opcode::add_lit;
+        case opcode::sub:
+          return opcode::sub_lit;
+        case opcode::eq:
+          return opcode::eq_lit;
+        case opcode::ne:
+          return opcode::ne_lit;
+        case opcode::lt:
+          return opcode::lt_lit;
+        case opcode::gt:
+          return opcode::gt_lit;
+        default:
+          return std::nullopt;
+        }
+      };
+      if (const auto fused = with_literal(last.code);
+          fused && (before.code == opcode::push_uint || before.code == opcode::push_int)) {
+        const auto tag =
+            before.code == opcode::push_uint ? DataType::tag::UInt : DataType::tag::Int;
+        before = {*fused, static_cast<uint32_t>(tag), before.b};
+        ops.pop_back();
+      } else if (last.code == opcode::call && before.code == opcode::push_selector) {
+        const auto selector = static_cast<Selector>(before.b);
+        if (selector != Selector::sprintf) {
+          before = {opcode::call_selector, static_cast<uint32_t>(selector_arity(selector)),
+                    before.b};
+          ops.pop_back();
+        } else if (n >= 3 && ops[n - 3].code == opcode::push_string) {
+          const uint32_t format = ops[n - 3].a;
+          ops[n - 3] = {opcode::call_sprintf, format,
+                        formatter_impl::conversions(strings[format])};
+          ops.resize(n - 2);
+        }
+      } else if (last.code == opcode::drop && before.code == opcode::swap) {
+        before = {opcode::nip};
+        ops.pop_back();
+      }
+    };
+    const auto emit = [&](const opcode c, const int pops, const int pushes, const uint64_t b = 0) {
+      ops.push_back({c, 0, b});
+      need = std::max(need, pops - depth);
+      depth += pushes - pops;
+      grow = std::max(grow, depth);
+      if (superinstructions && ops.size() >= 2) {
+        fuse();
+      }
+    };
+    using formatter_impl::read_sleb, formatter_impl::read_uleb;
+
+    open();
+    while (!bytes.empty()) {
+      const auto instruction = static_cast<Instruction>(bytes.front());
+      bytes = bytes.subspan(1);
+      switch (instruction) {
+      case Instruction::dup:
+        emit(opcode::dup, 1, 2);
+        break;
+      case Instruction::drop:
+        emit(opcode::drop, 1, 0);
+        break;
+      case Instruction::pick: // Checks how deep it picks itself.
+        emit(opcode::pick, 1, 1);
+        break;
+      case Instruction::over:
+        emit(opcode::over, 2, 3);
+        break;
+      case Instruction::swap:
+        emit(opcode::swap, 2, 2);
+        break;
+      case Instruction::rot:
+        emit(opcode::rot, 3, 3);
+        break;
+      case Instruction::begin: {
+        const auto size = read_uleb(bytes);
+        if (!size || *size > bytes.size() || nesting == formatter_impl::control_capacity) {
+          return false;
+        }
+        const size_t at = ops.size();
+        ops.push_back({opcode::begin, static_cast<uint32_t>(at + 1)});
+        if (!decode(bytes.first(*size), opcode::end, nesting + 1)) {
+          return false;
+        }
+        ops[at].b = ops.size();
+        bytes = bytes.subspan(*size);
+        break;
+      }
+      case Instruction::If:
+      case Instruction::IfElse:
+      case Instruction::Return:
+        // The stack is then as a block or nothing left it.
+        emit(instruction == Instruction::If       ? opcode::if_
+             : instruction == Instruction::IfElse ? opcode::ifelse
+                                                  : opcode::ret,
+             instruction != Instruction::Return, 0);
+        close();
+        open();
+        break;
+      case Instruction::UInt:
+        if (const auto n = read_uleb(bytes)) {
+          emit(opcode::push_uint, 0, 1, *n);
+          break;
+        }
+        return false;
+      case Instruction::Int:
+        if (const auto n = read_sleb(bytes)) {
+          emit(opcode::push_int, 0, 1, static_cast<uint64_t>(*n));
+          break;
+        }
+        return false;
+      case Instruction::String: {
+        const auto size = read_uleb(bytes);
+        if (!size || *size > bytes.size()) {
+          return false;
+        }
+        strings.emplace_back(reinterpret_cast<const char *>(bytes.data()), *size);
+        bytes = bytes.subspan(*size);
+        emit(opcode::push_string, 0, 1);
+        ops.back().a = strings.size() - 1;
+        break;
+      }
+      case Instruction::Selector:
+        if (bytes.empty() || !selector_arity(static_cast<Selector>(bytes.front()))) {
+          return false;
+        }
+        emit(opcode::push_selector, 0, 1, bytes.front());
+        bytes = bytes.subspan(1);
+        break;
+      case Instruction::NOT:
+        emit(opcode::bit_not, 1, 1);
+        break;
+      case Instruction::ADD:
+      case Instruction::SUB:
+      case Instruction::MUL:
+      case Instruction::DIV:
+      case Instruction::SHL:
+      case Instruction::SHR:
+      case Instruction::OR:
+      case Instruction::XOR:
+      case Instruction::EQ:
+      case Instruction::EQ2:
+      case Instruction::LT:
+      case Instruction::GT:
+      case Instruction::LE:
+      case Instruction::GE:
+        emit(static_cast<opcode>(std::to_underlying(opcode::add) + std::to_underlying(instruction) -
+                                 std::to_underlying(Instruction::ADD)),
+             2, 1);
+        break;
+      case Instruction::Call: // Takes as many operands as the selector says, checked then.
+        emit(opcode::call, 1, 0);
+        close();
+        open();
+        break;
+      default:
+        return false;
+      }
+    }
+    ops.push_back({last});
+    close();
+    return true;
+  }
+
+  /**
+   * Follows the block from `i` to its end, the data stack from `lo` to `hi` deep relative to the
+   * entry of the program, raising `need` and `grow` to what it takes. Sets `exit` to the depths
+   * it leaves the stack at, or nullopt if it returns; false if these are not known. It recurses
+   * only into blocks nested in this one, so no deeper than `decode` allows.
+   */
+  bool walk(size_t i, int lo, int hi, std::optional<std::pair<int, int>> &exit, int &need,
+            int &grow) const {
+    using formatter_impl::opcode;
+    std::vector<uint32_t> blocks; // Pushed in this block, to be popped in it.
+    const auto apply = [&](const int pops, const int pushes) {
+      need = std::max(need, pops - lo);
+      lo += pushes - pops;
+      hi += pushes - pops;
+      grow = std::max(grow, hi);
+    };
+    // What follows a block, run or not: false if unknown.
+    const auto run = [&](const uint32_t block, std::optional<std::pair<int, int>> &after) {
+      return walk(block, lo, hi, after, need, grow);
+    };
+    for (;; ++i) {
+      const formatter_impl::op &o = ops[i];
+      switch (o.code) {
+      case opcode::check:
+        break;
+      case opcode::dup:
+        apply(1, 2);
+        break;
+      case opcode::drop:
+        apply(1, 0);
+        break;
+      case opcode::pick: // Checks how deep it picks itself.
+      case opcode::bit_not:
+      case opcode::add_lit:
+      case opcode::sub_lit:
+      case opcode::eq_lit:
+      case opcode::ne_lit:
+      case opcode::lt_lit:
+      case opcode::gt_lit:
+        apply(1, 1);
+        break;
+      case opcode::over:
+        apply(2, 3);
+        break;
+      case opcode::swap:
+        apply(2, 2);
+        break;
+      case opcode::rot:
+        apply(3, 3);
+        break;
+      case opcode::nip:
+        apply(2, 1);
+        break;
+      case opcode::push_uint:
+      case opcode::push_int:
+      case opcode::push_selector:
+      case opcode::push_string:
+        apply(0, 1);
+        break;
+      case opcode::add:
+      case opcode::sub:
+      case opcode::mul:
+      case opcode::div:
+      case opcode::shl:
+      case opcode::shr:
+      case opcode::bit_or:
+      case opcode::bit_xor:
+      case opcode::eq:
+      case opcode::ne:
+      case opcode::lt:
+      case opcode::gt:
+      case opcode::le:
+      case opcode::ge:
+        apply(2, 1);
+        break;
+      case opcode::begin:
+        blocks.push_back(o.a);
+        i = o.b - 1;
+        break;
+      case opcode::if_: {
+        apply(1, 0);
+        if (blocks.empty()) {
+          return false;
+        }
+        std::optional<std::pair<int, int>> taken;
+        if (!run(blocks.back(), taken)) {
+          return false;
+        }
+        blocks.pop_back();
+        if (taken) {
+          lo = std::min(lo, taken->first);
+          hi = std::max(hi, taken->second);
+        }
+        break;
+      }
+      case opcode::ifelse: {
+        apply(1, 0);
+        if (blocks.size() < 2) {
+          return false;
+        }
+        std::optional<std::pair<int, int>> then, otherwise;
+        if (!run(blocks.end()[-2], then) || !run(blocks.back(), otherwise)) {
+          return false;
+        }
+        blocks.resize(blocks.size() - 2);
+        if (!then && !otherwise) {
+          exit.reset();
+          return true;
+        }
+        lo = std::min(then.value_or(*otherwise).first, otherwise.value_or(*then).first);
+        hi = std::max(then.value_or(*otherwise).second, otherwise.value_or(*then).second);
+        break;
+      }
+      case opcode::ret:
+        need = std::max(need, 1 - lo); // For the result.
+        exit.reset();
+        return true;
+      case opcode::end:
+        exit.emplace(lo, hi);
+        return blocks.empty();
+      case opcode::call: {
+        // The selector right before, and the format of `sprintf` right before that.
+        if (i == 0 || ops[i - 1].code != opcode::push_selector) {
+          return false;
+        }
+        const auto selector = static_cast<Selector>(ops[i - 1].b);
+        int arity = selector_arity(selector);
+        if (selector == Selector::sprintf) {
+          if (i == 1 || ops[i - 2].code != opcode::push_string) {
+            return false;
+          }
+          arity += formatter_impl::conversions(strings[ops[i - 2].a]);
+        }
+        apply(arity + 1, 1);
+        break;
+      }
+      case opcode::call_selector:
+        apply(o.a, 1);
+        break;
+      case opcode::call_sprintf:
+        apply(o.b, 1);
+        break;
+      }
+    }
+  }
+
+public:
+  /**
+   * Decodes `bytecode`, with superinstructions unless told otherwise; nullopt if it is not well
+   * formed.
+   */
+  static std::optional<program> load(const std::span<const uint8_t> bytecode,
+                                     const bool superinstructions = true) {
+    program p;
+    p.superinstructions = superinstructions;
+    if (!p.decode(bytecode, formatter_impl::opcode::ret)) {
+      return std::nullopt;
+    }
+    std::optional<std::pair<int, int>> exit;
+    int need = 0, grow = 0;
+    if (p.walk(0, 0, 0, exit, need, grow)) {
+      p.is_verified = true;
+      p.need = need;
+      p.grow = grow;
+      return p;
+    }
+    program checked;
+    checked.superinstructions = superinstructions;
+    checked.checks = true;
+    checked.decode(bytecode, formatter_impl::opcode::ret);
+    return checked;
+  }
+
+  /** The instructions decoded, checks included. */
+  [[nodiscard]] size_t size() const noexcept { return ops.size(); }
+  /** Whether the stack effects are known, and the data stack needs checking on entry only. */
+  [[nodiscard]] bool verified() const noexcept { return is_verified; }
+  /** If verified, the depth of the data stack the program needs on entry. */
+  [[nodiscard]] size_t arguments_needed() const noexcept { return need; }
+};
+
+/**
+ * Runs programs with threaded dispatch: each instruction jumps straight to the next one's code,
+ * through a table of label addresses, rather than back to a `switch`. The stacks are arrays of
+ * fixed capacity, reused from run to run; the data stack is checked once per basic block, not
+ * per instruction, or once per run for a verified program. The strings a run makes are held by an
+ * arena, reused likewise, so that a run allocates no memory once the arena has grown enough.
+ */
+class interpreter {
+public:
+  static constexpr size_t data_capacity = 256, control_capacity = formatter_impl::control_capacity;
+
+private:
+  std::array<value, data_capacity> data;
+  std::array<uint32_t, control_capacity> control;
+  uint64_t executed = 0;
+
+  arena strings; // Of the strings a run makes, taken back at the start of the next.
+
+  /**
+   * Calls `out` on each piece of `format` formatted with `args`, the first deepest, as `sprintf`
+   * does; false if an argument does not match its conversion.
+   */
+  template <class Out>
+  static bool format(const std::string_view format, const std::span<const value> args, Out &&out) {
+    size_t next = 0, start = 0; // Of the arguments, and of the text up to the next conversion.
+    for (size_t i = 0; i + 1 < format.size(); ++i) {
+      if (format[i] != '%') {
+        continue;
+      }
+      out(format.substr(start, i - start));
+      const char conversion = format[++i];
+      start = i + 1;
+      if (conversion == '%') {
+        out("%");
+        continue;
+      }
+      const value &arg = args[next++];
+      char digits[24];
+      if (conversion == 's' && arg.tag == DataType::tag::String) {
+        out(arg.string());
+      } else if (conversion == 'd' && arg.tag == DataType::tag::Int) {
+        out({digits, std::to_chars(digits, std::end(digits), arg.as_int()).ptr});
+      } else if ((conversion == 'u' || conversion == 'x') && arg.tag == DataType::tag::UInt) {
+        out({digits,
+             std::to_chars(digits, std::end(digits), arg.bits, conversion == 'u' ? 10 : 16).ptr});
+      } else {
+        return false;
+      }
+    }
+    out(format.substr(start));
+    return true;
+  }
+
+  /** `format` formatted with `args`, measured first to be written once, where it is held. */
+  std::optional<value> formatted(const std::string_view format,
+                                 const std::span<const value> args) {
+    size_t size = 0;
+    if (!interpreter::format(format, args,
+                             [&size](const std::string_view piece) { size += piece.size(); })) {
+      return std::nullopt;
+    }
+    char inline_chars[value::inline_capacity];
+    char *const chars = size <= value::inline_capacity ? inline_chars : strings.allocate(size);
+    char *out = chars;
+    interpreter::format(format, args, [&out](const std::string_view piece) {
+      out = std::ranges::copy(piece, out).out;
+    });
+    return value::view({chars, size});
+  }
+
+  template <bool counting>
+  std::expected<value, vm_error> execute(const program &p, formatter_host &host,
+                                         const std::span<const value> arguments) {
+    using formatter_impl::opcode;
+    constexpr auto Int = DataType::tag::Int, UInt = DataType::tag::UInt;
+    constexpr auto String = DataType::tag::String;
+    if (arguments.size() < p.need) {
+      return std::unexpected(vm_error::stack_underflow);
+    }
+    if (p.grow > data_capacity || arguments.size() > data_capacity - p.grow) {
+      return std::unexpected(vm_error::stack_overflow);
+    }
+    value *const base = data.data();
+    value *sp = std::ranges::copy(arguments, base).out; // One past the top.
+    uint32_t *const control_base = control.data();
+    uint32_t *cp = control_base;
+    const formatter_impl::op *const first = p.ops.data();
+    const formatter_impl::op *pc = first;
+    executed = 0;
+    strings.reset();
+    vm_error error;
+
+    // In the order of `formatter_impl::opcode`.
+    static void *const labels[]{
+        &&check,    &&dup,      &&drop,      &&pick,        &&over,     &&swap,      &&rot,
+        &&begin,    &&end,      &&if_,       &&ifelse,      &&ret,      &&push_uint, &&push_int,
+        &&push_selector,        &&push_string,              &&add,      &&sub,       &&mul,
+        &&div,      &&shl,      &&shr,       &&bit_not,     &&bit_or,   &&bit_xor,   &&eq,
+        &&ne,       &&lt,       &&gt,        &&le,          &&ge,       &&call,
+        &&call_selector,        &&call_sprintf,             &&add_lit,  &&sub_lit,   &&eq_lit,
+        &&ne_lit,   &&lt_lit,   &&gt_lit,    &&nip};
+    static_assert(std::size(labels) == std::to_underlying(opcode::nip) + 1);
+#define DISPATCH()                                                                                 \
+  do {                                                                                             \
+    if constexpr (counting) {                                                                      \
+      ++executed;                                                                                  \
+    }                                                                                              \
+    goto *labels[std::to_underlying(pc->code)];                                                    \
+  } while (false)
+#define NEXT()                                                                                     \
+  do {                                                                                             \
+    ++pc;                                                                                          \
+    DISPATCH();                                                                                    \
+  } while (false)
+#define FAIL(e)                                                                                    \
+  do {                                                                                             \
+    error = vm_error::e;                                                                           \
+    goto failed;                                                                                   \
+  } while (false)
+#define INTEGERS(x, y)                                                                             \
+  if ((x).tag != (y).tag || ((x).tag != Int && (x).tag != UInt)) {                                 \
+    FAIL(type_mismatch);                                                                           \
+  }
+#define LITERAL(x)                                                                                 \
+  if (static_cast<uint32_t>((x).tag) != pc->a) {                                                  \
+    FAIL(type_mismatch);                                                                           \
+  }
+
+    DISPATCH();
+  check: {
+    if constexpr (counting) {
+      --executed; // Not an instruction of the program's.
+    }
+    const size_t size = sp - base;
+    if (size < pc->a) {
+      FAIL(stack_underflow);
+    }
+    if (pc->b > data_capacity - size) {
+      FAIL(stack_overflow);
+    }
+    NEXT();
+  }
+  dup:
+    sp[0] = sp[-1];
+    ++sp;
+    NEXT();
+  drop:
+    --sp;
+    NEXT();
+  pick: {
+    if (sp[-1].tag != UInt) {
+      FAIL(type_mismatch);
+    }
+    if (sp[-1].bits >= static_cast<uint64_t>(sp - base - 1)) {
+      FAIL(stack_underflow);
+    }
+    sp[-1] = sp[-2 - static_cast<ptrdiff_t>(sp[-1].bits)];
+    NEXT();
+  }
+  over:
+    sp[0] = sp[-2];
+    ++sp;
+    NEXT();
+  swap:
+    std::swap(sp[-2], sp[-1]);
+    NEXT();
+  rot:
+    std::rotate(sp - 3, sp - 1, sp);
+    NEXT();
+  nip:
+    std::swap(sp[-2], sp[-1]);
+    --sp;
+    NEXT();
+  begin:
+    if (cp == control_base + control_capacity) {
+      FAIL(stack_overflow);
+    }
+    *cp++ = pc->a;
+    pc = first + pc->b;
+    DISPATCH();
+  end:
+    if (cp == control_base) {
+      FAIL(stack_underflow);
+    }
+    pc = first + *--cp;
+    DISPATCH();
+  if_: {
+    if (cp == control_base) {
+      FAIL(stack_underflow);
+    }
+    const value &condition = *--sp;
+    if (condition.tag != UInt && condition.tag != Int) {
+      FAIL(type_mismatch);
+    }
+    const uint32_t block = *--cp;
+    if (!condition.bits) {
+      NEXT();
+    }
+    *cp++ = pc + 1 - first;
+    pc = first + block;
+    DISPATCH();
+  }
+  ifelse: {
+    if (cp - control_base < 2) {
+      FAIL(stack_underflow);
+    }
+    const value &condition = *--sp;
+    if (condition.tag != UInt && condition.tag != Int) {
+      FAIL(type_mismatch);
+    }
+    cp -= 2;
+    const uint32_t block = cp[condition.bits ? 0 : 1];
+    *cp++ = pc + 1 - first;
+    pc = first + block;
+    DISPATCH();
+  }
+  push_uint:
+    sp->tag = UInt;
+    sp->bits = pc->b;
+    ++sp;
+    NEXT();
+  push_int:
+    sp->tag = Int;
+    sp->bits = pc->b;
+    ++sp;
+    NEXT();
+  push_selector:
+    sp->tag = DataType::tag::Selector;
+    sp->bits = pc->b;
+    ++sp;
+    NEXT();
+  push_string:
+    *sp++ = value::view(p.strings[pc->a]);
+    NEXT();
+  add:
+    INTEGERS(sp[-2], sp[-1]);
+    sp[-2].bits += sp[-1].bits;
+    --sp;
+    NEXT();
+  sub:
+    INTEGERS(sp[-2], sp[-1]);
+    sp[-2].bits -= sp[-1].bits;
+    --sp;
+    NEXT();
+  mul:
+    INTEGERS(sp[-2], sp[-1]);
+    sp[-2].bits *= sp[-1].bits;
+    --sp;
+    NEXT();
+  div:
+    INTEGERS(sp[-2], sp[-1]);
+    if (sp[-1].bits == 0) {
+      FAIL(division_by_zero);
+    }
+    if (sp[-1].tag == UInt) {
+      sp[-2].bits /= sp[-1].bits;
+    } else if (sp[-1].as_int() == -1) { // INT64_MIN / -1 wraps, as the other operations do.
+      sp[-2].bits = -sp[-2].bits;
+    } else {
+      sp[-2].bits = static_cast<uint64_t>(sp[-2].as_int() / sp[-1].as_int());
+    }
+    --sp;
+    NEXT();
+  shl:
+    INTEGERS(sp[-2], sp[-1]);
+    if (sp[-1].bits >= 64) {
+      FAIL(shift_out_of_range);
+    }
+    sp[-2].bits <<= sp[-1].bits;
+    --sp;
+    NEXT();
+  shr:
+    INTEGERS(sp[-2], sp[-1]);
+    if (sp[-1].bits >= 64) {
+      FAIL(shift_out_of_range);
+    }
+    sp[-2].bits = sp[-2].tag == UInt ? sp[-2].bits >> sp[-1].bits
+                                     : static_cast<uint64_t>(sp[-2].as_int() >> sp[-1].bits);
+    --sp;
+    NEXT();
+  bit_not:
+    if (sp[-1].tag != Int && sp[-1].tag != UInt) {
+      FAIL(type_mismatch);
+    }
+    sp[-1].bits = ~sp[-1].bits;
+    NEXT();
+  bit_or:
+    INTEGERS(sp[-2], sp[-1]);
+    sp[-2].bits |= sp[-1].bits;
+    --sp;
+    NEXT();
+  bit_xor:
+    INTEGERS(sp[-2], sp[-1]);
+    sp[-2].bits ^= sp[-1].bits;
+    --sp;
+    NEXT();
+#define COMPARE(name, op)                                                                          \
+  name:                                                                                            \
+    INTEGERS(sp[-2], sp[-1]);                                                                      \
+    sp[-2].bits = sp[-2].tag == UInt ? sp[-2].bits op sp[-1].bits                                  \
+                                     : sp[-2].as_int() op sp[-1].as_int();                         \
+    sp[-2].tag = UInt;                                                                             \
+    --sp;                                                                                          \
+    NEXT();
+    COMPARE(eq, ==)
+    COMPARE(ne, !=)
+    COMPARE(lt, <)
+    COMPARE(gt, >)
+    COMPARE(le, <=)
+    COMPARE(ge, >=)
+#undef COMPARE
+  add_lit:
+    LITERAL(sp[-1]);
+    sp[-1].bits += pc->b;
+    NEXT();
+  sub_lit:
+    LITERAL(sp[-1]);
+    sp[-1].bits -= pc->b;
+    NEXT();
+#define COMPARE_LITERAL(name, op)                                                                  \
+  name:                                                                                            \
+    LITERAL(sp[-1]);                                                                               \
+    sp[-1].bits = sp[-1].tag == UInt ? sp[-1].bits op pc->b                                        \
+                                     : sp[-1].as_int() op static_cast<int64_t>(pc->b);             \
+    sp[-1].tag = UInt;                                                                             \
+    NEXT();
+    COMPARE_LITERAL(eq_lit, ==)
+    COMPARE_LITERAL(ne_lit, !=)
+    COMPARE_LITERAL(lt_lit, <)
+    COMPARE_LITERAL(gt_lit, >)
+#undef COMPARE_LITERAL
+  call: {
+    const value &selector_value = *--sp;
+    if (selector_value.tag != DataType::tag::Selector) {
+      FAIL(type_mismatch);
+    }
+    const auto selector = static_cast<Selector>(selector_value.bits);
+    const size_t arity = selector_arity(selector);
+    if (!arity) {
+      FAIL(bad_selector);
+    }
+    if (static_cast<size_t>(sp - base) < arity) {
+      FAIL(stack_underflow);
+    }
+    if (selector == Selector::sprintf) {
+      if (sp[-1].tag != String) {
+        FAIL(type_mismatch);
+      }
+      const size_t count = formatter_impl::conversions(sp[-1].string());
+      if (static_cast<size_t>(sp - base) < count + 1) {
+        FAIL(stack_underflow);
+      }
+      const std::optional<value> result = formatted(sp[-1].string(), {sp - count - 1, count});
+      if (!result) {
+        FAIL(type_mismatch);
+      }
+      sp -= count + 1;
+      *sp++ = *result;
+      NEXT();
+    }
+    std::optional<value> result;
+    if (selector == Selector::strlen) {
+      if (sp[-1].tag != String) {
+        FAIL(type_mismatch);
+      }
+      result = value::from_uint(sp[-1].length);
+    } else if (!(result = host.call(selector, {sp - arity, arity}, strings))) {
+      FAIL(call_failed);
+    }
+    sp -= arity;
+    *sp++ = *result;
+    NEXT();
+  }
+  call_selector: {
+    const auto selector = static_cast<Selector>(pc->b);
+    if (static_cast<size_t>(sp - base) < pc->a) {
+      FAIL(stack_underflow);
+    }
+    std::optional<value> result;
+    if (selector == Selector::strlen) {
+      if (sp[-1].tag != String) {
+        FAIL(type_mismatch);
+      }
+      result = value::from_uint(sp[-1].length);
+    } else if (!(result = host.call(selector, {sp - pc->a, pc->a}, strings))) {
+      FAIL(call_failed);
+    }
+    sp -= pc->a;
+    *sp++ = *result;
+    NEXT();
+  }
+  call_sprintf: {
+    if (static_cast<size_t>(sp - base) < pc->b) {
+      FAIL(stack_underflow);
+    }
+    const std::optional<value> result = formatted(p.strings[pc->a], {sp - pc->b, pc->b});
+    if (!result) {
+      FAIL(type_mismatch);
+    }
+    sp -= pc->b;
+    *sp++ = *result;
+    NEXT();
+  }
+  ret:
+    if (sp == base) {
+      return std::unexpected(vm_error::stack_underflow);
+    }
+    return sp[-1];
+  failed:
+    return std::unexpected(error);
+#undef LITERAL
+#undef INTEGERS
+#undef FAIL
+#undef NEXT
+#undef DISPATCH
+  }
+
+public:
+  /**
+   * Runs `p` on a data stack holding `arguments`, the last on top, calling on `host` for the
+   * selectors on Objects, Types and memory. The result is what is left on top; a String in it is
+   * valid until the next run, and as long as `p` and `arguments`.
+   */
+  std::expected<value, vm_error> run(const program &p, formatter_host &host,
+                                     const std::span<const value> arguments = {}) {
+    return execute<false>(p, host, arguments);
+  }
+
+  /** Runs `p` as `run` does, counting the instructions it executes. */
+  std::expected<value, vm_error> run_counted(const program &p, formatter_host &host,
+                                             const std::span<const value> arguments = {}) {
+    return execute<true>(p, host, arguments);
+  }
+
+  /**
+   * The instructions the last `run_counted` executed, superinstructions counting as one, and the
+   * end of each block and of the program as one more.
+   */
+  [[nodiscard]] uint64_t instructions_executed() const noexcept { return executed; }
+};
@@ -1,85 +1,162 @@
-// https://lldb.llvm.org/resources/formatterbytecode.html#design-of-the-virtual-machine
-#include <stack>
+#include "optimizer.hpp"
+#include "summary_cache.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <tuple>
 
-// All objects on the data stack must have one of the following data types. These data types are
-// "host" data types, in LLDB parlance.
-struct DataType {
-  // Object and Type are opaque, they can only be used as a parameters of `call`.
-  enum class tag {
-    String,   // UTF-8
-    Int,      // 64 bit
-    UInt,     // 64 bit
-    Object,   // Basically an SBValue
-    Type,     // Basically an SBType
-    Selector, // One of the predefine functions
-  } tag;
-};
-
-enum class Instruction : uint8_t {
-  // Stack operations
-
-  // `(x -> x x)`
-  dup = 0x00,
-  // `(x y -> x)`
-  drop = 0x01,
-  // `(x ... UInt -> x ... x)`
-  pick = 0x02,
-  // `(x y -> x y x)`
-  over = 0x03,
-  // `(x y -> y x)`
-  swap = 0x04,
-  // `(x y z -> z x y)`
-  rot = 0x05,
-
-  // Control flow
+/** Allocations so far, counted by replacing the global `operator new`. */
+size_t allocations = 0;
 
-  // `{`: push a code block address onto the control stack.
-  // `}`: (technically not an opcode) syntax for end of code block.
-  begin = 0x10,
-  // `if (UInt -> )`: pop a block from the control stack, if the top of the data stack is nonzero,
-  // execute it.
-  If = 0x11,
-  // `ifelse (UInt -> )`: pop two blocks from the control stack, if the top of the data stack is
-  // nonzero, execute the first, otherwise the second.
-  IfElse = 0x12,
-  // `return`: pop the entire control stack and return.
-  Return = 0x13,
+void *operator new(const size_t size) {
+  ++allocations;
+  if (void *const memory = std::malloc(size)) {
+    return memory;
+  }
+  std::abort();
+}
+void operator delete(void *const memory) noexcept { std::free(memory); }
+void operator delete(void *const memory, size_t) noexcept { std::free(memory); }
 
-  // Literals for basic types
-
-  // `123u ( -> UInt)`: push an unsigned 64-bit host integer.
-  UInt = 0x20,
-  // `123 ( -> Int)`: push a signed 64-bit host integer.
-  Int = 0x21,
-  // `"abc" ( -> String)`: push a UTF-8 host string.
-  String = 0x22,
-  // `@strlen ( -> Selector)`: push one of the predefined function selectors. See call.
-  Selector = 0x23,
+/** A host of vectors, Object n having n elements at address 4096 n. */
+struct vectors : formatter_host {
+  std::optional<value> call(const Selector selector, const std::span<const value> args,
+                            arena &) override {
+    if (args[0].tag != DataType::tag::Object) {
+      return std::nullopt;
+    }
+    if (selector == Selector::get_num_children) {
+      return value::from_uint(args[0].bits);
+    }
+    if (selector == Selector::get_value_as_unsigned) {
+      return value::from_uint(args[0].bits * 4096);
+    }
+    return std::nullopt;
+  }
+};
 
-  // Conversion operations
+/** What `measure` measures. */
+struct measurement {
+  double seconds;        // Per run.
+  uint64_t instructions; // Of a run.
+  double allocations;    // Per run, after the first.
+};
 
-  // Arithmetic, logic, and comparison operations
+/** Runs `p` `runs` times on `argument`. */
+measurement measure(const program &p, const value &argument, const int runs) {
+  vectors host;
+  interpreter vm;
+  const auto counted = vm.run_counted(p, host, {&argument, 1});
+  assert(counted);
+  const uint64_t instructions = vm.instructions_executed();
+  uint64_t checksum = 0;
+  const size_t allocations_before = allocations;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; ++i) {
+    const auto result = vm.run(p, host, {&argument, 1});
+    assert(result && *result == *counted);
+    checksum += result->bits + result->length;
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (checksum == 1) {
+    std::printf("\n"); // Keeps the runs from being optimized away.
+  }
+  return {seconds / runs, instructions,
+          static_cast<double>(allocations - allocations_before) / runs};
+}
 
-  ADD = 0x30,
-  SUB,
-  MUL,
-  DIV,
-  SHL,
-  SHR,
-  NOT,
-  OR,
-  XOR,
-  EQ,
-  EQ2,
-  LT,
-  GT,
-  LE,
-  GE,
+/** `text` `times` times over. */
+std::string repeat(const std::string_view text, const int times) {
+  std::string repeated;
+  for (int i = 0; i < times; ++i) {
+    repeated += text;
+    repeated += '\n';
+  }
+  return repeated;
+}
 
-  // Function calls
+/**
+ * Usage: lldbformatter [runs=100000]
+ *
+ * Times the interpreter of formatter bytecode on a straight run of arithmetic, on a run of
+ * branches, on a summary of the kind debuggers show for each variable, `size=3` for a vector of 3
+ * elements, and on the address of a field computed the way generated formatters do, with
+ * constants left to fold. Each runs as assembled, and as optimized and fused into
+ * superinstructions. Prints a `key=value` line per program, with the instructions executed by a
+ * run and its time, before and after, and the memory allocations of a run, which should be none.
+ *
+ * Then shows the summaries of 200 vectors as a debugger would while stepping, a few of them
+ * changing at each step, with and without a `summary_cache`, and prints the time per summary.
+ */
+int main(const int argc, const char *argv[]) {
+  const int runs = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 100'000;
+  // x = x * 3 + 1 + 2 - 2, 100 times.
+  const std::string arithmetic = repeat("3u * 1u + 2u + 2u -", 100);
+  // x += 1 when x is odd, 2 otherwise, 100 times.
+  const std::string branches = repeat("{ 1u + } { 2u + } dup dup 2u / 2u * - ifelse", 100);
+  const std::string summary = R"(@get_num_children call "size=%u" @sprintf call)";
+  // The address of the third of the 8-byte fields after a 16-byte header.
+  const std::string field = R"(
+    @get_value_as_unsigned call
+    16u + 8u 2u * +     # The header, then two fields.
+    dup drop 0u +       # Left over from a template.
+    "&field=%x" @sprintf call
+  )";
 
-  // `call (Object argN ... arg0 Selector -> retval)`
-  Call = 0x60,
-};
+  for (const auto &[name, text, argument] :
+       {std::tuple("arithmetic", &arithmetic, value::from_uint(1)),
+        std::tuple("branches", &branches, value::from_uint(1)),
+        std::tuple("summary", &summary, value::object(3)),
+        std::tuple("field", &field, value::object(3))}) {
+    const auto bytecode = assemble(*text);
+    assert(bytecode);
+    const auto optimized_bytecode = optimize(*bytecode);
+    const auto as_assembled = program::load(*bytecode, false);
+    const auto optimized = program::load(*optimized_bytecode);
+    assert(as_assembled && optimized);
+    const measurement before = measure(*as_assembled, argument, runs);
+    const measurement after = measure(*optimized, argument, runs);
+    std::printf("program=%s verified=%d bytes_before=%zu bytes_after=%zu "
+                "instructions_before=%llu instructions_after=%llu runs=%d ns_per_run_before=%.1f "
+                "ns_per_run_after=%.1f allocations_per_run=%.2f\n",
+                name, optimized->verified(), bytecode->size(), optimized_bytecode->size(),
+                static_cast<unsigned long long>(before.instructions),
+                static_cast<unsigned long long>(after.instructions), runs, before.seconds * 1e9,
+                after.seconds * 1e9, before.allocations + after.allocations);
+  }
 
-int main() { std::stack<uint8_t> data, control; }
+  // Vectors 1 to 200, 10 of which change at each step.
+  constexpr int variables = 200, changes = 10;
+  const int steps = std::max(runs / variables, 1);
+  const auto p = program::load(*optimize(*assemble(summary)));
+  vectors host;
+  interpreter vm;
+  summary_cache cache(2 * variables);
+  std::array<uint64_t, variables> generations{};
+  uint64_t checksum = 0;
+  double seconds[2];
+  for (const bool cached : {false, true}) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < steps; ++step) {
+      for (int i = 0; i < changes; ++i) {
+        ++generations[(step * 7 + i * 19) % variables];
+      }
+      for (int i = 0; i < variables; ++i) {
+        const value object = value::object(i + 1);
+        const auto result = cached ? cache.run(vm, *p, 0, host, object, generations[i])
+                                   : vm.run(*p, host, {&object, 1});
+        assert(result);
+        checksum += result->length;
+      }
+    }
+    seconds[cached] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                          .count() /
+                      (steps * variables);
+  }
+  std::printf("scenario=stepping variables=%d changes_per_step=%d steps=%d hits=%llu misses=%llu "
+              "ns_per_summary_uncached=%.1f ns_per_summary_cached=%.1f checksum=%llu\n",
+              variables, changes, steps, static_cast<unsigned long long>(cache.hits()),
+              static_cast<unsigned long long>(cache.misses()), seconds[false] * 1e9,
+              seconds[true] * 1e9, static_cast<unsigned long long>(checksum));
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "assembler.hpp"
+
+namespace optimizer_impl {
+
+/** A host for programs that call on none. */
+struct no_host : formatter_host {
+  std::optional<value> call(Selector, std::span<const value>, arena &) override {
+    return std::nullopt;
+  }
+};
+
+inline bool is_number(const instruction &i) {
+  return i.code == Instruction::UInt || i.code == Instruction::Int;
+}
+
+inline bool is_literal(const instruction &i) {
+  return is_number(i) || i.code == Instruction::String || i.code == Instruction::Selector;
+}
+
+inline bool is_binary(const Instruction code) {
+  return code >= Instruction::ADD && code <= Instruction::GE && code != Instruction::NOT;
+}
+
+/** The number `code`, of literals only, leaves on the stack; nullopt if it fails or leaves none. */
+inline std::optional<instruction> evaluate(const std::span<const instruction> code) {
+  std::vector<uint8_t> bytes;
+  encode(code, bytes);
+  const auto p = program::load(bytes);
+  no_host host;
+  interpreter vm;
+  const auto result = vm.run(*p, host);
+  if (!result || (result->tag != DataType::tag::UInt && result->tag != DataType::tag::Int)) {
+    return std::nullopt;
+  }
+  return instruction{result->tag == DataType::tag::UInt ? Instruction::UInt : Instruction::Int,
+                     result->bits};
+}
+
+/** Rewrites the end of `out`, an instruction just pushed onto it, until no rule applies. */
+inline void reduce(std::vector<instruction> &out) {
+  using I = Instruction;
+  for (;;) {
+    const size_t n = out.size();
+    const auto back = [&out, n](const size_t i) -> instruction & { return out[n - i]; };
+    // A value pushed, or swapped, and undone right away.
+    if (n >= 2 && ((back(1).code == I::drop &&
+                    (back(2).code == I::dup || back(2).code == I::over || is_literal(back(2)))) ||
+                   (back(1).code == I::swap && back(2).code == I::swap))) {
+      out.resize(n - 2);
+      continue;
+    }
+    // Operators on literals, by running them, unless they fail.
+    const size_t operands = n >= 3 && is_binary(back(1).code)   ? 2
+                            : n >= 2 && back(1).code == I::NOT ? 1
+                                                               : 0;
+    if (operands != 0 && std::ranges::all_of(std::span(out).last(operands + 1).first(operands),
+                                             is_number)) {
+      if (const auto folded = evaluate(std::span(out).last(operands + 1))) {
+        out.resize(n - operands - 1);
+        out.push_back(*folded);
+        continue;
+      }
+    }
+    // `a + b -` and the like, which add or subtract literals of one type, as a single `+` or `-`.
+    const auto additive = [](const I code) { return code == I::ADD || code == I::SUB; };
+    if (n >= 4 && additive(back(1).code) && additive(back(3).code) && is_number(back(2)) &&
+        back(4).code == back(2).code) {
+      const uint64_t a = back(3).code == I::SUB ? 0 - back(4).literal : back(4).literal;
+      const uint64_t b = back(1).code == I::SUB ? 0 - back(2).literal : back(2).literal;
+      const uint64_t sum = a + b;
+      // Subtracts what is negative as an Int, but for the least of them, which has no negation.
+      const bool subtract = static_cast<int64_t>(sum) < 0 && sum != uint64_t{1} << 63;
+      const I type = back(2).code;
+      out.resize(n - 4);
+      out.push_back({type, subtract ? 0 - sum : sum});
+      out.push_back({subtract ? I::SUB : I::ADD});
+      continue;
+    }
+    // Adding or subtracting zero, as such chains may come to.
+    if (n >= 2 && additive(back(1).code) && is_number(back(2)) && back(2).literal == 0) {
+      out.resize(n - 2);
+      continue;
+    }
+    return;
+  }
+}
+
+} // namespace optimizer_impl
+
+/**
+ * `instructions` improved by a peephole optimizer, blocks included: operators on literals folded
+ * into literals, sums and differences of literals chained onto a value folded into one, and
+ * those of zero, values pushed only to be dropped, and swaps swapped back, removed. Every run that
+ * succeeded gives the same result; one that failed on stack underflow, or on adding to a value of
+ * another type, may now succeed.
+ */
+inline std::vector<instruction> optimize(const std::span<const instruction> instructions) {
+  std::vector<instruction> out;
+  for (const instruction &i : instructions) {
+    out.push_back(i);
+    if (i.code == Instruction::begin) {
+      out.back().block = optimize(i.block);
+    }
+    optimizer_impl::reduce(out);
+  }
+  return out;
+}
+
+/** `bytecode` optimized as above, nullopt if it is not well formed. */
+inline std::optional<std::vector<uint8_t>> optimize(const std::span<const uint8_t> bytecode) {
+  return parse_bytecode(bytecode).transform([](const std::vector<instruction> &instructions) {
+    std::vector<uint8_t> bytes;
+    encode(optimize(instructions), bytes);
+    return bytes;
+  });
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "formatter.hpp"
+#include <list>
+#include <unordered_map>
+
+/**
+ * The results of formatters, so that a debugger showing the same variables step after step runs
+ * each formatter again only on those that changed. A result is keyed by an ID the caller gives
+ * the program, the Object it ran on, and a generation the caller bumps whenever the memory it
+ * depends on may have changed; it is reused while all three stay the same. Only successful runs
+ * are kept, at most `capacity` of them, the least recently used going first.
+ */
+class summary_cache {
+public:
+  struct key {
+    uint64_t program, object, generation;
+    bool operator==(const key &) const = default;
+  };
+
+private:
+  struct key_hash {
+    size_t operator()(const key &k) const noexcept {
+      constexpr uint64_t odd = 0x9E3779B97F4A7C15; // 2^64 / the golden ratio.
+      const uint64_t h = ((k.program * odd ^ k.object) * odd ^ k.generation) * odd;
+      return h ^ h >> 32;
+    }
+  };
+
+  struct entry {
+    key id;
+    value result;
+    std::string string; // What `result` refers to if it is a long String.
+  };
+
+  std::list<entry> entries; // The most recently used first.
+  std::unordered_map<key, std::list<entry>::iterator, key_hash> index;
+  size_t capacity;
+  uint64_t hit_count = 0, miss_count = 0;
+
+public:
+  explicit summary_cache(const size_t capacity) : capacity(capacity) {
+    assert(capacity > 0);
+    index.reserve(capacity);
+  }
+
+  /**
+   * The result of `p`, which has ID `program_id`, on `object` as of `generation`: the one kept
+   * from an earlier run, or that of running `p` with `vm` and `host`. A String in it is valid until
+   * the next call.
+   */
+  std::expected<value, vm_error> run(interpreter &vm, const program &p, const uint64_t program_id,
+                                     formatter_host &host, const value &object,
+                                     const uint64_t generation) {
+    const key id{program_id, object.bits, generation};
+    if (const auto found = index.find(id); found != index.end()) {
+      ++hit_count;
+      entries.splice(entries.begin(), entries, found->second);
+      return found->second->result;
+    }
+    ++miss_count;
+    const auto result = vm.run(p, host, {&object, 1});
+    if (!result) {
+      return result;
+    }
+    if (entries.size() == capacity) { // The least recently used entry makes room, node and all.
+      index.erase(entries.back().id);
+      entries.splice(entries.begin(), entries, std::prev(entries.end()));
+    } else {
+      entries.emplace_front();
+    }
+    entry &e = entries.front();
+    e.id = id;
+    e.result = *result;
+    if (result->tag == DataType::tag::String) {
+      e.string.assign(result->string());
+      e.result = value::view(e.string);
+    }
+    index.emplace(id, entries.begin());
+    return e.result;
+  }
+
+  /** Forgets every result, keeping the counts. */
+  void clear() noexcept {
+    entries.clear();
+    index.clear();
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return entries.size(); }
+  [[nodiscard]] uint64_t hits() const noexcept { return hit_count; }
+  [[nodiscard]] uint64_t misses() const noexcept { return miss_count; }
+};
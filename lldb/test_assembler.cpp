@@ -0,0 +1,69 @@
+#include "assembler.hpp"
+#include <cassert>
+
+/** The bytecode of `depth` empty blocks, each but the outermost in the one around it. */
+std::vector<uint8_t> nested_blocks(const size_t depth) {
+  std::vector<std::vector<uint8_t>> headers; // From the innermost out.
+  size_t size = 0;
+  for (size_t i = 0; i < depth; ++i) {
+    auto &header = headers.emplace_back(1, std::to_underlying(Instruction::begin));
+    append_uleb(header, size);
+    size += header.size();
+  }
+  std::vector<uint8_t> bytes;
+  for (auto header = headers.rbegin(); header != headers.rend(); ++header) {
+    bytes.insert(bytes.end(), header->begin(), header->end());
+  }
+  return bytes;
+}
+
+int main() {
+  using I = Instruction;
+  // Literals, with their encodings.
+  assert(*assemble("0u 300u -2 @strlen") ==
+         (std::vector<uint8_t>{0x20, 0x00, 0x20, 0xAC, 0x02, 0x21, 0x7E, 0x23, 0x52}));
+  assert(*assemble(R"("a\"\\\n\t\x7f")") ==
+         (std::vector<uint8_t>{0x22, 6, 'a', '"', '\\', '\n', '\t', 0x7F}));
+  assert(*assemble("-9223372036854775808") ==
+         (std::vector<uint8_t>{0x21, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x7F}));
+
+  // Blocks, nested, and comments.
+  const auto parsed = parse_assembly("{ 1u { } } # a comment\n dup{2u}ifelse");
+  assert(parsed);
+  assert(*parsed == (std::vector<instruction>{
+                        {I::begin, 0, {}, {{I::UInt, 1}, {I::begin}}},
+                        {I::dup},
+                        {I::begin, 0, {}, {{I::UInt, 2}}},
+                        {I::IfElse},
+                    }));
+  assert(*assemble("{ 1u }") == (std::vector<uint8_t>{0x10, 2, 0x20, 1}));
+
+  // Every mnemonic, back and forth between text and bytecode.
+  const std::string_view text = "dup drop pick over swap rot if ifelse return call + - * / << >> ~ "
+                                "| ^ = != < > <= >= { 1u { -1 } } \"%u\\n\\x01\" @sprintf "
+                                "@get_child_at_index";
+  const auto bytes = assemble(text);
+  assert(bytes && program::load(*bytes));
+  assert(disassemble(*parse_bytecode(*bytes)) == text);
+  assert(disassemble(*parse_assembly("{ }")) == "{ }");
+
+  // Text and bytecode that do not parse.
+  for (const std::string_view bad : {"{", "}", "{ 1u } }", "\"abc", "\"\\x1\"", "@nothing", "1x",
+                                     "u", "18446744073709551616u", "9223372036854775808", "dupe"}) {
+    assert(!assemble(bad));
+  }
+  assert(!parse_bytecode(std::vector<uint8_t>{0x10, 3, 0x20, 1}));
+  assert(!parse_bytecode(std::vector<uint8_t>{0x10, 1, 0x06}));
+  assert(!parse_bytecode(std::vector<uint8_t>{0x23, 0x7F}));
+  assert(!parse_bytecode(std::vector<uint8_t>{0x20}));
+
+  // Blocks nested as deep as `program` allows, but no deeper, however deep.
+  const size_t deepest = interpreter::control_capacity;
+  const auto nested = [](const size_t depth) {
+    return std::string(depth, '{') + std::string(depth, '}');
+  };
+  assert(*assemble(nested(deepest)) == nested_blocks(deepest));
+  assert(!assemble(nested(deepest + 1)) && !assemble(nested(50'000)));
+  assert(parse_bytecode(nested_blocks(deepest)));
+  assert(!parse_bytecode(nested_blocks(deepest + 1)) && !parse_bytecode(nested_blocks(50'000)));
+}
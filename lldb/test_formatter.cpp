@@ -0,0 +1,271 @@
+#include "formatter.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+/** Allocations so far, counted by replacing the global `operator new`. */
+size_t allocations = 0;
+
+void *operator new(const size_t size) {
+  ++allocations;
+  if (void *const memory = std::malloc(size)) {
+    return memory;
+  }
+  std::abort();
+}
+void operator delete(void *const memory) noexcept { std::free(memory); }
+void operator delete(void *const memory, size_t) noexcept { std::free(memory); }
+
+/** Bytecode, an instruction at a time. */
+struct assembly {
+  std::vector<uint8_t> bytes;
+
+  assembly &operator()(const Instruction i) {
+    bytes.push_back(std::to_underlying(i));
+    return *this;
+  }
+  assembly &u(const uint64_t n) {
+    (*this)(Instruction::UInt);
+    append_uleb(bytes, n);
+    return *this;
+  }
+  assembly &i(const int64_t n) {
+    (*this)(Instruction::Int);
+    append_sleb(bytes, n);
+    return *this;
+  }
+  assembly &s(const std::string_view text) {
+    (*this)(Instruction::String);
+    append_uleb(bytes, text.size());
+    bytes.insert(bytes.end(), text.begin(), text.end());
+    return *this;
+  }
+  assembly &call(const Selector selector) {
+    (*this)(Instruction::Selector);
+    bytes.push_back(std::to_underlying(selector));
+    return (*this)(Instruction::Call);
+  }
+  assembly &block(const assembly &body) {
+    (*this)(Instruction::begin);
+    append_uleb(bytes, body.bytes.size());
+    bytes.insert(bytes.end(), body.bytes.begin(), body.bytes.end());
+    return *this;
+  }
+};
+
+/** `depth` empty blocks, each but the outermost in the one around it. */
+std::vector<uint8_t> nested_blocks(const size_t depth) {
+  std::vector<std::vector<uint8_t>> headers; // From the innermost out.
+  size_t size = 0;
+  for (size_t i = 0; i < depth; ++i) {
+    auto &header = headers.emplace_back(1, std::to_underlying(Instruction::begin));
+    append_uleb(header, size);
+    size += header.size();
+  }
+  std::vector<uint8_t> bytes;
+  for (auto header = headers.rbegin(); header != headers.rend(); ++header) {
+    bytes.insert(bytes.end(), header->begin(), header->end());
+  }
+  return bytes;
+}
+
+/** Objects 0 to 2, with as many children as their number, each an Object of its own. */
+struct test_host : formatter_host {
+  int calls = 0;
+  std::optional<value> call(const Selector selector, const std::span<const value> args,
+                            arena &strings) override {
+    ++calls;
+    if (args[0].tag != DataType::tag::Object || args[0].bits > 2) {
+      return std::nullopt;
+    }
+    if (selector == Selector::get_num_children) {
+      return value::from_uint(args[0].bits);
+    }
+    if (selector == Selector::get_child_at_index && args[1].bits < args[0].bits) {
+      return value::object(10 + args[1].bits);
+    }
+    if (selector == Selector::summary) {
+      char *const chars = strings.allocate(20);
+      std::fill_n(chars, 20, static_cast<char>('a' + args[0].bits));
+      return value::view({chars, 20});
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * The result of `code` on `args`, the same with superinstructions and without. A String in it is
+ * valid until the next call, as the interpreter that made it lives until then.
+ */
+std::expected<value, vm_error> run(const assembly &code, const std::span<const value> args = {}) {
+  static interpreter vm, plain_vm;
+  test_host host;
+  const auto p = program::load(code.bytes);
+  const auto plain = program::load(code.bytes, false);
+  assert(p && plain && p->verified() == plain->verified());
+  const auto result = vm.run(*p, host, args);
+  assert(plain_vm.run(*plain, host, args) == result);
+  return result;
+}
+
+int main() {
+  using I = Instruction;
+  // Arithmetic on Ints and UInts, wrapping, and comparisons to UInt 0 or 1.
+  assert(*run(assembly().u(40).u(2)(I::ADD)) == value::from_uint(42));
+  assert(*run(assembly().u(0).u(1)(I::SUB)) == value::from_uint(UINT64_MAX));
+  assert(*run(assembly().i(-7).i(2)(I::DIV)) == value::from_int(-3));
+  assert(*run(assembly().i(INT64_MIN).i(-1)(I::DIV)) == value::from_int(INT64_MIN));
+  assert(*run(assembly().i(-8).i(1)(I::SHR)) == value::from_int(-4));
+  assert(*run(assembly().u(1).u(63)(I::SHL)) == value::from_uint(uint64_t{1} << 63));
+  assert(*run(assembly().u(6)(I::NOT)) == value::from_uint(~uint64_t{6}));
+  assert(*run(assembly().i(-1).i(0)(I::LT)) == value::from_uint(1));
+  assert(*run(assembly().u(UINT64_MAX).u(0)(I::LT)) == value::from_uint(0));
+  assert(*run(assembly().u(3).u(3)(I::EQ2)) == value::from_uint(0));
+
+  // Stack operations.
+  assert(*run(assembly().u(1).u(2).u(3)(I::rot)) == value::from_uint(2));
+  assert(*run(assembly().u(1).u(2).u(3)(I::rot)(I::drop)) == value::from_uint(1));
+  assert(*run(assembly().u(10).u(20).u(30).u(2)(I::pick)) == value::from_uint(10));
+  assert(*run(assembly().u(10).u(20)(I::over)) == value::from_uint(10));
+  assert(*run(assembly().u(10).u(20)(I::swap)) == value::from_uint(10));
+  assert(*run(assembly().s("ab")(I::dup)(I::drop)) == value::view("ab"));
+
+  // Blocks, run or not, and returning from within them.
+  assert(*run(assembly().u(1).block(assembly().u(5)).u(1)(I::If)) == value::from_uint(5));
+  assert(*run(assembly().u(1).block(assembly().u(5)).u(0)(I::If)) == value::from_uint(1));
+  const assembly choose = assembly().block(assembly().s("yes")).block(assembly().s("no"));
+  assert(*run(assembly(choose).u(1)(I::IfElse)) == value::view("yes"));
+  assert(*run(assembly(choose).i(0)(I::IfElse)) == value::view("no"));
+  const assembly nested = assembly().u(2)(I::ADD)(I::dup).u(5)(I::GT).block(
+      assembly().u(100)(I::Return))(I::If).u(1)(I::ADD);
+  assert(*run(assembly().u(1).block(nested).u(1)(I::If)) == value::from_uint(4));
+  assert(*run(assembly().u(4).block(nested).u(1)(I::If)) == value::from_uint(100));
+
+  // Selectors, by the host or by the interpreter itself.
+  {
+    test_host host;
+    interpreter vm;
+    const auto p = program::load(assembly()
+                                     .call(Selector::get_num_children)
+                                     .s("%u children, %s")
+                                     .s("abc")
+                                     (I::swap)
+                                     .call(Selector::sprintf)
+                                     .bytes);
+    assert(p);
+    const value object = value::object(2);
+    assert(*vm.run_counted(*p, host, {&object, 1}) == value::view("2 children, abc"));
+    assert(vm.instructions_executed() == 7 && host.calls == 1);
+    const value missing = value::object(7);
+    assert(vm.run(*p, host, {&missing, 1}).error() == vm_error::call_failed);
+  }
+  assert(*run(assembly().u(1).call(Selector::get_child_at_index),
+              std::array{value::object(2)}) == value::object(11));
+  assert(*run(assembly().s("hello").call(Selector::strlen)) == value::from_uint(5));
+  assert(*run(assembly().u(7).i(-7).s("%x%%%d").call(Selector::sprintf)) ==
+         value::view("7%-7"));
+
+  // Strings held inline, and by the program, the interpreter's arena or the host's.
+  {
+    test_host host;
+    interpreter vm;
+    const auto p = program::load(assembly()
+                                     (I::dup)
+                                     .call(Selector::summary)
+                                     .s("a string of 22 bytes, %s")
+                                     .call(Selector::sprintf)
+                                     .s("12345678")
+                                     (I::rot)
+                                     .bytes);
+    assert(p);
+    const value object = value::object(1);
+    const auto result = vm.run(*p, host, {&object, 1});
+    // Copied out of the arena, which the runs below reuse.
+    const std::string expected(result->string());
+    assert(expected == "a string of 22 bytes, bbbbbbbbbbbbbbbbbbbb");
+    assert(*run(assembly().s("a literal of 22 bytes.").call(Selector::strlen)) ==
+           value::from_uint(22));
+    assert(*run(assembly().s("12345678").s("%s9").call(Selector::sprintf)) ==
+           value::view("123456789"));
+    assert(*run(assembly().s("").call(Selector::strlen)) == value::from_uint(0));
+
+    // Once the arena has grown, runs allocate nothing.
+    const size_t before = allocations;
+    for (int i = 0; i < 100; ++i) {
+      assert(vm.run(*p, host, {&object, 1})->string() == expected);
+    }
+    assert(allocations == before);
+  }
+  {
+    arena strings;
+    const char *const first = strings.allocate(10);
+    assert(strings.allocate(arena::block_size) != first + 10);
+    const std::string_view text = "longer than eight";
+    const value copied = value::from_string(text, strings);
+    assert(copied.string() == text && copied.string().data() != text.data());
+    strings.reset();
+    assert(strings.allocate(1) == first);
+    assert(value::from_string("short", strings).string() == "short");
+    assert(value::view("short") == value::from_string("short", strings));
+    assert(value::view("12345678") != value::view("12345679"));
+    assert(value::from_uint(1) != value::from_int(1));
+  }
+
+  // Errors, from the checks of basic blocks and of instructions.
+  assert(run(assembly().u(1)(I::ADD)).error() == vm_error::stack_underflow);
+  assert(run(assembly()).error() == vm_error::stack_underflow);
+  assert(run(assembly().u(1).i(1)(I::ADD)).error() == vm_error::type_mismatch);
+  assert(run(assembly().u(1).u(0)(I::DIV)).error() == vm_error::division_by_zero);
+  assert(run(assembly().u(1).u(64)(I::SHL)).error() == vm_error::shift_out_of_range);
+  assert(run(assembly().u(1).u(1)(I::pick)).error() == vm_error::stack_underflow);
+  assert(run(assembly().u(1)(I::If)).error() == vm_error::stack_underflow);
+  assert(run(assembly().u(1).call(Selector::strlen)).error() == vm_error::type_mismatch);
+  assert(run(assembly().s("%d").call(Selector::sprintf)).error() == vm_error::stack_underflow);
+  assembly deep;
+  for (size_t i = 0; i <= interpreter::data_capacity; ++i) {
+    deep.u(i);
+  }
+  assert(run(deep).error() == vm_error::stack_overflow);
+
+  // Stack effects, verified or left to checks.
+  {
+    const auto sum = program::load(assembly().u(1)(I::ADD)(I::over)(I::ADD).bytes);
+    assert(sum->verified() && sum->arguments_needed() == 2);
+    const auto branches = program::load(
+        assembly().block(assembly()(I::drop)).block(assembly()(I::swap)(I::drop))(I::IfElse).bytes);
+    assert(branches->verified() && branches->arguments_needed() == 3);
+    const auto uneven = program::load(
+        assembly().block(assembly()(I::drop)).block(assembly()(I::dup))(I::IfElse)(I::drop).bytes);
+    assert(uneven->verified() && uneven->arguments_needed() == 4);
+    const auto selector = program::load(assembly()(I::swap)(I::Call).bytes);
+    assert(!selector->verified());
+    assert(!program::load(assembly().s("%d")(I::swap).call(Selector::sprintf).bytes)->verified());
+    assert(!program::load(assembly().block(assembly()(I::If)).u(1)(I::If).bytes)->verified());
+    const auto early =
+        program::load(assembly().block(assembly()(I::Return)).u(1)(I::If)(I::drop).bytes);
+    assert(early->verified() && early->arguments_needed() == 2);
+  }
+  assert(*run(assembly().s("abc")(I::swap)(I::Call),
+              std::array{value::from_selector(Selector::strlen)}) == value::from_uint(3));
+  assert(run(assembly()(I::Call)).error() == vm_error::stack_underflow);
+  assert(run(assembly()(I::drop)(I::Call), std::array{value::from_uint(1)}).error() ==
+         vm_error::stack_underflow);
+  assert(run(assembly().u(1)(I::Call)).error() == vm_error::type_mismatch);
+  assert(*run(assembly().block(assembly()(I::If)).block(assembly().u(9)).u(1).u(1)(I::If)) ==
+         value::from_uint(9));
+  assert(run(assembly().u(1).block(assembly()(I::drop)(I::drop)).u(1)(I::If)).error() ==
+         vm_error::stack_underflow);
+
+  // Bytecode that does not decode.
+  assert(!program::load(std::vector<uint8_t>{0x20}));
+  assert(!program::load(std::vector<uint8_t>{0x20, 0x80}));
+  assert(!program::load(std::vector<uint8_t>{0x22, 3, 'a'}));
+  assert(!program::load(std::vector<uint8_t>{0x10, 2, 0x00}));
+  assert(!program::load(std::vector<uint8_t>{0x23, 0x7F}));
+  assert(!program::load(std::vector<uint8_t>{0x06}));
+
+  // Blocks nested as deep as the control stack goes, but no deeper, however deep.
+  assert(program::load(nested_blocks(interpreter::control_capacity)));
+  assert(!program::load(nested_blocks(interpreter::control_capacity + 1)));
+  assert(!program::load(nested_blocks(50'000)));
+}
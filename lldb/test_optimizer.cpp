@@ -0,0 +1,61 @@
+#include "optimizer.hpp"
+#include <cassert>
+
+/** `text` optimized, as text. */
+std::string optimized(const std::string_view text) {
+  const auto instructions = parse_assembly(text);
+  assert(instructions);
+  return disassemble(optimize(*instructions));
+}
+
+/** What `text` leaves on the stack, on `argument`, as is and optimized. */
+std::pair<std::expected<value, vm_error>, std::expected<value, vm_error>>
+results(const std::string_view text, const value &argument) {
+  optimizer_impl::no_host host;
+  interpreter vm;
+  const auto bytes = assemble(text);
+  const auto as_is = program::load(*bytes);
+  const auto better = program::load(*optimize(*bytes));
+  assert(as_is && better);
+  return {vm.run(*as_is, host, {&argument, 1}), vm.run(*better, host, {&argument, 1})};
+}
+
+int main() {
+  // Operators on literals, folded unless they fail.
+  assert(optimized("1u 2u + 3u *") == "9u");
+  assert(optimized("2 3 - 1 =") == "0u");
+  assert(optimized("5u ~ ~") == "5u");
+  assert(optimized("1u 1u = 1u = 1u !=") == "0u");
+  assert(optimized("1u 0u /") == "1u 0u /");
+  assert(optimized("1u 1 +") == "1u 1 +");
+  assert(optimized("\"a\" 1u +") == "\"a\" 1u +");
+
+  // Sums and differences chained onto a value.
+  assert(optimized("dup 1u + 2u + 3u -") == "dup");
+  assert(optimized("0 - 0u +") == "");
+  assert(optimized("1u + 2u + 4u -") == "1u -");
+  assert(optimized("5 - 3 - 2 +") == "6 -");
+  assert(optimized("1u + 2 +") == "1u + 2 +");
+  assert(optimized("1u + 2u * 3u +") == "1u + 2u * 3u +");
+
+  // Values pushed to be dropped, and swaps swapped back.
+  assert(optimized("dup drop over drop swap swap \"a\" drop @strlen drop") == "");
+  assert(optimized("1u dup 2u swap swap drop drop") == "1u");
+  assert(optimized("1u 2u drop +") == "1u +");
+
+  // Within blocks.
+  assert(optimized("{ 1u 2u + { dup drop } } 2u 1u > if") == "{ 3u { } } 1u if");
+
+  // Results unchanged, errors included.
+  for (const std::string_view text :
+       {"1u + 2u + 4u -", "dup 3u * 1u 2u + - 0u 7u 3u * - +", "10u swap - 1u 1u 64u << +",
+        "{ 1u 2u + } { 2u } 1u 2u < ifelse +", "1 -", "2u 1u 2u 3u rot drop - 5u * /"}) {
+    for (const value &argument : {value::from_uint(5), value::from_int(-5)}) {
+      const auto [as_is, better] = results(text, argument);
+      assert(as_is == better);
+    }
+  }
+
+  // Bytecode that does not decode.
+  assert(!optimize(std::vector<uint8_t>{0x20}));
+}
@@ -0,0 +1,62 @@
+#include "assembler.hpp"
+#include "summary_cache.hpp"
+#include <cassert>
+
+/** Objects n with n children, at most 9, counting the calls made on them. */
+struct counting_host : formatter_host {
+  int calls = 0;
+  std::optional<value> call(const Selector selector, const std::span<const value> args,
+                            arena &) override {
+    ++calls;
+    if (selector != Selector::get_num_children || args[0].bits > 9) {
+      return std::nullopt;
+    }
+    return value::from_uint(args[0].bits);
+  }
+};
+
+int main() {
+  const auto p = program::load(
+      *assemble(R"(@get_num_children call "a vector of %u elements" @sprintf call)"));
+  const auto q = program::load(*assemble("@get_num_children call 1u +"));
+  assert(p && q);
+  counting_host host;
+  interpreter vm;
+  summary_cache cache(2);
+
+  // Run once, then kept while the program, Object and generation stay the same.
+  assert(cache.run(vm, *p, 1, host, value::object(3), 0)->string() == "a vector of 3 elements");
+  assert(cache.run(vm, *p, 1, host, value::object(3), 0)->string() == "a vector of 3 elements");
+  assert(host.calls == 1 && cache.hits() == 1 && cache.misses() == 1 && cache.size() == 1);
+  assert(*cache.run(vm, *q, 2, host, value::object(3), 0) == value::from_uint(4));
+  assert(host.calls == 2 && cache.misses() == 2);
+  assert(cache.run(vm, *p, 1, host, value::object(3), 1)->string() == "a vector of 3 elements");
+  assert(host.calls == 3 && cache.misses() == 3 && cache.size() == 2);
+
+  // The least recently used makes room.
+  assert(*cache.run(vm, *q, 2, host, value::object(3), 0) == value::from_uint(4));
+  assert(host.calls == 3 && cache.hits() == 2);
+  assert(cache.run(vm, *p, 1, host, value::object(5), 0)->string() == "a vector of 5 elements");
+  assert(cache.size() == 2);
+  assert(cache.run(vm, *p, 1, host, value::object(3), 1)->string() == "a vector of 3 elements");
+  assert(host.calls == 5 && cache.hits() == 2);
+  assert(*cache.run(vm, *q, 2, host, value::object(3), 0) == value::from_uint(4));
+  assert(host.calls == 6 && cache.hits() == 2);
+
+  // Kept strings outlive the runs that made them.
+  assert(cache.run(vm, *p, 1, host, value::object(5), 0)->string() == "a vector of 5 elements");
+  const value object = value::object(7);
+  assert(vm.run(*p, host, {&object, 1})->string() == "a vector of 7 elements");
+  assert(cache.run(vm, *p, 1, host, value::object(5), 0)->string() == "a vector of 5 elements");
+  assert(host.calls == 8 && cache.hits() == 3 && cache.misses() == 7);
+
+  // Failures are not kept.
+  assert(cache.run(vm, *p, 1, host, value::object(10), 0).error() == vm_error::call_failed);
+  assert(cache.run(vm, *p, 1, host, value::object(10), 0).error() == vm_error::call_failed);
+  assert(host.calls == 10 && cache.misses() == 9 && cache.size() == 2);
+
+  cache.clear();
+  assert(cache.size() == 0 && cache.hits() == 3);
+  assert(cache.run(vm, *p, 1, host, value::object(5), 0)->string() == "a vector of 5 elements");
+  assert(host.calls == 11);
+}
@@ -1,5 +1,6 @@
 #include "unicode.hpp"
 #include <algorithm>
+#include <string>
 #include <string_view>
 
 static_assert(std::ranges::input_range<codepoint_view<std::u8string_view>>);
@@ -42,6 +43,17 @@ static_assert(test(u8"\xED\x95\x9C\xEA\xB5\xAD\xEC\x96\xB4"sv, {0xD55C, 0xAD6D,
 static_assert(test(u8"\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E"sv, {0x65E5, 0x672C, 0x8A9E}));
 static_assert(test(u8"\xEF\xBB\xBF\xF0\xA3\x8E\xB4"sv, {0xFEFF, 0x2'33B4}));
 
+constexpr bool round_trip(std::initializer_list<int> codepoints) {
+  std::u8string code_units;
+  for (const int c : codepoints) {
+    char8_t buffer[4];
+    code_units.append(buffer, encode_utf8(c, buffer));
+  }
+  return test(code_units, codepoints);
+}
+static_assert(
+    round_trip({0x41, 0x7F, 0x80, 0x7FF, 0x800, 0xD7FF, 0xE000, 0xFFFF, 0x1'0000, 0x10'FFFF}));
+
 constexpr auto operator""_kb(unsigned long long x) noexcept { return x << 10; }
 static_assert(3_kb == 3072);
 static_assert(1_kb != 3);